@@ -0,0 +1,104 @@
+/*******************************************************************************/
+/* File     batch.hpp
+/* Author   Johannes Braun
+/* Created  17.10.2026
+/*
+/* Preprocessing many shader files, or many variants of one, in parallel.
+/*******************************************************************************/
+
+#pragma once
+
+#include "preprocess.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace glshader::process
+{
+    /* Runs the jobs of a batch. Must call job(i) exactly once for every i in [0, count), on any thread and in any order,
+    and may only return after all calls have finished. */
+    using batch_executor = std::function<void(size_t count, const std::function<void(size_t)>& job)>;
+
+    /* A fixed set of worker threads. Every run splits the jobs into one range per thread. A thread which has finished
+    its own range takes over the back half of the remaining range of another thread. */
+    class thread_pool
+    {
+    public:
+        /* Starts thread_count - 1 workers, as the thread calling run takes part as well.
+        A thread_count of 0 uses one thread per hardware thread. */
+        explicit thread_pool(size_t thread_count = 0);
+        ~thread_pool();
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        /* The number of threads working on a run, including the calling thread. */
+        size_t thread_count() const noexcept;
+
+        /* Calls job(i) for every i in [0, count) and returns when all calls have finished. Runs from multiple threads
+        are executed one after another. A run started by a job of the same pool, e.g. a nested preprocess_batch, calls
+        all of its jobs on the thread of that job. The first exception thrown by a job is rethrown after all other jobs
+        have finished. */
+        void run(size_t count, const std::function<void(size_t)>& job);
+
+        /* Returns an executor running batches on this pool. The pool must outlive it. */
+        batch_executor executor() noexcept;
+
+    private:
+        struct shared_state;
+        std::unique_ptr<shared_state> _state;
+    };
+
+    /* Preprocesses all files in parallel and returns the results in the order of the infos. Infos without
+    gl_capabilities use the capabilities of the GL context current on the calling thread, captured once, so results do not
+    depend on which thread processed a file. Syntax errors are collected per file in processed_file::diagnostics and passed to
+    ERR_OUTPUT on the calling thread in the order of the files after all of them are done.
+    Infos without a condition_cache, file_cache or include_cache share ones which only live during the batch.
+    If no executor is given, a thread_pool with one thread per hardware thread is used. */
+    std::vector<processed_file> preprocess_batch(const preprocess_file_info* infos, size_t count, const batch_executor& executor = {});
+
+    /* See preprocess_batch(const preprocess_file_info*, size_t, const batch_executor&). */
+    std::vector<processed_file> preprocess_batch(const std::vector<preprocess_file_info>& infos, const batch_executor& executor = {});
+
+    /* A distinct variant of a shader, produced by preprocess_permutations. */
+    struct permutation
+    {
+        uint64_t depends_on = 0;    /* Bit i is set if the code of one of the combinations using this variant depends on axis i. */
+        processed_file file;
+    };
+
+    /* All variants of a shader for the combinations of a set of axes, which are definitions that are either set or not. */
+    struct permutation_set
+    {
+        /* All combinations in which the axes of depends_on are defined as in defined use the given variant. */
+        struct selection
+        {
+            uint64_t depends_on = 0;    /* Bit i is set if the code depends on axis i, i.e. on whether it is defined or on its value. */
+            uint64_t defined = 0;       /* Bit i is set if axis i is defined, only bits of depends_on are used. */
+            size_t variant = 0;         /* Index into permutations. */
+        };
+
+        std::vector<definition> axes;
+        std::vector<permutation> permutations;  /* Every distinct result is only stored once. */
+        std::vector<selection> selections;      /* Every combination matches exactly one selection. */
+
+        /* Returns the variant for a combination of axes, where bit i is set if axis i is defined. */
+        const permutation& find(uint64_t combination) const;
+    };
+
+    /* Preprocesses a shader for every combination of up to 64 axes, each of which is defined or not in addition to the
+    definitions of the info. Combinations producing the same code are only processed once: a run records which axes were
+    looked up, by conditions or in code, and all combinations which only differ in other axes share its result. New runs are
+    only started for combinations differing in one of the axes that were looked up, so the number of runs grows with the
+    number of distinct variants instead of the number of combinations. Runs which are independent of each other are processed
+    in parallel, and files, include paths and conditions are shared between them through caches as in preprocess_batch.
+    The output sink of the info is not used. Syntax errors are collected and reported as in preprocess_batch.
+    Runs with equal results share one variant, even if they have looked up different axes.
+    With more than 64 axes, an error is reported and the set only holds one invalid variant for all combinations. */
+    permutation_set preprocess_permutations(const preprocess_file_info& info, const std::vector<definition>& axes, const batch_executor& executor = {});
+
+    /* See preprocess_permutations(const preprocess_file_info&, const std::vector<definition>&, const batch_executor&). */
+    permutation_set preprocess_permutations(const preprocess_source_info& info, const std::vector<definition>& axes, const batch_executor& executor = {});
+}
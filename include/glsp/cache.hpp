@@ -0,0 +1,101 @@
+/*******************************************************************************/
+/* File     cache.hpp
+/* Author   Johannes Braun
+/* Created  17.10.2026
+/*
+/* Caches which can be shared between preprocessor runs.
+/*******************************************************************************/
+
+#pragma once
+
+#include "preprocess.hpp"
+#include "source_buffer.hpp"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace glshader::process
+{
+    namespace impl
+    {
+        namespace conditions { class storage; }
+        struct cache_access;
+    }
+
+    /* Remembers the results of #if and #elif conditions per file and position, together with the macros they read.
+    A condition is only expanded and evaluated again when one of those macros has changed, which makes preprocessing
+    the same files with many different sets of definitions cheaper. Can be used by multiple preprocessor runs at once. */
+    class condition_cache
+    {
+    public:
+        condition_cache();
+        ~condition_cache();
+
+        /* Removes all cached conditions of a file. */
+        void evict(const files::path& file);
+        /* Removes all cached conditions. */
+        void clear();
+
+    private:
+        friend struct impl::cache_access;
+
+        std::unique_ptr<impl::conditions::storage> _storage;
+    };
+
+    /* Keeps the contents of loaded shader files in memory, so that files included by many shaders are only read once.
+    Contents are immutable and shared. Reloading a changed file does not affect runs which still use the old contents.
+    Can be used by multiple preprocessor runs at once. */
+    class file_cache
+    {
+    public:
+        /* If check_modification is true, every load compares the modification time and size of a file to the cached ones
+        and reloads it if they differ. Otherwise cached files are only read again after evicting them. */
+        file_cache(bool check_modification = true);
+
+        /* Returns the contents of a file, or nullptr if it cannot be read. Newly loaded files are mapped into memory
+        if memory_map is true, see source_buffer::map. Files which are already cached are returned as they are. */
+        std::shared_ptr<const source_buffer> load(const files::path& path, bool memory_map = false);
+
+        /* Removes a file from the cache. */
+        void evict(const files::path& path);
+        /* Removes all files from the cache. */
+        void clear();
+
+    private:
+        struct entry
+        {
+            std::shared_ptr<const source_buffer> contents;
+            files::file_time_type modification_time;
+            uintmax_t size;
+        };
+
+        const bool _check_modification;
+        std::mutex _mutex;
+        std::unordered_map<std::string, entry> _entries;
+    };
+
+    /* Remembers where included files were found, so that include directories are not searched again for every #include.
+    Lookups are keyed by the included name, the directory of the including file and the include directories.
+    Call invalidate() after adding, moving or removing files. Can be used by multiple preprocessor runs at once. */
+    class include_cache
+    {
+    public:
+        /* If remember_missing is true, files which were not found are cached as well and stay missing until invalidate()
+        is called. Otherwise they are searched again on every lookup, so that newly created files are found. */
+        include_cache(bool remember_missing = false);
+
+        /* Returns the canonical path of an included file, or an empty path if it was not found.
+        The include directories are searched before the directory of the including file, the last matching directory wins. */
+        files::path resolve(const files::path& name, const files::path& including_directory, const std::vector<files::path>& include_directories);
+
+        /* Forgets all resolved and missing files. */
+        void invalidate();
+
+    private:
+        const bool _remember_missing;
+        std::mutex _mutex;
+        std::unordered_map<std::string, files::path> _entries;
+    };
+}
@@ -0,0 +1,68 @@
+/*******************************************************************************/
+/* File     capabilities.hpp
+/* Author   Johannes Braun
+/* Created  17.10.2026
+/*
+/* Description of the OpenGL implementation shaders are preprocessed for.
+/*******************************************************************************/
+
+#pragma once
+
+#include "preprocess.hpp"
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace glshader::process
+{
+    /* A set of extension names. Names from the Khronos registry are stored as one bit each, so inserting and looking
+    them up costs a single hash. Other names are kept in a small sorted set. */
+    class extension_set
+    {
+    public:
+        void insert(std::string_view name);
+        /* Adds all extensions of another set. */
+        void merge(const extension_set& other);
+        bool contains(std::string_view name) const noexcept;
+
+        size_t size() const noexcept;
+        bool empty() const noexcept;
+        void clear() noexcept;
+
+        /* Returns all names, the registry ones first in registry order. */
+        std::vector<std::string> names() const;
+
+    private:
+        std::vector<uint64_t> _known;
+        size_t _known_count = 0;
+        std::set<std::string, std::less<>> _other;
+    };
+
+    /* Everything the preprocessor needs to know about an OpenGL implementation. When passed through
+    preprocess_info_base::gl_capabilities, preprocessing does not load or call any GL functions, so it works
+    without a context, e.g. on headless build machines. Can be built by hand, captured from a context or loaded from a file. */
+    struct capabilities
+    {
+        uint32_t version = 0;                               /* OpenGL version in integral form (e.g. 450 for 4.5) or 0 if unknown. */
+        std::string vendor;                                 /* The GL_VENDOR string. */
+        std::string renderer;                               /* The GL_RENDERER string. */
+        bool named_line_directives = false;                 /* Write file names into #line directives, which only some drivers (e.g. NVIDIA) accept. */
+        extension_set extensions;                           /* All available extensions, which are treated as defined in #if conditions. */
+
+        bool has_extension(std::string_view name) const;
+
+        /* Captures the capabilities of the GL context current on this thread.
+        Returns nullopt if no context is current or the GL functions cannot be loaded. */
+        static std::optional<capabilities> current();
+
+        /* Loads capabilities written by save. Returns nullopt if the file cannot be read or is malformed. */
+        static std::optional<capabilities> load(const files::path& path);
+
+        /* Writes the capabilities into a text file with one "key value" pair per line. Returns false on failure. */
+        bool save(const files::path& path) const;
+    };
+}
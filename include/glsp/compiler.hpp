@@ -10,9 +10,12 @@
 #pragma once
 
 #include "glsp.hpp"
+#include <memory>
 
 namespace glshader::process
 {
+    namespace impl::cache { class manifest; class pack; }
+
     /* Pack a 4-byte char sequence into a uint32_t. Used in binary file section markers and format tags. */
     constexpr uint32_t make_tag(const char name[4])
     {
@@ -26,6 +29,13 @@ namespace glshader::process
         spirv       = make_tag("SPRV")      /* Use SPIR-V format. NOT SUPPORTED AT THE MOMENT! */
     };
 
+    /* How compiled binaries are stored in the cache directory. */
+    enum class cache_layout
+    {
+        files,      /* One <content_hash>.<extension> file per binary. */
+        pack        /* All binaries in <cache_dir>/binaries<extension>.pack, which is memory-mapped and only appended to. */
+    };
+
     /* The resulting binary shader data. */
     struct shader_binary
     {
@@ -36,16 +46,20 @@ namespace glshader::process
     /* A wrapper class containing state information about compiling shaders.
     Derives from glsp::state and can therefore preprocess and compile shader files.
     Additionally to the state class, you can set file extensions for the cached binary files,
-    which will be saved into the cache directory with their filename being their text-format-shader's source path's hash value.
+    which will be saved into the cache directory with their filename being a 128 bit hash of their content: the preprocessed code,
+    the prefix and postfix, the shader stage and the driver. Shaders with equal code share one binary.
     There is also the option to set a prefix and a postfix for OpenGL shaders. This might be useful if you wish for 
     all shaders to have the same #version and #extension declarations, as well as layout(bindless_<object>) uniform; declarations. */
     class compiler : public glsp::state
     {
     public:
         /* A compiler constructed with this constructor will in it's unchanged state save binaries in the following path:
-        <cache_dir>/<shader_path_hash>.<extension> 
+        <cache_dir>/<content_hash>.<extension> 
+        <cache_dir>/cache.manifest records the macros each shader reads, which binaries were compiled for which of their values,
+        and the files they depend on. It is loaded once and kept in memory.
         If passed a file extension not starting with a '.', it will be prepended.*/
         compiler(const std::string& extension, const glsp::files::path& cache_dir);
+        ~compiler();
 
         /* Replace the file extension with which binaries will be saved. */
         void set_extension(const std::string& ext);
@@ -53,6 +67,24 @@ namespace glshader::process
         /* Set the directory in which compiled binaries will be saved and from where they will be loaded. */
         void set_cache_dir(const glsp::files::path& dir);
 
+        /* Choose between one file per binary, which is the default, and a single pack file. Many small files are slow to open
+        on some file systems, while the pack is opened once and read through a memory mapping. Binaries are not moved
+        when switching. */
+        void set_cache_layout(cache_layout layout);
+
+        /* Removes replaced binaries and old indices from the pack file. This also happens automatically when they take up
+        more than half of it. */
+        void compact_cache();
+
+        /* Limit the cache to at most max_bytes of binaries and at most max_entries binaries. Whenever a new binary is stored,
+        the least recently used other ones are removed until both limits are met again. A limit of 0, the default, means no limit. */
+        void set_cache_budget(uint64_t max_bytes, size_t max_entries = 0);
+
+        /* Removes cached binaries of shaders or includes which no longer exist, binaries no longer referenced by the
+        manifest, and binaries of earlier cache versions. The pack file is compacted afterwards. Binaries which other processes
+        sharing the directory are compiling at the same time may be removed as well. */
+        void collect_garbage();
+
         /* Set a common source code prefix for all compiled shaders. This will NOT be preprocessed! */
         void set_default_prefix(const std::string& prefix);
 
@@ -61,13 +93,33 @@ namespace glshader::process
 
         /* Preprocess, compile, save and return binary data of the given shader file. If force_reload is set to false, the binary file already exists
         and the internal time stamp matches the shader's last editing time, the binary file will be loaded and returned directly instead. 
-        The parameters "includes" and "definitions" can add special include paths and definitions for this one compilation process. */
+        The parameters "includes" and "definitions" can add special include paths and definitions for this one compilation process.
+        Definitions the shader does not read, directly or through its includes, do not cause another binary to be compiled. */
         shader_binary compile(const glsp::files::path& shader, format format, bool force_reload = false, std::vector<glsp::files::path> includes ={}, std::vector<glsp::definition> definitions ={});
 
+        /* Between these calls, every file a cached binary depends on is checked for changes only once, however many shaders
+        include it. Outside of them, every call to compile checks the dependencies of its shader again. */
+        void begin_validation();
+        void end_validation();
+
+        /* Publishes pending changes of the binary pack and writes the cache manifest, so that other processes sharing the cache directory see
+        which binaries have been compiled. This happens in end_validation, when the cache directory, layout or extension
+        change and on destruction, but not after every compilation. */
+        void flush_cache();
+
     private:
+        /* Loads the manifest and pack of the cache directory if they are not loaded yet. */
+        void open_cache();
+
         std::string _default_prefix;
         std::string _default_postfix;
         std::string _extension;
         glsp::files::path _cache_dir;
+        cache_layout _layout = cache_layout::files;
+        std::unique_ptr<impl::cache::manifest> _manifest;
+        std::unique_ptr<impl::cache::pack> _pack;
+        bool _validating = false;
+        uint64_t _max_bytes = 0;
+        size_t _max_entries = 0;
     };
 }
\ No newline at end of file
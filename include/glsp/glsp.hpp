@@ -10,6 +10,12 @@
 
 #include "config.hpp"
 #include "preprocess.hpp"
+#include "output.hpp"
+#include "cache.hpp"
+#include "batch.hpp"
+#include "capabilities.hpp"
+#include "source_buffer.hpp"
+#include "source_map.hpp"
 #include "compiler.hpp"
 #include "definition.hpp"
 #include "huffman.hpp"
\ No newline at end of file
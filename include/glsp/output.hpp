@@ -0,0 +1,53 @@
+/*******************************************************************************/
+/* File     output.hpp
+/* Author   Johannes Braun
+/* Created  17.10.2026
+/*
+/* Output sinks receiving the processed shader code while it is generated.
+/*******************************************************************************/
+
+#pragma once
+
+#include "preprocess.hpp"
+#include <fstream>
+#include <functional>
+#include <string_view>
+
+namespace glshader::process
+{
+    /* Base class for all receivers of processed shader code. The preprocessor writes the code in contiguous chunks
+    in the order in which it is generated. If a sink is used, processed_file::contents will stay empty. */
+    class output_sink
+    {
+    public:
+        virtual ~output_sink() = default;
+
+        /* Receives the next chunk of processed code. The data is only valid during this call. */
+        virtual void write(const char* data, size_t length) = 0;
+    };
+
+    /* Forwards every chunk of processed code to a user-defined function. */
+    class callback_sink : public output_sink
+    {
+    public:
+        callback_sink(std::function<void(std::string_view)> callback);
+        void write(const char* data, size_t length) override;
+
+    private:
+        std::function<void(std::string_view)> _callback;
+    };
+
+    /* Writes all processed code into a file, which will be truncated when constructing the sink. */
+    class file_sink : public output_sink
+    {
+    public:
+        file_sink(const files::path& path);
+        void write(const char* data, size_t length) override;
+
+        /* Returns false if the file could not be opened or written. */
+        bool good() const noexcept;
+
+    private:
+        std::ofstream _file;
+    };
+}
@@ -8,6 +8,7 @@
 
 #include "definition.hpp"
 #include "config.hpp"
+#include "source_map.hpp"
 
 #if defined(__GNUC__) && __GNUC__ < 8
     #include <experimental/filesystem>
@@ -15,6 +16,7 @@
     #include <filesystem>
 #endif
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
@@ -29,6 +31,12 @@ namespace process {
         namespace files = std::filesystem;
     #endif
 
+    class output_sink;
+    class condition_cache;
+    class file_cache;
+    class include_cache;
+    struct capabilities;
+
     /* Refers to in-shader version declaration profile, e.g. #version 450 core/compatibility */
     enum class shader_profile
     {
@@ -55,7 +63,11 @@ namespace process {
         std::map<std::string, definition_info> definitions; /* All definitions which have been defined in the shader without being undefined afterwards. */
         std::string contents;                               /* The fully processed shader code string. */
         int error_count = 0;                                /* The number of syntax errors that occurred while preprocessing. */
+        std::vector<std::string> diagnostics;               /* The messages of all syntax errors in the order in which they occurred. */
         bool minified = false;                              /* Generate the smallest possible code footprint. */
+        source_map map;                                     /* Maps the contents back to the source files, if requested with preprocess_info_base::generate_source_map. */
+        size_t dead_code_bytes = 0;                         /* The number of bytes removed by preprocess_info_base::eliminate_dead_code. */
+        std::vector<std::string> macro_reads;               /* With preprocess_info_base::record_macro_reads, the sorted names of all macros whose predefined value has influenced the result, and of names whose absence has influenced a condition. */
 
         bool valid() const noexcept;                        /* Returns true when the file has been processed successfully, false when there were syntax errors. */
         operator bool() const noexcept;                     /* Returns true when the file has been processed successfully, false when there were syntax errors. */
@@ -66,10 +78,21 @@ namespace process {
       std::vector<definition> definitions = {};          // A list of predefined definitions. 
       bool expand_in_macros = false;                     // Recursively expand preprocessor statements if passed as a definition.
       bool do_minify = false;                            // Generate the shortest possible code and leave out #line directives.
+      bool minify_glsl = false;                          // With do_minify, also remove redundant parentheses and give locals, functions and globals without in, out, uniform, buffer, shared, layout or subroutine qualifiers short names.
+      output_sink* output = nullptr;                     // If set, the processed code is written into this sink instead of processed_file::contents.
+      condition_cache* conditions = nullptr;             // If set, results of #if conditions are shared with other preprocessor runs using the same cache.
+      file_cache* file_contents = nullptr;               // If set, the root file and all included files are loaded through this cache.
+      include_cache* include_paths = nullptr;            // If set, include lookups are shared with other preprocessor runs using the same cache.
+      const capabilities* gl_capabilities = nullptr;     // If set, extensions and the #line style are taken from here instead of the current GL context.
+      bool builtin_definitions = false;                  // Also list __FILE__, __LINE__ and __VERSION__ with their values at the end of the file in processed_file::definitions.
+      bool generate_source_map = false;                  // Record source positions in processed_file::map instead of writing #line directives. Also works with do_minify.
+      bool eliminate_dead_code = false;                  // Remove functions, structs and globals not reachable from main or from in, out, uniform, buffer and other interface declarations. The output is only handed to the sink when complete.
+      bool record_macro_reads = false;                   // Fill processed_file::macro_reads. Runs with the same values for those names give the same result.
     };
 
     struct preprocess_file_info : preprocess_info_base {
-      files::path file_path; // The source file to load.
+      files::path file_path;   // The source file to load.
+      bool memory_map = false; // Map the file and all included files read-only into memory and process them in place instead of reading them.
     };
 
     struct preprocess_source_info : preprocess_info_base {
@@ -96,17 +119,17 @@ namespace process {
 
 
     /* Customizable function which is called when a syntax error was detected.
-    You can redefine ERR_OUTPUT(str) in config.h. */
-    inline void syntax_error_print(const files::path& file, const int line, const std::string& reason)
-    {
-        ERR_OUTPUT("Error in " + file.string() + ":" + std::to_string(line) + ": " + reason);
-    }
+    You can redefine ERR_OUTPUT(str) in config.h. While a file is preprocessed on the calling thread, the message is
+    also added to its processed_file::diagnostics. */
+    void syntax_error_print(const files::path& file, const int line, const std::string& reason);
 
     /* A preprocessor state holding include directories and definitions.
     Can be used as a global default for when processing shaders, or as a slightly more flexible way to add definitions and include directories. */
     class state
     {
     public:
+        state();
+
         /* Add a persistent definition. */
         void add_definition(const definition& d);
         /* Remove a persistent definition by it's name (without parameters, ect.!). */
@@ -117,6 +140,19 @@ namespace process {
         /* Remove a persistent include directory. */
         void remove_include_dir(const files::path& dir);
 
+        /* Set the cache through which all files are loaded, unless another one is given in the info struct.
+        Every state uses its own file_cache by default. Pass nullptr to always read files from disk. */
+        void set_file_cache(std::shared_ptr<file_cache> cache);
+        /* Returns the current file cache, which may be shared with other states. */
+        const std::shared_ptr<file_cache>& get_file_cache() const noexcept;
+
+        /* Set the cache used to find included files, unless another one is given in the info struct.
+        States have no include_cache by default and search the include directories for every #include, so that added
+        or moved files are found without invalidating anything. */
+        void set_include_cache(std::shared_ptr<include_cache> cache);
+        /* Returns the current include cache, which may be shared with other states. */
+        const std::shared_ptr<include_cache>& get_include_cache() const noexcept;
+
         /* Stacks all persistent include directories and definitions onto the ones passed as parameters (Therefore the need to copy),
         and calls the global glsp::preprocess_file function. */
         [[deprecated]] processed_file preprocess_file(const files::path& file_path, std::vector<files::path> include_directories ={}, std::vector<definition> definitions ={});
@@ -136,5 +172,7 @@ namespace process {
     protected:
         std::vector<files::path> _include_directories;
         std::vector<definition> _definitions;
+        std::shared_ptr<file_cache> _file_cache;
+        std::shared_ptr<include_cache> _include_cache;
     };
 }}
\ No newline at end of file
@@ -0,0 +1,54 @@
+/*******************************************************************************/
+/* File     source_buffer.hpp
+/* Author   Johannes Braun
+/* Created  17.10.2026
+/*
+/* Read-only shader sources, either read into memory or mapped from disk.
+/*******************************************************************************/
+
+#pragma once
+
+#include "preprocess.hpp"
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace glshader::process
+{
+    /* The immutable contents of a source file. The byte after the last character is always a readable '\0',
+    but the preprocessor only relies on the bounds given by data() and size(). */
+    class source_buffer
+    {
+    public:
+        /* Reads a file into memory. Returns nullptr if it cannot be opened. */
+        static std::shared_ptr<const source_buffer> read(const files::path& path);
+
+        /* Maps a file read-only into memory, so that it is parsed in place without copying it.
+        Falls back to reading the file if it cannot be mapped, or if its size is a multiple of the page size
+        so that no zero-filled page tail follows it. Returns nullptr if it cannot be opened.
+        The file must not be truncated while it is mapped. */
+        static std::shared_ptr<const source_buffer> map(const files::path& path);
+
+        source_buffer(std::string contents);
+        ~source_buffer();
+
+        source_buffer(const source_buffer&) = delete;
+        source_buffer& operator=(const source_buffer&) = delete;
+
+        const char* data() const noexcept { return _data; }
+        size_t size() const noexcept { return _size; }
+        std::string_view view() const noexcept { return { _data, _size }; }
+
+        /* Returns true if the contents are mapped from disk. */
+        bool mapped() const noexcept { return _mapping != nullptr; }
+
+    private:
+        source_buffer() = default;
+
+        std::string _contents;
+        const char* _data = nullptr;
+        size_t _size = 0;
+        void* _mapping = nullptr;
+        size_t _mapping_size = 0;
+    };
+}
@@ -0,0 +1,87 @@
+/*******************************************************************************/
+/* File     source_map.hpp
+/* Author   Johannes Braun
+/* Created  17.10.2026
+/*
+/* Mapping from processed code back to the original files and lines, as an
+/* alternative to inline #line directives.
+/*******************************************************************************/
+
+#pragma once
+
+#include "config.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace glshader {
+namespace process {
+
+    /* Maps lines and columns of processed code back to the files and lines they came from.
+    The map is a run-length table. A run starts wherever the code stops following the source line by line, e.g. at an include
+    or after a skipped block. Minified code keeps a line break wherever the source line changes, so that every output line
+    maps to a single source line. Runs are stored as delta-encoded variable-length
+    integers, similar to the mappings of JavaScript source maps, so a map takes a few bytes per run. */
+    class source_map
+    {
+    public:
+        /* A position in a source file. The line is 0 if the position is unknown. */
+        struct location
+        {
+            std::string file;
+            int line = 0;
+        };
+
+        /* A decoded run. All lines and columns start at 1. */
+        struct run
+        {
+            int output_line;
+            int output_column;
+            uint32_t file;      /* Index into files(). */
+            int line;
+        };
+
+        source_map() = default;
+        /* Restores a map from its files() and data(), e.g. after shipping it next to minified code. */
+        source_map(std::vector<std::string> files, std::string data);
+
+        /* Starts a new run: the code from the given output line and column on comes from the given file and line, and every
+        following output line from the next source line. Runs have to be added in output order. */
+        void add(int output_line, int output_column, std::string_view file, int line);
+
+        /* Returns the source position of the given output position. */
+        location find(int output_line, int output_column = 1) const;
+
+        /* Replaces positions in an info log of the GLSL compiler or linker with the source positions. The common formats
+        "0(12)" (NVIDIA), "0:12(5)" (Mesa) and "0:12:" (AMD, Intel, Apple) are recognized at the start of a line or after
+        "ERROR: " and "WARNING: ". Only positions in the given source string are rewritten; if the processed code was
+        passed to glShaderSource after other strings, this is its index. Positions without a column are left unchanged if
+        code of several source lines starts on the reported output line. */
+        std::string rewrite_log(std::string_view log, int source_string = 0) const;
+
+        /* Decodes all runs. */
+        std::vector<run> runs() const;
+
+        bool empty() const noexcept;
+        size_t size() const noexcept;                           /* The number of runs. */
+        const std::vector<std::string>& files() const noexcept;
+        const std::string& data() const noexcept;               /* The encoded runs. */
+
+    private:
+        struct cursor
+        {
+            int output_line = 1;
+            int output_column = 1;
+            uint32_t file = 0;
+            int line = 0;
+        };
+
+        std::vector<std::string> _files;
+        std::string _data;
+        size_t _size = 0;
+        cursor _end;            /* The last run. */
+        cursor _before_end;     /* The run before the last one, which the last run is encoded against. */
+        size_t _end_offset = 0; /* The offset of the last run in _data. */
+    };
+}}
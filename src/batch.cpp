@@ -0,0 +1,478 @@
+#include <glsp/batch.hpp>
+#include <glsp/cache.hpp>
+#include <glsp/capabilities.hpp>
+#include <glsp/config.hpp>
+
+#include "compiler/hash128.hpp"
+#include "preprocessor/preprocessor.hpp"
+#include "strings.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+
+namespace glshader::process
+{
+    struct thread_pool::shared_state
+    {
+        /* The jobs a thread still has to run. Taken from the front by the owner and from the back by thieves. */
+        struct job_range
+        {
+            std::mutex mutex;
+            size_t begin = 0;
+            size_t end = 0;
+        };
+
+        std::vector<std::thread> workers;
+        std::unique_ptr<job_range[]> ranges;
+        size_t thread_count = 1;
+
+        std::mutex run_mutex;                               /* Held for the whole duration of a run. */
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+        const std::function<void(size_t)>* job = nullptr;
+        uint64_t run_id = 0;                                /* Incremented for every run, so that workers see new work. */
+        size_t active_workers = 0;
+        bool stop = false;
+        std::exception_ptr error;
+
+        /* The pool whose jobs the current thread is running, if any. */
+        static thread_local const shared_state* running;
+
+        bool pop(size_t thread, size_t& index)
+        {
+            job_range& range = ranges[thread];
+            std::lock_guard<std::mutex> lock(range.mutex);
+            if (range.begin == range.end)
+                return false;
+            index = range.begin++;
+            return true;
+        }
+
+        bool steal(size_t thread)
+        {
+            for (size_t offset = 1; offset < thread_count; ++offset)
+            {
+                job_range& victim = ranges[(thread + offset) % thread_count];
+                size_t begin, end;
+                {
+                    std::lock_guard<std::mutex> lock(victim.mutex);
+                    if (victim.begin == victim.end)
+                        continue;
+                    begin = victim.begin + (victim.end - victim.begin) / 2;
+                    end = victim.end;
+                    victim.end = begin;
+                }
+                job_range& own = ranges[thread];
+                std::lock_guard<std::mutex> lock(own.mutex);
+                own.begin = begin;
+                own.end = end;
+                return true;
+            }
+            return false;
+        }
+
+        void work(size_t thread)
+        {
+            const shared_state* const outer = running;
+            running = this;
+            size_t index;
+            for (;;)
+            {
+                if (!pop(thread, index))
+                {
+                    // Stolen jobs may be stolen again before popping them, so only stop when nothing is left anywhere.
+                    if (!steal(thread))
+                        break;
+                    continue;
+                }
+                try
+                {
+                    (*job)(index);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!error)
+                        error = std::current_exception();
+                }
+            }
+            running = outer;
+        }
+
+        void worker_main(size_t thread)
+        {
+            uint64_t last_run = 0;
+            for (;;)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wake.wait(lock, [&] { return stop || run_id != last_run; });
+                    if (stop)
+                        return;
+                    last_run = run_id;
+                }
+                work(thread);
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--active_workers == 0)
+                    done.notify_one();
+            }
+        }
+    };
+
+    thread_local const thread_pool::shared_state* thread_pool::shared_state::running = nullptr;
+
+    thread_pool::thread_pool(size_t thread_count)
+        : _state(std::make_unique<shared_state>())
+    {
+        if (thread_count == 0)
+            thread_count = std::max(1u, std::thread::hardware_concurrency());
+        _state->thread_count = thread_count;
+        _state->ranges = std::make_unique<shared_state::job_range[]>(thread_count);
+        _state->workers.reserve(thread_count - 1);
+        for (size_t thread = 1; thread < thread_count; ++thread)
+            _state->workers.emplace_back([state = _state.get(), thread] { state->worker_main(thread); });
+    }
+
+    thread_pool::~thread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_state->mutex);
+            _state->stop = true;
+        }
+        _state->wake.notify_all();
+        for (auto& worker : _state->workers)
+            worker.join();
+    }
+
+    size_t thread_pool::thread_count() const noexcept
+    {
+        return _state->thread_count;
+    }
+
+    void thread_pool::run(size_t count, const std::function<void(size_t)>& job)
+    {
+        if (count == 0)
+            return;
+
+        if (shared_state::running == _state.get())
+        {
+            // A job of this pool would wait for its own run to finish, so nested runs use only the calling thread.
+            std::exception_ptr error;
+            for (size_t index = 0; index < count; ++index)
+            {
+                try
+                {
+                    job(index);
+                }
+                catch (...)
+                {
+                    if (!error)
+                        error = std::current_exception();
+                }
+            }
+            if (error)
+                std::rethrow_exception(error);
+            return;
+        }
+
+        std::lock_guard<std::mutex> run_lock(_state->run_mutex);
+        const size_t threads = _state->thread_count;
+        for (size_t thread = 0; thread < threads; ++thread)
+        {
+            std::lock_guard<std::mutex> lock(_state->ranges[thread].mutex);
+            _state->ranges[thread].begin = thread * count / threads;
+            _state->ranges[thread].end = (thread + 1) * count / threads;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_state->mutex);
+            _state->job = &job;
+            _state->error = nullptr;
+            _state->active_workers = threads - 1;
+            ++_state->run_id;
+        }
+        _state->wake.notify_all();
+
+        _state->work(0);
+
+        std::exception_ptr error;
+        {
+            std::unique_lock<std::mutex> lock(_state->mutex);
+            _state->done.wait(lock, [&] { return _state->active_workers == 0; });
+            _state->job = nullptr;
+            std::swap(error, _state->error);
+        }
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    batch_executor thread_pool::executor() noexcept
+    {
+        return [this](size_t count, const std::function<void(size_t)>& job) { run(count, job); };
+    }
+
+    namespace {
+        /* Caches and capabilities for the runs of a batch which do not bring their own. */
+        class batch_environment
+        {
+        public:
+            /* Workers have no context current, so infos without capabilities use the ones of the calling thread's context. */
+            explicit batch_environment(bool capture_current)
+                : _current(capture_current ? capabilities::current() : std::nullopt)
+            {
+                if (!_current)
+                    _current.emplace();
+            }
+
+            void prepare(preprocess_info_base& info)
+            {
+                if (!info.conditions)
+                    info.conditions = &_conditions;
+                if (!info.file_contents)
+                    info.file_contents = &_files;
+                if (!info.include_paths)
+                    info.include_paths = &_include_paths;
+                if (!info.gl_capabilities)
+                    info.gl_capabilities = &*_current;
+            }
+
+        private:
+            std::optional<capabilities> _current;
+            condition_cache _conditions;
+            file_cache _files;
+            include_cache _include_paths;
+        };
+
+        void run_jobs(size_t count, const std::function<void(size_t)>& job, const batch_executor& executor)
+        {
+            if (executor)
+            {
+                executor(count, job);
+            }
+            else
+            {
+                static thread_pool default_pool;
+                default_pool.run(count, job);
+            }
+        }
+    }
+
+    std::vector<processed_file> preprocess_batch(const preprocess_file_info* infos, size_t count, const batch_executor& executor)
+    {
+        impl::run_settings settings;
+        settings.forward_errors = false;
+
+        batch_environment environment(std::any_of(infos, infos + count, [](const preprocess_file_info& info) { return !info.gl_capabilities; }));
+        std::vector<preprocess_file_info> jobs(infos, infos + count);
+        for (auto& job : jobs)
+            environment.prepare(job);
+
+        std::vector<processed_file> results(count);
+        run_jobs(count, [&](size_t index) { results[index] = impl::preprocess(jobs[index], settings); }, executor);
+
+        for (const auto& result : results)
+            for (const auto& message : result.diagnostics)
+                ERR_OUTPUT(message);
+        return results;
+    }
+
+    std::vector<processed_file> preprocess_batch(const std::vector<preprocess_file_info>& infos, const batch_executor& executor)
+    {
+        return preprocess_batch(infos.data(), infos.size(), executor);
+    }
+
+    namespace {
+        bool same_result(const processed_file& a, const processed_file& b)
+        {
+            return a.contents == b.contents && a.version == b.version && a.profile == b.profile && a.dependencies == b.dependencies
+                && a.extensions == b.extensions && a.diagnostics == b.diagnostics;
+        }
+
+        /* Hashes everything compared by same_result. */
+        impl::hash::hash128 result_hash(const processed_file& file)
+        {
+            impl::hash::hasher128 hasher;
+            hasher.update_string(file.contents);
+            hasher.update_value(file.version);
+            hasher.update_value(file.profile);
+            hasher.update_value(file.dependencies.size());
+            for (const auto& dependency : file.dependencies)
+                hasher.update_string(dependency.string());
+            hasher.update_value(file.extensions.size());
+            for (const auto& [name, behavior] : file.extensions)
+            {
+                hasher.update_string(name);
+                hasher.update_value(behavior);
+            }
+            hasher.update_value(file.diagnostics.size());
+            for (const auto& message : file.diagnostics)
+                hasher.update_string(message);
+            return hasher.finish();
+        }
+
+        /* Axes may be looked up without influencing the result, e.g. the operands of "defined(A) && defined(B)" while A is
+        not defined. Two selections of the same variant which only differ in one of the axes they depend on do not depend on
+        it, and are merged until no such pairs are left. */
+        void merge_selections(std::vector<permutation_set::selection>& selections)
+        {
+            for (bool merged = true; merged;)
+            {
+                merged = false;
+                std::map<std::tuple<size_t, uint64_t, uint64_t>, size_t> lookup;
+                for (size_t i = 0; i < selections.size(); ++i)
+                    lookup.emplace(std::make_tuple(selections[i].variant, selections[i].depends_on, selections[i].defined & selections[i].depends_on), i);
+
+                std::vector<bool> removed(selections.size(), false);
+                std::vector<bool> changed(selections.size(), false);
+                for (size_t i = 0; i < selections.size(); ++i)
+                {
+                    permutation_set::selection& s = selections[i];
+                    for (uint64_t axes = s.depends_on; axes != 0 && !removed[i] && !changed[i]; axes &= axes - 1)
+                    {
+                        const uint64_t bit = axes & ~(axes - 1);
+                        const auto it = lookup.find(std::make_tuple(s.variant, s.depends_on, (s.defined ^ bit) & s.depends_on));
+                        if (it == lookup.end() || removed[it->second] || changed[it->second])
+                            continue;
+                        removed[it->second] = true;
+                        changed[i] = true;
+                        s.depends_on &= ~bit;
+                        s.defined &= ~bit;
+                        merged = true;
+                    }
+                }
+
+                size_t kept = 0;
+                for (size_t i = 0; i < selections.size(); ++i)
+                    if (!removed[i])
+                        selections[kept++] = selections[i];
+                selections.resize(kept);
+            }
+        }
+
+        template<typename Info>
+        permutation_set process_permutations(const Info& info, const std::vector<definition>& axes, const batch_executor& executor)
+        {
+            permutation_set result;
+            result.axes = axes;
+
+            // Combinations are 64 bit masks.
+            if (axes.size() > 64)
+            {
+                ++result.permutations.emplace_back().file.error_count;
+                result.selections.push_back({ 0, 0, 0 });
+                syntax_error_print("Preprocessor", 0, strfmt(strings::serr_too_many_axes, axes.size()));
+                return result;
+            }
+
+            batch_environment environment(!info.gl_capabilities);
+            Info base = info;
+            base.output = nullptr;
+            environment.prepare(base);
+
+            impl::run_settings settings;
+            settings.forward_errors = false;
+            for (const auto& axis : axes)
+                settings.watched_names.push_back(axis.name);
+
+            // A set of combinations still to be processed: the axes in "fixed" are defined as in "defined", all other
+            // axes may have any value. Each set is processed with its free axes undefined.
+            struct combinations
+            {
+                uint64_t fixed;
+                uint64_t defined;
+            };
+
+            // Runs with equal results share one variant, whichever axes they have read. Results are only compared in
+            // full when their hashes are equal.
+            std::unordered_map<impl::hash::hash128, std::vector<size_t>, impl::hash::hash128_hash> variants_by_hash;
+            std::vector<combinations> pending{ { 0, 0 } };
+            while (!pending.empty())
+            {
+                std::vector<permutation_set::selection> runs(pending.size());
+                std::vector<processed_file> files(pending.size());
+                run_jobs(pending.size(), [&](size_t index) {
+                    impl::run_settings job_settings = settings;
+                    for (size_t axis = 0; axis < axes.size(); ++axis)
+                        if (pending[index].defined >> axis & 1)
+                            job_settings.definitions.push_back(axes[axis]);
+                    job_settings.watched_reads = &runs[index].depends_on;
+                    runs[index].defined = pending[index].defined;
+                    files[index] = impl::preprocess(base, job_settings);
+                }, executor);
+
+                // The result holds for all combinations agreeing in the axes which were looked up. The other ones in the
+                // set are split by the first looked up axis in which they differ, and processed in the next round.
+                std::vector<combinations> next;
+                for (size_t index = 0; index < pending.size(); ++index)
+                {
+                    permutation_set::selection& run = runs[index];
+                    uint64_t fixed = pending[index].fixed;
+                    const uint64_t free_reads = run.depends_on & ~fixed;
+                    for (size_t axis = 0; axis < axes.size(); ++axis)
+                    {
+                        const uint64_t bit = uint64_t(1) << axis;
+                        if (!(free_reads & bit))
+                            continue;
+                        next.push_back({ fixed | bit, pending[index].defined | bit });
+                        fixed |= bit;
+                    }
+
+                    run.defined &= run.depends_on;
+                    auto& candidates = variants_by_hash[result_hash(files[index])];
+                    const auto same = std::find_if(candidates.begin(), candidates.end(), [&](size_t variant) {
+                        return same_result(result.permutations[variant].file, files[index]);
+                    });
+                    if (same != candidates.end())
+                    {
+                        run.variant = *same;
+                    }
+                    else
+                    {
+                        run.variant = result.permutations.size();
+                        candidates.push_back(run.variant);
+                        result.permutations.emplace_back().file = std::move(files[index]);
+                    }
+                    result.selections.push_back(run);
+                }
+                pending = std::move(next);
+            }
+
+            merge_selections(result.selections);
+            for (const auto& selection : result.selections)
+                result.permutations[selection.variant].depends_on |= selection.depends_on;
+            for (const auto& variant : result.permutations)
+                for (const auto& message : variant.file.diagnostics)
+                    ERR_OUTPUT(message);
+            return result;
+        }
+    }
+
+    const permutation& permutation_set::find(uint64_t combination) const
+    {
+        const auto it = std::find_if(selections.begin(), selections.end(), [&](const selection& s) {
+            return ((combination ^ s.defined) & s.depends_on) == 0;
+        });
+        // Every combination is covered by a selection.
+        assert(it != selections.end());
+        return permutations[it->variant];
+    }
+
+    permutation_set preprocess_permutations(const preprocess_file_info& info, const std::vector<definition>& axes, const batch_executor& executor)
+    {
+        return process_permutations(info, axes, executor);
+    }
+
+    permutation_set preprocess_permutations(const preprocess_source_info& info, const std::vector<definition>& axes, const batch_executor& executor)
+    {
+        return process_permutations(info, axes, executor);
+    }
+}
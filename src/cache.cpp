@@ -0,0 +1,114 @@
+#include <glsp/cache.hpp>
+
+#include "preprocessor/conditions.hpp"
+#include "preprocessor/input.hpp"
+
+namespace glshader::process
+{
+    condition_cache::condition_cache()
+        : _storage(std::make_unique<impl::conditions::storage>())
+    {
+
+    }
+
+    condition_cache::~condition_cache() = default;
+
+    void condition_cache::evict(const files::path& file)
+    {
+        _storage->evict(file);
+    }
+
+    void condition_cache::clear()
+    {
+        _storage->clear();
+    }
+
+    file_cache::file_cache(bool check_modification)
+        : _check_modification(check_modification)
+    {
+
+    }
+
+    std::shared_ptr<const source_buffer> file_cache::load(const files::path& path, bool memory_map)
+    {
+        const std::string key = path.string();
+        std::error_code error;
+        files::file_time_type modification_time{};
+        uintmax_t size = 0;
+        if (_check_modification)
+        {
+            modification_time = files::last_write_time(path, error);
+            size = error ? 0 : files::file_size(path, error);
+            if (error)
+            {
+                evict(path);
+                return nullptr;
+            }
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (const auto it = _entries.find(key); it != _entries.end()
+                && (!_check_modification || (it->second.modification_time == modification_time && it->second.size == size)))
+                return it->second.contents;
+        }
+
+        // Files are read without holding the lock, so that loading different files is not serialized.
+        auto contents = memory_map ? source_buffer::map(path) : source_buffer::read(path);
+        if (!contents)
+            return nullptr;
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _entries[key] = { contents, modification_time, size };
+        return contents;
+    }
+
+    void file_cache::evict(const files::path& path)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _entries.erase(path.string());
+    }
+
+    void file_cache::clear()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _entries.clear();
+    }
+
+    include_cache::include_cache(bool remember_missing)
+        : _remember_missing(remember_missing)
+    {
+
+    }
+
+    files::path include_cache::resolve(const files::path& name, const files::path& including_directory, const std::vector<files::path>& include_directories)
+    {
+        std::string key = name.string();
+        key += '\0';
+        key += including_directory.string();
+        for (auto&& directory : include_directories)
+        {
+            key += '\0';
+            key += directory.string();
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (const auto it = _entries.find(key); it != _entries.end())
+                return it->second;
+        }
+
+        auto path = impl::input::find_include(name, including_directory, include_directories);
+        if (path.empty() && !_remember_missing)
+            return path;
+        std::unique_lock<std::mutex> lock(_mutex);
+        _entries.emplace(std::move(key), path);
+        return path;
+    }
+
+    void include_cache::invalidate()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _entries.clear();
+    }
+}
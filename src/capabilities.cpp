@@ -0,0 +1,184 @@
+#include <glsp/capabilities.hpp>
+
+#include "opengl/loader.hpp"
+#include "preprocessor/extensions.hpp"
+
+#include <bitset>
+
+#include <fstream>
+
+namespace glshader::process
+{
+    namespace lgl = impl::loader;
+
+    void extension_set::insert(std::string_view name)
+    {
+        if (const uint32_t id = impl::ext::known_id(name); id != impl::ext::unknown_id)
+        {
+            if (_known.empty())
+                _known.resize((impl::ext::known_count() + 63) / 64);
+            uint64_t& word = _known[id / 64];
+            const uint64_t bit = uint64_t(1) << (id % 64);
+            _known_count += (word & bit) ? 0 : 1;
+            word |= bit;
+        }
+        else if (_other.find(name) == _other.end())
+        {
+            _other.emplace(name);
+        }
+    }
+
+    void extension_set::merge(const extension_set& other)
+    {
+        if (!other._known.empty())
+        {
+            if (_known.empty())
+                _known.resize(other._known.size());
+            _known_count = 0;
+            for (size_t i = 0; i < _known.size(); ++i)
+            {
+                _known[i] |= other._known[i];
+                _known_count += std::bitset<64>(_known[i]).count();
+            }
+        }
+        _other.insert(other._other.begin(), other._other.end());
+    }
+
+    bool extension_set::contains(std::string_view name) const noexcept
+    {
+        if (const uint32_t id = impl::ext::known_id(name); id != impl::ext::unknown_id)
+            return !_known.empty() && (_known[id / 64] >> (id % 64) & 1) != 0;
+        return _other.find(name) != _other.end();
+    }
+
+    size_t extension_set::size() const noexcept
+    {
+        return _known_count + _other.size();
+    }
+
+    bool extension_set::empty() const noexcept
+    {
+        return size() == 0;
+    }
+
+    void extension_set::clear() noexcept
+    {
+        _known.clear();
+        _known_count = 0;
+        _other.clear();
+    }
+
+    std::vector<std::string> extension_set::names() const
+    {
+        std::vector<std::string> result;
+        result.reserve(size());
+        for (size_t id = 0; id < _known.size() * 64 && id < impl::ext::known_count(); ++id)
+            if (_known[id / 64] >> (id % 64) & 1)
+                result.emplace_back(impl::ext::known_name(static_cast<uint32_t>(id)));
+        result.insert(result.end(), _other.begin(), _other.end());
+        return result;
+    }
+
+    bool capabilities::has_extension(std::string_view name) const
+    {
+        return extensions.contains(name);
+    }
+
+    std::optional<capabilities> capabilities::current()
+    {
+        constexpr uint32_t VENDOR = 0x1F00;
+        constexpr uint32_t RENDERER = 0x1F01;
+        constexpr uint32_t EXTENSIONS = 0x1F03;
+        constexpr uint32_t MAJOR_VERSION = 0x821B;
+        constexpr uint32_t MINOR_VERSION = 0x821C;
+        constexpr uint32_t NUM_EXTENSIONS = 0x821D;
+
+        lgl::reload();
+        if (!lgl::valid())
+            return std::nullopt;
+
+        const auto glGetIntegerv = reinterpret_cast<void (*)(uint32_t, int*)>(lgl::load_function("glGetIntegerv"));
+        const auto glGetString = reinterpret_cast<const char* (*)(uint32_t)>(lgl::load_function("glGetString"));
+        const auto glGetStringi = reinterpret_cast<const char* (*)(uint32_t, uint32_t)>(lgl::load_function("glGetStringi"));
+        if (!glGetIntegerv || !glGetString || !glGetStringi)
+            return std::nullopt;
+
+        const auto get_string = [&](uint32_t name) {
+            const char* value = glGetString(name);
+            return std::string(value ? value : "");
+        };
+
+        capabilities result;
+        result.vendor = get_string(VENDOR);
+        result.renderer = get_string(RENDERER);
+        result.named_line_directives = result.vendor.find("NVIDIA") != std::string::npos;
+
+        int major = 0;
+        int minor = 0;
+        glGetIntegerv(MAJOR_VERSION, &major);
+        glGetIntegerv(MINOR_VERSION, &minor);
+        result.version = static_cast<uint32_t>(major * 100 + minor * 10);
+
+        int count = 0;
+        glGetIntegerv(NUM_EXTENSIONS, &count);
+        for (int i = 0; i < count; ++i)
+            if (const char* extension = glGetStringi(EXTENSIONS, static_cast<uint32_t>(i)))
+                result.extensions.insert(extension);
+        return result;
+    }
+
+    std::optional<capabilities> capabilities::load(const files::path& path)
+    {
+        std::ifstream file(path);
+        if (!file)
+            return std::nullopt;
+
+        capabilities result;
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (line.empty())
+                continue;
+
+            const auto separator = line.find(' ');
+            const std::string key = line.substr(0, separator);
+            const std::string value = separator == std::string::npos ? "" : line.substr(separator + 1);
+            if (key == "version")
+            {
+                try
+                {
+                    result.version = static_cast<uint32_t>(std::stoul(value));
+                }
+                catch (const std::exception&)
+                {
+                    return std::nullopt;
+                }
+            }
+            else if (key == "vendor")
+                result.vendor = value;
+            else if (key == "renderer")
+                result.renderer = value;
+            else if (key == "named_line_directives")
+                result.named_line_directives = value == "1";
+            else if (key == "extension" && !value.empty())
+                result.extensions.insert(value);
+            else
+                return std::nullopt;
+        }
+        return result;
+    }
+
+    bool capabilities::save(const files::path& path) const
+    {
+        std::ofstream file(path, std::ios::trunc);
+        file << "version " << version << '\n';
+        file << "vendor " << vendor << '\n';
+        file << "renderer " << renderer << '\n';
+        file << "named_line_directives " << (named_line_directives ? 1 : 0) << '\n';
+        for (const auto& extension : extensions.names())
+            file << "extension " << extension << '\n';
+        return file.good();
+    }
+}
@@ -1,11 +1,18 @@
 #include <glsp/compiler.hpp>
 
 #include <glsp/huffman.hpp>
+#include <glsp/output.hpp>
 #include "../opengl/loader.hpp"
 #include "../strings.hpp"
+#include "hash128.hpp"
+#include "interprocess.hpp"
+#include "manifest.hpp"
+#include "pack.hpp"
+#include <algorithm>
 #include <cassert>
 #include <fstream>
-#include <sstream>
+#include <map>
+#include <optional>
 
 namespace glshader::process
 {
@@ -15,7 +22,6 @@ namespace glshader::process
     {
         uint32_t type;
         std::vector<uint8_t> data;
-        std::vector<files::path> dependencies;
         bool success;
     };
 
@@ -28,6 +34,9 @@ namespace glshader::process
     constexpr uint32_t GL_LINK_STATUS               = 0x8B82;
     constexpr uint32_t GL_INFO_LOG_LENGTH           = 0x8B84;
     constexpr uint32_t GL_PROGRAM_BINARY_LENGTH     = 0x8741;
+    constexpr uint32_t GL_VENDOR                    = 0x1F00;
+    constexpr uint32_t GL_RENDERER                  = 0x1F01;
+    constexpr uint32_t GL_VERSION                   = 0x1F02;
 
     namespace {
         uint32_t type_from_extension(const files::path& extension)
@@ -47,7 +56,7 @@ namespace glshader::process
             return 0;
         }
 
-        compiled_shader load_opengl_binary(const files::path & file, uint32_t type, const std::vector<files::path> & includes, const std::vector<definition> & definitions, const std::string & prefix, const std::string & postfix)
+        compiled_shader compile_opengl_binary(const std::string& contents, const source_map& map, uint32_t type, const std::string& prefix, const std::string& postfix)
         {
             thread_local uint32_t(*glCreateShaderProgramv)(uint32_t, int, const char**) = nullptr;
             thread_local void (*glGetProgramiv)(uint32_t, uint32_t, const int*) = nullptr;
@@ -55,11 +64,6 @@ namespace glshader::process
             thread_local void (*glDeleteProgram)(uint32_t) = nullptr;
             thread_local void (*glGetProgramBinary)(uint32_t, int, int*, uint32_t*, void*) = nullptr;
 
-            preprocess_file_info info{
-              includes, definitions, false, false, file
-            };
-            processed_file processed = glsp::preprocess_file(info);
-
             // loader should be initialized by glsp::preprocess_file.
             if (lgl::valid() && !(glCreateShaderProgramv && glGetProgramiv && glGetProgramInfoLog && glDeleteProgram && glGetProgramBinary))
             {
@@ -89,7 +93,7 @@ namespace glshader::process
 
             const char* sources[3] = {
                 prefix.c_str(),
-                processed.contents.c_str(),
+                contents.c_str(),
                 postfix.c_str()
             };
 
@@ -102,7 +106,8 @@ namespace glshader::process
                 std::string log(log_length, ' ');
                 glGetProgramInfoLog(id, log_length, &log_length, log.data());
                 glDeleteProgram(id);
-                syntax_error_print("Linking", 0, log);
+                // The processed code is the second source string, after the prefix.
+                syntax_error_print("Linking", 0, map.rewrite_log(log, 1));
                 result.success = false;
                 return result;
             }
@@ -111,15 +116,26 @@ namespace glshader::process
             result.data.resize(length);
             glGetProgramBinary(id, length, &length, &result.type, result.data.data());
             glDeleteProgram(id);
-            result.dependencies.push_back(file);
-            result.dependencies.insert(result.dependencies.end(), processed.dependencies.begin(), processed.dependencies.end());
+            result.success = true;
             return result;
         }
 
-        std::int64_t last_write_time_int64(const files::path& file)
+        /* Vendor, renderer and version of the current context. A binary can only be loaded by the driver which created it. */
+        std::string driver_identity()
         {
-            const auto file_time = files::last_write_time(file);
-            return file_time.time_since_epoch().count();
+            if (!lgl::valid())
+                lgl::reload();
+            const auto glGetString = reinterpret_cast<const char* (*)(uint32_t)>(lgl::load_function("glGetString"));
+            if (!glGetString)
+                return {};
+
+            std::string identity;
+            for (const uint32_t name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+            {
+                const char* value = glGetString(name);
+                identity.append(value ? value : "").push_back('\n');
+            }
+            return identity;
         }
     }
 
@@ -129,17 +145,81 @@ namespace glshader::process
         set_extension(extension);
     }
 
+    compiler::~compiler()
+    {
+        flush_cache();
+    }
+
     void compiler::set_extension(const std::string& ext)
     {
         assert(ext.length() > 0);
+        // The pack file is named after the extension.
+        flush_cache();
+        _pack.reset();
         _extension = ext[0] == '.' ? ext : ('.' + ext);
     }
 
     void compiler::set_cache_dir(const glsp::files::path& dir)
     {
+        // The manifest and pack of the new directory are loaded with the next compilation.
+        flush_cache();
+        _manifest.reset();
+        _pack.reset();
         _cache_dir = dir;
     }
 
+    void compiler::set_cache_layout(cache_layout layout)
+    {
+        flush_cache();
+        _pack.reset();
+        _layout = layout;
+    }
+
+    void compiler::compact_cache()
+    {
+        if (_layout != cache_layout::pack)
+            return;
+        open_cache();
+        _pack->flush();
+        _pack->compact();
+    }
+
+    void compiler::set_cache_budget(uint64_t max_bytes, size_t max_entries)
+    {
+        _max_bytes = max_bytes;
+        _max_entries = max_entries;
+    }
+
+    void compiler::open_cache()
+    {
+        if (!_manifest)
+            _manifest = std::make_unique<impl::cache::manifest>(files::path(_cache_dir) / "cache.manifest");
+        if (_layout == cache_layout::pack && !_pack)
+            _pack = std::make_unique<impl::cache::pack>(files::path(_cache_dir) / ("binaries" + _extension + ".pack"));
+    }
+
+    void compiler::flush_cache()
+    {
+        // Binaries first, so that the manifest never refers to unpublished ones.
+        if (_pack)
+            _pack->flush();
+        if (_manifest)
+            _manifest->save();
+    }
+
+    void compiler::begin_validation()
+    {
+        if (_manifest)
+            _manifest->next_pass();
+        _validating = true;
+    }
+
+    void compiler::end_validation()
+    {
+        flush_cache();
+        _validating = false;
+    }
+
     void compiler::set_default_prefix(const std::string& prefix)
     {
         _default_prefix = prefix;
@@ -164,136 +244,288 @@ namespace glshader::process
         uint32_t data_tag;              // DATA
     };
 
-    shader_binary compiler::compile(const glsp::files::path& shader, format format, bool force_reload, std::vector<glsp::files::path> includes, std::vector<glsp::definition> definitions)
+    namespace
     {
-        shader_binary result;
-        files::path dst = absolute(shader);
-        auto hash = std::hash<std::string>()(dst.string());
+        using impl::hash::hash128;
+        using impl::hash::hasher128;
+        using impl::cache::write_atomically;
 
-        for (const auto& def : definitions)
+        /* Maps the names of the given definitions, without a trailing "()", to their parameters and replacement.
+        Later definitions replace earlier ones like in the preprocessor. */
+        std::map<std::string, std::string> definition_values(const std::vector<definition>& definitions)
         {
-            hash ^= std::hash<std::string>()(def.info.replacement);
+            std::map<std::string, std::string> values;
+            for (const auto& def : definitions)
+            {
+                std::string name = def.name;
+                std::string value;
+                if (name.size() > 2 && name.compare(name.size() - 2, 2, "()") == 0)
+                {
+                    name.resize(name.size() - 2);
+                    value = "()";
+                }
+                for (const auto& parameter : def.info.parameters)
+                    value.append(parameter).push_back(',');
+                value.append(1, '\n').append(def.info.replacement);
+                values[std::move(name)] = std::move(value);
+            }
+            return values;
         }
 
-        for (const auto& inc : includes)
+        /* Stored behind the binary data, which is only complete if it matches. */
+        hash128 binary_checksum(const shader_file_header& header, const uint8_t* data, size_t size)
         {
-            hash ^= std::hash<std::string>()(inc.string());
+            hasher128 hasher;
+            hasher.update(&header, sizeof(header));
+            hasher.update(data, size);
+            return hasher.finish();
         }
 
-        if (!files::exists(_cache_dir))
+        /* Loads a binary written by compiler::compile and returns the size of its file. Returns nothing if it does not
+        exist or has another format. */
+        std::optional<uint64_t> load_binary(const files::path& file, format format, shader_binary& result)
         {
-            files::create_directories(_cache_dir);
-        }
-        dst = files::path(_cache_dir) / (std::to_string(hash) + _extension);
-        uint32_t internal_format = 0;
+            std::ifstream input(file, std::ios::binary);
+            if (!input)
+                return std::nullopt;
 
-        bool reload = false;
-        if (!force_reload && exists(dst))
-        {
             shader_file_header header;
-            std::ifstream input(dst, std::ios::binary);
             input.read(reinterpret_cast<char*>(&header), sizeof(header));
+            if (!input || header.type != format || header.info_tag != make_tag("INFO") || header.data_tag != make_tag("DATA"))
+                return std::nullopt;
+
+            // Binaries are addressed by their content, the dependencies are kept in the manifest.
+            input.ignore(header.dependencies_length);
+
+            std::basic_string<uint8_t> compressed;
+            compressed.resize(header.binary_length);
+            input.read(reinterpret_cast<char*>(compressed.data()), header.binary_length);
+            hash128 checksum;
+            input.read(reinterpret_cast<char*>(&checksum), sizeof(checksum));
+            if (!input || checksum != binary_checksum(header, compressed.data(), compressed.size()))
+                return std::nullopt;
+
+            result.data = compress::huffman::decode(compressed).to_container<decltype(result.data)>();
+            result.format = header.binary_format;
+            return sizeof(header) + uint64_t(header.dependencies_length) + header.binary_length + sizeof(checksum);
+        }
 
-            if (header.type != format || header.info_tag != make_tag("INFO") || header.data_tag != make_tag("DATA"))
-                reload = true;
+        files::path binary_file(const files::path& cache_dir, const hash128& content_key, const std::string& extension)
+        {
+            return cache_dir / (content_key.hex() + extension);
+        }
 
-            if (!reload)
+        /* Deletes binaries from the pack, if one is used, or else their files. */
+        void remove_binaries(const std::vector<hash128>& content_keys, impl::cache::pack* pack, const files::path& cache_dir, const std::string& extension)
+        {
+            for (const auto& content_key : content_keys)
             {
-                for (int i = 0; i < static_cast<int>(header.dependencies_count); ++i)
-                {
-                    std::int64_t last_write{ 0 };
-                    uint32_t slength{ 0 };
-
-                    input.read(reinterpret_cast<char*>(&last_write), sizeof(last_write));
-                    input.read(reinterpret_cast<char*>(&slength), sizeof(slength));
-                    std::string dep_file;
-                    dep_file.resize(slength);
-                    input.read(dep_file.data(), slength);
-
-                    // Treat missing dependency as non-needed.
-                    if (!files::exists(dep_file))
-                        continue;
-
-                    if (last_write_time_int64(dep_file) != last_write)
-                    {
-                        reload = true;
-                        break;
-                    }
-                }
+                std::error_code error;
+                if (pack)
+                    pack->erase(content_key);
+                else
+                    files::remove(binary_file(cache_dir, content_key, extension), error);
             }
-            if (!reload)
-            {
-                std::basic_string<uint8_t> compressed;
-                compressed.resize(header.binary_length);
-                input.read(reinterpret_cast<char*>(compressed.data()), header.binary_length);
+        }
+    }
+
+    void compiler::collect_garbage()
+    {
+        if (!files::exists(_cache_dir))
+            return;
+        open_cache();
+        _manifest->next_pass();
+
+        const auto stored = [&](const hash128& content_key) {
+            return _pack ? _pack->find(content_key).has_value() : files::exists(binary_file(_cache_dir, content_key, _extension));
+        };
+        remove_binaries(_manifest->collect_garbage(stored), _pack.get(), _cache_dir, _extension);
 
-                result.data = compress::huffman::decode(compressed).to_container<decltype(result.data)>();
-                internal_format = header.binary_format;
-                result.format = header.binary_format;
+        // Binaries the manifest does not know of, e.g. from another cache version or from links which were replaced.
+        if (_pack)
+        {
+            std::vector<hash128> unknown;
+            for (const auto& content_key : _pack->keys())
+            {
+                if (!_manifest->contains(content_key))
+                    unknown.push_back(content_key);
             }
+            remove_binaries(unknown, _pack.get(), _cache_dir, _extension);
         }
         else
         {
-            reload = true;
+            std::error_code error;
+            for (const auto& entry : files::directory_iterator(_cache_dir, error))
+            {
+                const files::path& file = entry.path();
+                if (file.extension() != _extension || !entry.is_regular_file(error))
+                    continue;
+                const auto content_key = hash128::from_hex(file.stem().string());
+                if (!content_key || !_manifest->contains(*content_key))
+                    files::remove(file, error);
+            }
         }
 
-        if (reload)
+        flush_cache();
+        if (_pack)
+            _pack->compact();
+    }
+
+    shader_binary compiler::compile(const glsp::files::path& shader, format format, bool force_reload, std::vector<glsp::files::path> includes, std::vector<glsp::definition> definitions)
+    {
+        shader_binary result;
+        if (format != format::gl_binary)
         {
-            shader_file_header header;
-            header.type = format;
-            header.info_tag = make_tag("INFO");
-            header.data_tag = make_tag("DATA");
-            std::vector<files::path> dependencies;
-
-            includes.insert(includes.end(), _include_directories.begin(), _include_directories.end());
-            definitions.insert(definitions.end(), _definitions.begin(), _definitions.end());
-            switch (header.type)
-            {
-            case format::gl_binary:
-            {
-                compiled_shader compiled = load_opengl_binary(shader, type_from_extension(shader.extension()), includes, definitions, _default_prefix, _default_postfix);
-                result.data = std::move(compiled.data);
-                dependencies = std::move(compiled.dependencies);
-                internal_format = compiled.type;
-                result.format = internal_format;
-            } break;
-            case format::spirv:
+            if (format == format::spirv)
                 syntax_error_print("Loader", 0, strfmt(strings::serr_unsupported, "SPIR-V"));
-            default:
-                result.data.clear();
-                return result;
-            }
+            return result;
+        }
 
-            std::stringstream buf;
-            for (auto dep : dependencies)
+        includes.insert(includes.end(), _include_directories.begin(), _include_directories.end());
+        definitions.insert(definitions.end(), _definitions.begin(), _definitions.end());
+        const uint32_t stage = type_from_extension(shader.extension());
+        const std::string driver = driver_identity();
+
+        hasher128 shader_hasher;
+        shader_hasher.update_string(absolute(shader).string());
+        for (const auto& inc : includes)
+            shader_hasher.update_string(inc.string());
+        const hash128 shader_key = shader_hasher.finish();
+
+        // Everything apart from the preprocessed code which ends up in the binary.
+        hasher128 environment;
+        environment.update_value(format);
+        environment.update_value(stage);
+        environment.update_string(driver);
+        environment.update_string(_default_prefix);
+        environment.update_string(_default_postfix);
+
+        const std::map<std::string, std::string> values = definition_values(definitions);
+        const auto input_key = [&](const std::vector<std::string>& macro_reads) {
+            hasher128 input = environment;
+            input.update_value(shader_key);
+            for (const auto& name : macro_reads)
             {
-                std::int64_t t = last_write_time_int64(dep);
-                auto str = dep.string();
-                uint32_t len = static_cast<uint32_t>(str.length());
-                buf.write(reinterpret_cast<const char*>(&t), sizeof(t));
-                buf.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                buf.write(str.data(), str.length());
+                input.update_string(name);
+                const auto it = values.find(name);
+                input.update_value(it != values.end());
+                if (it != values.end())
+                    input.update_string(it->second);
             }
+            return input.finish();
+        };
+        const auto binary_path = [&](const hash128& content_key) {
+            return binary_file(_cache_dir, content_key, _extension);
+        };
 
-            auto deps = buf.str();
+        if (!files::exists(_cache_dir))
+        {
+            files::create_directories(_cache_dir);
+        }
+        open_cache();
+        if (!_validating)
+            _manifest->next_pass();
 
-            const std::vector<uint8_t> compressed =  compress::huffman::encode(result.data).to_container<decltype(compressed)>();
-            header.version = 100;
-            header.dependencies_length = static_cast<uint32_t>(deps.size());
-            header.dependencies_count = static_cast<uint32_t>(dependencies.size());
-            header.binary_format = internal_format;
-            header.binary_length = static_cast<uint32_t>(compressed.size());
+        const auto load = [&](const hash128& content_key) {
+            if (!_pack)
+            {
+                const auto size = load_binary(binary_path(content_key), format, result);
+                if (size)
+                    _manifest->use(content_key, *size);
+                return size.has_value();
+            }
+            const auto payload = _pack->find(content_key);
+            if (!payload || payload->format != static_cast<uint32_t>(format))
+                return false;
+            // Decoded straight from the mapped pack file.
+            result.data = compress::huffman::decode(payload->data, payload->size).to_container<decltype(result.data)>();
+            result.format = payload->binary_format;
+            _manifest->use(content_key, payload->size);
+            return true;
+        };
+
+        if (!force_reload)
+        {
+            for (const auto& names : _manifest->read_sets(shader_key))
+            {
+                if (const auto content_key = _manifest->find(input_key(names)); content_key && load(*content_key))
+                    return result;
+            }
+        }
 
-            if (!result.data.empty())
+        // The code is hashed while it is generated. Equal code reached through another shader or other definitions shares its binary.
+        hasher128 content = environment;
+        std::string contents;
+        callback_sink sink([&](std::string_view chunk) {
+            contents.append(chunk);
+            content.update(chunk.data(), chunk.size());
+        });
+        preprocess_file_info info{
+          { includes, definitions }, shader
+        };
+        info.generate_source_map = true;
+        info.record_macro_reads = true;
+        info.output = &sink;
+        const processed_file processed = glsp::preprocess_file(info);
+        content.update_value(static_cast<uint64_t>(contents.size()));
+        const hash128 content_key = content.finish();
+
+        if (force_reload || !load(content_key))
+        {
+            // Another process compiling the same code is waited for, and its binary is used instead of compiling it again.
+            files::path lock_file = binary_path(content_key);
+            lock_file += ".lock";
+            const impl::cache::file_lock lock(lock_file);
+            if (_pack)
+                _pack->refresh();
+            if (force_reload || !load(content_key))
             {
-                std::ofstream out(dst, std::ios::binary);
-                out.write(reinterpret_cast<const char*>(&header), sizeof(header));
-                out.write(deps.data(), deps.size());
-                out.write(reinterpret_cast<const char*>(compressed.data()), compressed.size());
-                out.close();
+                compiled_shader compiled = compile_opengl_binary(contents, processed.map, stage, _default_prefix, _default_postfix);
+                if (!compiled.success || compiled.data.empty())
+                {
+                    result.data.clear();
+                    return result;
+                }
+                result.data = std::move(compiled.data);
+                result.format = compiled.type;
+
+                const std::vector<uint8_t> compressed =  compress::huffman::encode(result.data).to_container<decltype(compressed)>();
+                if (_pack)
+                {
+                    // Published before the lock is released, so that waiting processes find it.
+                    _pack->insert(content_key, static_cast<uint32_t>(format), result.format, compressed);
+                    _pack->flush();
+                    _manifest->use(content_key, compressed.size());
+                }
+                else
+                {
+                    shader_file_header header;
+                    header.type = format;
+                    header.info_tag = make_tag("INFO");
+                    header.data_tag = make_tag("DATA");
+                    header.version = 100;
+                    header.dependencies_length = 0;
+                    header.dependencies_count = 0;
+                    header.binary_format = result.format;
+                    header.binary_length = static_cast<uint32_t>(compressed.size());
+
+                    const hash128 checksum = binary_checksum(header, compressed.data(), compressed.size());
+                    write_atomically(binary_path(content_key), [&](std::ostream& out) {
+                        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                        out.write(reinterpret_cast<const char*>(compressed.data()), compressed.size());
+                        out.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+                    });
+                    _manifest->use(content_key, sizeof(header) + compressed.size() + sizeof(checksum));
+                }
             }
         }
 
+        std::vector<files::path> dependencies{ absolute(shader) };
+        dependencies.insert(dependencies.end(), processed.dependencies.begin(), processed.dependencies.end());
+        _manifest->insert(shader_key, processed.macro_reads, input_key(processed.macro_reads), content_key, dependencies);
+        // The manifest is only marked as changed here. Saving it merges and rewrites the whole file, so that is left to flush_cache.
+        remove_binaries(_manifest->evict(_max_bytes, _max_entries, content_key), _pack.get(), _cache_dir, _extension);
+
         return result;
     }
-}
\ No newline at end of file
+}
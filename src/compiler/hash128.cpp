@@ -0,0 +1,138 @@
+#include "hash128.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace glshader::process::impl::hash
+{
+    namespace
+    {
+        constexpr uint64_t c1 = 0x87c37b91114253d5ull;
+        constexpr uint64_t c2 = 0x4cf5ad432745937full;
+
+        constexpr uint64_t rotl(uint64_t x, int r) noexcept
+        {
+            return (x << r) | (x >> (64 - r));
+        }
+
+        constexpr uint64_t fmix(uint64_t k) noexcept
+        {
+            k ^= k >> 33;
+            k *= 0xff51afd7ed558ccdull;
+            k ^= k >> 33;
+            k *= 0xc4ceb9fe1a85ec53ull;
+            k ^= k >> 33;
+            return k;
+        }
+    }
+
+    std::string hash128::hex() const
+    {
+        constexpr char digits[] = "0123456789abcdef";
+        std::string result(32, '0');
+        for (int i = 0; i < 16; ++i)
+        {
+            result[15 - i] = digits[(high >> (4 * i)) & 0xf];
+            result[31 - i] = digits[(low >> (4 * i)) & 0xf];
+        }
+        return result;
+    }
+
+    std::optional<hash128> hash128::from_hex(std::string_view str)
+    {
+        if (str.size() != 32)
+            return std::nullopt;
+
+        hash128 result;
+        for (size_t i = 0; i < 32; ++i)
+        {
+            const char c = str[i];
+            uint64_t digit;
+            if (c >= '0' && c <= '9')
+                digit = c - '0';
+            else if (c >= 'a' && c <= 'f')
+                digit = c - 'a' + 10;
+            else
+                return std::nullopt;
+            uint64_t& half = i < 16 ? result.high : result.low;
+            half = (half << 4) | digit;
+        }
+        return result;
+    }
+
+    void hasher128::block(const uint8_t* data)
+    {
+        uint64_t k1;
+        uint64_t k2;
+        std::memcpy(&k1, data, sizeof(k1));
+        std::memcpy(&k2, data + 8, sizeof(k2));
+
+        k1 *= c1; k1 = rotl(k1, 31); k1 *= c2; _h1 ^= k1;
+        _h1 = rotl(_h1, 27); _h1 += _h2; _h1 = _h1 * 5 + 0x52dce729;
+
+        k2 *= c2; k2 = rotl(k2, 33); k2 *= c1; _h2 ^= k2;
+        _h2 = rotl(_h2, 31); _h2 += _h1; _h2 = _h2 * 5 + 0x38495ab5;
+    }
+
+    void hasher128::update(const void* data, size_t length)
+    {
+        auto bytes = static_cast<const uint8_t*>(data);
+        _length += length;
+
+        if (_tail_size != 0)
+        {
+            const size_t fill = std::min(sizeof(_tail) - _tail_size, length);
+            std::memcpy(_tail + _tail_size, bytes, fill);
+            _tail_size += fill;
+            bytes += fill;
+            length -= fill;
+            if (_tail_size < sizeof(_tail))
+                return;
+            block(_tail);
+            _tail_size = 0;
+        }
+
+        for (; length >= 16; bytes += 16, length -= 16)
+            block(bytes);
+
+        std::memcpy(_tail, bytes, length);
+        _tail_size = length;
+    }
+
+    void hasher128::update_string(std::string_view str)
+    {
+        update_value(static_cast<uint64_t>(str.size()));
+        update(str.data(), str.size());
+    }
+
+    hash128 hasher128::finish() const
+    {
+        uint64_t h1 = _h1;
+        uint64_t h2 = _h2;
+        uint64_t k1 = 0;
+        uint64_t k2 = 0;
+
+        for (size_t i = _tail_size; i > 8; --i)
+            k2 ^= uint64_t(_tail[i - 1]) << (8 * (i - 9));
+        if (_tail_size > 8)
+        {
+            k2 *= c2; k2 = rotl(k2, 33); k2 *= c1; h2 ^= k2;
+        }
+        for (size_t i = std::min<size_t>(_tail_size, 8); i > 0; --i)
+            k1 ^= uint64_t(_tail[i - 1]) << (8 * (i - 1));
+        if (_tail_size > 0)
+        {
+            k1 *= c1; k1 = rotl(k1, 31); k1 *= c2; h1 ^= k1;
+        }
+
+        h1 ^= _length;
+        h2 ^= _length;
+        h1 += h2;
+        h2 += h1;
+        h1 = fmix(h1);
+        h2 = fmix(h2);
+        h1 += h2;
+        h2 += h1;
+        return { h1, h2 };
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace glshader::process::impl::hash
+{
+    /* A 128 bit hash value. */
+    struct hash128
+    {
+        uint64_t low = 0;
+        uint64_t high = 0;
+
+        /* Returns the value as 32 lowercase hexadecimal digits, e.g. for file names. */
+        std::string hex() const;
+
+        /* Parses a value written by hex(). Returns nothing for anything but 32 hexadecimal digits. */
+        static std::optional<hash128> from_hex(std::string_view str);
+
+        friend bool operator==(const hash128& a, const hash128& b) noexcept { return a.low == b.low && a.high == b.high; }
+        friend bool operator!=(const hash128& a, const hash128& b) noexcept { return !(a == b); }
+    };
+
+    /* Hash functor for unordered containers. The value is already well distributed. */
+    struct hash128_hash
+    {
+        size_t operator()(const hash128& value) const noexcept { return static_cast<size_t>(value.low); }
+    };
+
+    /* Incremental 128 bit MurmurHash3 (x64 variant). Data can be added in chunks of any size, the result is the same
+    as when hashing all of it at once. */
+    class hasher128
+    {
+    public:
+        void update(const void* data, size_t length);
+
+        /* Adds the length of the string before its characters, so that consecutive strings cannot be confused with each other. */
+        void update_string(std::string_view str);
+
+        template<typename T>
+        void update_value(const T& value) { update(&value, sizeof(value)); }
+
+        /* Returns the hash of everything added so far. More data can still be added afterwards. */
+        hash128 finish() const;
+
+    private:
+        void block(const uint8_t* data);
+
+        uint64_t _h1 = 0;
+        uint64_t _h2 = 0;
+        uint64_t _length = 0;
+        uint8_t _tail[16];
+        size_t _tail_size = 0;
+    };
+}
@@ -0,0 +1,127 @@
+#include "interprocess.hpp"
+
+#include <atomic>
+#include <fstream>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace glshader::process::impl::cache
+{
+    namespace
+    {
+        unsigned long process_id() noexcept
+        {
+#ifdef _WIN32
+            return GetCurrentProcessId();
+#else
+            return static_cast<unsigned long>(getpid());
+#endif
+        }
+    }
+
+    file_lock::file_lock(files::path file)
+        : _file(std::move(file))
+    {
+#ifdef _WIN32
+        // The file is deleted when the last handle is closed. Until then, opening it again can fail for a short moment.
+        for (int tries = 0; tries < 1000; ++tries)
+        {
+            const HANDLE handle = CreateFileW(_file.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+            if (handle == INVALID_HANDLE_VALUE)
+            {
+                if (GetLastError() != ERROR_ACCESS_DENIED)
+                    return;
+                Sleep(1);
+                continue;
+            }
+
+            OVERLAPPED overlapped{};
+            if (LockFileEx(handle, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &overlapped))
+                _handle = handle;
+            else
+                CloseHandle(handle);
+            return;
+        }
+#else
+        // The previous owner removes the file when releasing it, so a waiting process may end up locking a file which is
+        // no longer in place. The lock only counts if the path still refers to the locked file.
+        while (true)
+        {
+            const int handle = open(_file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+            if (handle == -1)
+                return;
+
+            int result;
+            do
+                result = flock(handle, LOCK_EX);
+            while (result == -1 && errno == EINTR);
+
+            struct stat locked, current;
+            if (result == 0 && fstat(handle, &locked) == 0 && stat(_file.c_str(), &current) == 0
+                && locked.st_dev == current.st_dev && locked.st_ino == current.st_ino)
+            {
+                _handle = handle;
+                return;
+            }
+            close(handle);
+            if (result != 0)
+                return;
+        }
+#endif
+    }
+
+    file_lock::~file_lock()
+    {
+#ifdef _WIN32
+        if (!_handle)
+            return;
+        OVERLAPPED overlapped{};
+        UnlockFileEx(_handle, 0, 1, 0, &overlapped);
+        CloseHandle(_handle);
+#else
+        if (_handle == -1)
+            return;
+        // Removed while still locked, so that nobody can lock it in between.
+        unlink(_file.c_str());
+        close(_handle);
+#endif
+    }
+
+    bool write_atomically(const files::path& file, const std::function<void(std::ostream&)>& write, const std::function<void()>& before_rename)
+    {
+        // Unique among all processes and all writers within this one.
+        static std::atomic<uint32_t> counter{ 0 };
+        files::path temporary = file;
+        temporary += "." + std::to_string(process_id()) + "." + std::to_string(counter++) + ".tmp";
+
+        bool written;
+        {
+            std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+            write(out);
+            out.close();
+            written = !out.fail();
+        }
+
+        std::error_code error;
+        if (written)
+        {
+            if (before_rename)
+                before_rename();
+            files::rename(temporary, file, error);
+            if (!error)
+                return true;
+        }
+        files::remove(temporary, error);
+        return false;
+    }
+}
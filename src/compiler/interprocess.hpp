@@ -0,0 +1,36 @@
+#pragma once
+
+#include <glsp/preprocess.hpp>
+
+#include <functional>
+#include <ostream>
+
+namespace glshader::process::impl::cache
+{
+    /* Advisory lock shared by all processes using the same path. Blocks until the lock is acquired, and releases it when
+    destroyed. The lock file only exists while the lock is held or waited for. If the file cannot be created, nothing is
+    locked and the caller proceeds unprotected. */
+    class file_lock
+    {
+    public:
+        explicit file_lock(files::path file);
+        ~file_lock();
+
+        file_lock(const file_lock&) = delete;
+        file_lock& operator=(const file_lock&) = delete;
+
+    private:
+        files::path _file;
+#ifdef _WIN32
+        void* _handle = nullptr;
+#else
+        int _handle = -1;
+#endif
+    };
+
+    /* Writes a file under a temporary name next to it and renames it into place, so that readers either see the old file or
+    the complete new one. before_rename is called once the temporary file is complete, e.g. to release a mapping of the old
+    file, which cannot be replaced on Windows otherwise. Returns false if writing or renaming failed, in which case the file
+    is left untouched. */
+    bool write_atomically(const files::path& file, const std::function<void(std::ostream&)>& write, const std::function<void()>& before_rename = nullptr);
+}
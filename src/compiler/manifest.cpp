@@ -0,0 +1,468 @@
+#include "manifest.hpp"
+#include "interprocess.hpp"
+
+#include <glsp/compiler.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <unordered_set>
+
+namespace glshader::process::impl::cache
+{
+    namespace
+    {
+        /* Most recently seen sets of read macro names per shader which are tried when looking for a binary. */
+        constexpr size_t max_read_sets = 16;
+        /* Most recently used links from inputs to binaries kept per shader. */
+        constexpr size_t max_links = 64;
+
+        constexpr uint32_t manifest_version = 2;
+
+        template<typename T>
+        void write_value(std::ostream& out, const T& value)
+        {
+            out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+
+        template<typename T>
+        T read_value(std::istream& in)
+        {
+            T value{};
+            in.read(reinterpret_cast<char*>(&value), sizeof(value));
+            return value;
+        }
+
+        void write_string(std::ostream& out, const std::string& str)
+        {
+            write_value(out, static_cast<uint32_t>(str.size()));
+            out.write(str.data(), str.size());
+        }
+
+        /* Reads a count of elements taking at least min_size bytes each. If the rest of the file cannot hold them, the stream
+        fails and 0 is returned, so that a damaged file cannot cause huge allocations. */
+        uint32_t read_count(std::istream& in, uint64_t file_size, uint64_t min_size)
+        {
+            const uint32_t count = read_value<uint32_t>(in);
+            const auto position = in.tellg();
+            if (!in || position < 0 || static_cast<uint64_t>(position) > file_size
+                || count > (file_size - static_cast<uint64_t>(position)) / min_size)
+            {
+                in.setstate(std::ios::failbit);
+                return 0;
+            }
+            return count;
+        }
+
+        std::string read_string(std::istream& in, uint64_t file_size)
+        {
+            std::string str(read_count(in, file_size, 1), '\0');
+            in.read(str.data(), str.size());
+            return str;
+        }
+    }
+
+    manifest::manifest(files::path file)
+        : _file(std::move(file))
+    {
+        load();
+    }
+
+    void manifest::next_pass() noexcept
+    {
+        ++_pass;
+    }
+
+    const std::vector<std::vector<std::string>>& manifest::read_sets(const hash128& shader) const
+    {
+        static const std::vector<std::vector<std::string>> none;
+        const auto it = _shaders.find(shader);
+        return it == _shaders.end() ? none : it->second.read_sets;
+    }
+
+    std::optional<hash128> manifest::find(const hash128& input)
+    {
+        const auto it = _links.find(input);
+        if (it == _links.end())
+            return std::nullopt;
+
+        for (const auto& [id, recorded] : it->second.dependencies)
+        {
+            // Treat missing dependency as non-needed.
+            const std::int64_t current = last_write(id);
+            if (current != missing && current != recorded)
+                return std::nullopt;
+        }
+        return it->second.content;
+    }
+
+    void manifest::insert(const hash128& shader, const std::vector<std::string>& macro_reads, const hash128& input, const hash128& content,
+        const std::vector<files::path>& dependencies)
+    {
+        shader_entry& entry = _shaders[shader];
+
+        // The most recent entries are tried first.
+        if (const auto it = std::find(entry.read_sets.begin(), entry.read_sets.end(), macro_reads); it != entry.read_sets.end())
+            entry.read_sets.erase(it);
+        entry.read_sets.insert(entry.read_sets.begin(), macro_reads);
+        if (entry.read_sets.size() > max_read_sets)
+            entry.read_sets.resize(max_read_sets);
+
+        link& l = _links[input];
+        _removed_links.erase(input);
+        l.content = content;
+        l.dependencies.clear();
+        for (const auto& path : dependencies)
+        {
+            const uint32_t id = dependency_id(path.string());
+            // The files have just been read, so they are checked again instead of relying on this pass.
+            _dependencies[id].checked_pass = 0;
+            l.dependencies.emplace_back(id, last_write(id));
+        }
+
+        if (const auto it = std::find(entry.links.begin(), entry.links.end(), input); it != entry.links.end())
+            entry.links.erase(it);
+        entry.links.insert(entry.links.begin(), input);
+        for (size_t i = max_links; i < entry.links.size(); ++i)
+        {
+            _links.erase(entry.links[i]);
+            _removed_links.insert(entry.links[i]);
+        }
+        if (entry.links.size() > max_links)
+            entry.links.resize(max_links);
+
+        _changed = true;
+    }
+
+    void manifest::use(const hash128& content, uint64_t size)
+    {
+        _removed.erase(content);
+        const auto [it, inserted] = _binaries.emplace(content, binary{});
+        if (!inserted)
+            _bytes -= it->second.size;
+        it->second.size = size;
+        it->second.last_use = ++_uses;
+        _bytes += size;
+        _changed = true;
+    }
+
+    bool manifest::contains(const hash128& content) const
+    {
+        return _binaries.count(content) != 0;
+    }
+
+    std::vector<hash128> manifest::evict(uint64_t max_bytes, size_t max_entries, const hash128& keep)
+    {
+        const auto over_budget = [&](size_t entries, uint64_t bytes) {
+            return (max_entries != 0 && entries > max_entries) || (max_bytes != 0 && bytes > max_bytes);
+        };
+        if (!over_budget(_binaries.size(), _bytes))
+            return {};
+
+        std::vector<std::pair<uint64_t, hash128>> by_use;
+        by_use.reserve(_binaries.size());
+        for (const auto& [content, b] : _binaries)
+        {
+            if (content != keep)
+                by_use.emplace_back(b.last_use, content);
+        }
+        std::sort(by_use.begin(), by_use.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+        std::vector<hash128> evicted;
+        size_t entries = _binaries.size();
+        uint64_t bytes = _bytes;
+        for (const auto& [last_use, content] : by_use)
+        {
+            if (!over_budget(entries, bytes))
+                break;
+            evicted.push_back(content);
+            --entries;
+            bytes -= _binaries.at(content).size;
+        }
+        remove(evicted);
+        return evicted;
+    }
+
+    std::vector<hash128> manifest::collect_garbage(const std::function<bool(const hash128&)>& stored)
+    {
+        // Binaries which other processes have linked since this manifest was loaded are not garbage.
+        merge(manifest(_file));
+
+        std::vector<hash128> lost;
+        for (const auto& [content, b] : _binaries)
+        {
+            if (!stored(content))
+                lost.push_back(content);
+        }
+        remove(lost);
+
+        for (auto& [shader, entry] : _shaders)
+        {
+            const auto stale = [&](const hash128& input) {
+                const link& l = _links.at(input);
+                return std::any_of(l.dependencies.begin(), l.dependencies.end(), [&](const auto& dep) { return last_write(dep.first) == missing; });
+            };
+            const auto first = std::stable_partition(entry.links.begin(), entry.links.end(), [&](const hash128& input) { return !stale(input); });
+            for (auto it = first; it != entry.links.end(); ++it)
+            {
+                _links.erase(*it);
+                _removed_links.insert(*it);
+            }
+            if (first != entry.links.end())
+                _changed = true;
+            entry.links.erase(first, entry.links.end());
+        }
+        for (auto it = _shaders.begin(); it != _shaders.end();)
+            it = it->second.links.empty() ? _shaders.erase(it) : std::next(it);
+
+        std::unordered_set<hash128, hash::hash128_hash> linked;
+        for (const auto& [input, l] : _links)
+            linked.insert(l.content);
+        std::vector<hash128> unused;
+        for (const auto& [content, b] : _binaries)
+        {
+            if (linked.count(content) == 0)
+                unused.push_back(content);
+        }
+        remove(unused);
+        return unused;
+    }
+
+    void manifest::merge(const manifest& other)
+    {
+        for (const auto& [shader, theirs] : other._shaders)
+        {
+            shader_entry& ours = _shaders[shader];
+            for (const auto& names : theirs.read_sets)
+            {
+                if (ours.read_sets.size() < max_read_sets && std::find(ours.read_sets.begin(), ours.read_sets.end(), names) == ours.read_sets.end())
+                    ours.read_sets.push_back(names);
+            }
+
+            // Own links stay in front, links to binaries removed by this process are not taken back.
+            for (const auto& input : theirs.links)
+            {
+                const link& l = other._links.at(input);
+                if (ours.links.size() >= max_links)
+                    break;
+                if (_removed.count(l.content) != 0 || _removed_links.count(input) != 0 || _links.count(input) != 0)
+                    continue;
+
+                link& copy = _links[input];
+                copy.content = l.content;
+                for (const auto& [id, last_write] : l.dependencies)
+                    copy.dependencies.emplace_back(dependency_id(other._dependencies[id].path), last_write);
+                ours.links.push_back(input);
+            }
+            if (ours.links.empty())
+                _shaders.erase(shader);
+        }
+
+        for (const auto& [content, b] : other._binaries)
+        {
+            if (_removed.count(content) == 0 && _binaries.emplace(content, b).second)
+                _bytes += b.size;
+        }
+        _uses = std::max(_uses, other._uses);
+    }
+
+    void manifest::remove(const std::vector<hash128>& binaries)
+    {
+        if (binaries.empty())
+            return;
+
+        const std::unordered_set<hash128, hash::hash128_hash> removed(binaries.begin(), binaries.end());
+        _removed.insert(removed.begin(), removed.end());
+        for (const auto& content : removed)
+        {
+            if (const auto it = _binaries.find(content); it != _binaries.end())
+            {
+                _bytes -= it->second.size;
+                _binaries.erase(it);
+            }
+        }
+        for (auto& [shader, entry] : _shaders)
+        {
+            const auto first = std::remove_if(entry.links.begin(), entry.links.end(), [&](const hash128& input) {
+                const auto it = _links.find(input);
+                if (it == _links.end() || removed.count(it->second.content) == 0)
+                    return false;
+                _removed_links.insert(input);
+                _links.erase(it);
+                return true;
+            });
+            entry.links.erase(first, entry.links.end());
+        }
+        _changed = true;
+    }
+
+    uint32_t manifest::dependency_id(const std::string& path)
+    {
+        const auto [it, inserted] = _dependency_ids.emplace(path, static_cast<uint32_t>(_dependencies.size()));
+        if (inserted)
+            _dependencies.push_back({ path });
+        return it->second;
+    }
+
+    std::int64_t manifest::last_write(uint32_t id)
+    {
+        dependency& dep = _dependencies[id];
+        if (dep.checked_pass != _pass)
+        {
+            std::error_code error;
+            const auto time = files::last_write_time(dep.path, error);
+            dep.last_write = error ? missing : static_cast<std::int64_t>(time.time_since_epoch().count());
+            dep.checked_pass = _pass;
+        }
+        return dep.last_write;
+    }
+
+    void manifest::load()
+    {
+        std::error_code error;
+        const uint64_t file_size = files::file_size(_file, error);
+        std::ifstream input(_file, std::ios::binary);
+        if (error || !input || read_value<uint32_t>(input) != make_tag("MNFS") || read_value<uint32_t>(input) != manifest_version)
+            return;
+
+        // Minimum sizes of the elements following each count.
+        constexpr uint64_t string_size = sizeof(uint32_t);
+        constexpr uint64_t link_size = 2 * sizeof(hash128) + sizeof(uint32_t);
+        constexpr uint64_t dependency_size = sizeof(uint32_t) + sizeof(std::int64_t);
+
+        std::vector<uint32_t> ids(read_count(input, file_size, string_size));
+        for (auto& id : ids)
+            id = dependency_id(read_string(input, file_size));
+
+        const uint32_t shader_count = read_value<uint32_t>(input);
+        for (uint32_t s = 0; s < shader_count && input; ++s)
+        {
+            shader_entry& entry = _shaders[read_value<hash128>(input)];
+            entry.read_sets.resize(read_count(input, file_size, sizeof(uint32_t)));
+            for (auto& names : entry.read_sets)
+            {
+                names.resize(read_count(input, file_size, string_size));
+                for (auto& name : names)
+                    name = read_string(input, file_size);
+            }
+
+            entry.links.resize(read_count(input, file_size, link_size));
+            for (auto& input_key : entry.links)
+            {
+                input_key = read_value<hash128>(input);
+                link& l = _links[input_key];
+                l.content = read_value<hash128>(input);
+                l.dependencies.resize(read_count(input, file_size, dependency_size));
+                for (auto& [id, last_write] : l.dependencies)
+                {
+                    const uint32_t index = read_value<uint32_t>(input);
+                    id = index < ids.size() ? ids[index] : 0;
+                    last_write = read_value<std::int64_t>(input);
+                    if (index >= ids.size())
+                        input.setstate(std::ios::failbit);
+                }
+                if (!input)
+                    break;
+            }
+        }
+
+        _uses = read_value<uint64_t>(input);
+        const uint32_t binary_count = read_value<uint32_t>(input);
+        for (uint32_t b = 0; b < binary_count && input; ++b)
+        {
+            const hash128 content = read_value<hash128>(input);
+            binary& entry = _binaries[content];
+            entry.size = read_value<uint64_t>(input);
+            entry.last_use = read_value<uint64_t>(input);
+            _bytes += entry.size;
+        }
+
+        // A truncated file is treated like a missing one.
+        if (!input)
+        {
+            _dependencies.clear();
+            _dependency_ids.clear();
+            _links.clear();
+            _shaders.clear();
+            _binaries.clear();
+            _uses = 0;
+            _bytes = 0;
+        }
+    }
+
+    void manifest::save()
+    {
+        if (!_changed)
+            return;
+
+        // Other processes sharing the cache directory may have saved their own links since this one was loaded.
+        files::path lock_file = _file;
+        lock_file += ".lock";
+        const file_lock lock(lock_file);
+        merge(manifest(_file));
+
+        // Only dependencies which are still used are written, numbered in the order of their first use.
+        std::vector<uint32_t> ids(_dependencies.size(), ~uint32_t(0));
+        std::vector<uint32_t> used;
+        for (const auto& [input, l] : _links)
+        {
+            for (const auto& dep : l.dependencies)
+            {
+                if (ids[dep.first] == ~uint32_t(0))
+                {
+                    ids[dep.first] = static_cast<uint32_t>(used.size());
+                    used.push_back(dep.first);
+                }
+            }
+        }
+
+        const bool written = write_atomically(_file, [&](std::ostream& out) {
+            write_value(out, make_tag("MNFS"));
+            write_value(out, manifest_version);
+            write_value(out, static_cast<uint32_t>(used.size()));
+            for (const uint32_t id : used)
+                write_string(out, _dependencies[id].path);
+
+            write_value(out, static_cast<uint32_t>(_shaders.size()));
+            for (const auto& [shader, entry] : _shaders)
+            {
+                write_value(out, shader);
+                write_value(out, static_cast<uint32_t>(entry.read_sets.size()));
+                for (const auto& names : entry.read_sets)
+                {
+                    write_value(out, static_cast<uint32_t>(names.size()));
+                    for (const auto& name : names)
+                        write_string(out, name);
+                }
+
+                write_value(out, static_cast<uint32_t>(entry.links.size()));
+                for (const auto& input : entry.links)
+                {
+                    const link& l = _links.at(input);
+                    write_value(out, input);
+                    write_value(out, l.content);
+                    write_value(out, static_cast<uint32_t>(l.dependencies.size()));
+                    for (const auto& [id, last_write] : l.dependencies)
+                    {
+                        write_value(out, ids[id]);
+                        write_value(out, last_write);
+                    }
+                }
+            }
+
+            write_value(out, _uses);
+            write_value(out, static_cast<uint32_t>(_binaries.size()));
+            for (const auto& [content, b] : _binaries)
+            {
+                write_value(out, content);
+                write_value(out, b.size);
+                write_value(out, b.last_use);
+            }
+        });
+        if (written)
+        {
+            _changed = false;
+            _removed.clear();
+            _removed_links.clear();
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <glsp/preprocess.hpp>
+#include "hash128.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <unordered_set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace glshader::process::impl::cache
+{
+    using hash::hash128;
+
+    /* In-memory index of a binary cache directory, loaded once from a single file. It links the input key of a
+    compilation to the content key of its binary, and remembers which macros each shader reads, so that the input key
+    can be computed without preprocessing. Files are stored once in a shared dependency table, so a file included by
+    many shaders is only checked once per validation pass. The size and last use of every binary are tracked to keep the
+    cache within a budget. */
+    class manifest
+    {
+    public:
+        /* Loads the manifest from a file. A missing or damaged file gives an empty manifest. */
+        explicit manifest(files::path file);
+
+        /* Starts a new validation pass, in which every dependency is checked again when it is used for the first time. */
+        void next_pass() noexcept;
+
+        /* Returns the sets of macro names the shader has read, the most recent one first. */
+        const std::vector<std::vector<std::string>>& read_sets(const hash128& shader) const;
+
+        /* Returns the content key recorded for the input key, unless one of its dependencies has changed since. */
+        std::optional<hash128> find(const hash128& input);
+
+        /* Records that a shader has been compiled from the given input into the given content, reading the given macros
+        and files. */
+        void insert(const hash128& shader, const std::vector<std::string>& macro_reads, const hash128& input, const hash128& content,
+            const std::vector<files::path>& dependencies);
+
+        /* Records that a binary with the given size has been stored or loaded. */
+        void use(const hash128& content, uint64_t size);
+
+        /* Returns true if the binary is known, i.e. it has been stored or loaded and not removed since. */
+        bool contains(const hash128& content) const;
+
+        /* Removes the least recently used binaries other than keep, and all links to them, until there are at most
+        max_entries binaries with at most max_bytes together. A limit of 0 means no limit. Returns the removed binaries. */
+        std::vector<hash128> evict(uint64_t max_bytes, size_t max_entries, const hash128& keep);
+
+        /* Forgets binaries which are no longer stored, removes all links to them or with a dependency which no longer
+        exists, and returns the binaries no link refers to anymore. */
+        std::vector<hash128> collect_garbage(const std::function<bool(const hash128&)>& stored);
+
+        /* Writes the manifest into its file if it has changed since it was loaded or last saved. Links which other
+        processes have saved in the meantime are kept, and readers never see a partially written file. */
+        void save();
+
+    private:
+        /* Last write time of a missing file, which is not compared. */
+        static constexpr std::int64_t missing = INT64_MIN;
+
+        struct dependency
+        {
+            std::string path;
+            std::int64_t last_write = missing;  /* As seen in the pass checked_pass. */
+            uint64_t checked_pass = 0;
+        };
+
+        struct link
+        {
+            hash128 content;
+            std::vector<std::pair<uint32_t, std::int64_t>> dependencies;   /* Dependency ids and their last write time at compilation. */
+        };
+
+        struct shader_entry
+        {
+            std::vector<std::vector<std::string>> read_sets;
+            std::vector<hash128> links;         /* Input keys, the most recent one first. */
+        };
+
+        struct binary
+        {
+            uint64_t size = 0;
+            uint64_t last_use = 0;              /* Value of the use counter when the binary was last stored or loaded. */
+        };
+
+        uint32_t dependency_id(const std::string& path);
+        std::int64_t last_write(uint32_t dependency);
+        void load();
+        /* Adds the links and binaries of another manifest of the same file which this one does not know. */
+        void merge(const manifest& other);
+        /* Removes all binaries in the set together with the links to them. */
+        void remove(const std::vector<hash128>& binaries);
+
+        files::path _file;
+        bool _changed = false;
+        uint64_t _pass = 1;
+
+        std::vector<dependency> _dependencies;
+        std::unordered_map<std::string, uint32_t> _dependency_ids;
+        std::unordered_map<hash128, link, hash::hash128_hash> _links;
+        std::unordered_map<hash128, shader_entry, hash::hash128_hash> _shaders;
+        std::unordered_map<hash128, binary, hash::hash128_hash> _binaries;
+        uint64_t _uses = 0;
+        uint64_t _bytes = 0;
+        /* Binaries and links removed since the last save, which are not merged back. */
+        std::unordered_set<hash128, hash::hash128_hash> _removed;
+        std::unordered_set<hash128, hash::hash128_hash> _removed_links;
+    };
+}
@@ -0,0 +1,367 @@
+#include "pack.hpp"
+#include "interprocess.hpp"
+
+#include <glsp/compiler.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace glshader::process::impl::cache
+{
+    namespace
+    {
+        constexpr uint32_t pack_version = 2;
+
+        bool key_less(const hash128& a, const hash128& b) noexcept
+        {
+            return a.high < b.high || (a.high == b.high && a.low < b.low);
+        }
+
+        /* The index is read in place, so it starts at an offset suitable for its 64 bit members. */
+        uint64_t index_alignment(uint64_t offset) noexcept
+        {
+            return (8 - offset % 8) % 8;
+        }
+
+        /* Stored right behind the index. Covers the header fields pointing to it, so that a header which is read while being
+        rewritten does not match. */
+        hash128 index_checksum(uint64_t index_offset, uint64_t index_count, const void* index, uint64_t index_size)
+        {
+            hash::hasher128 hasher;
+            hasher.update_value(index_offset);
+            hasher.update_value(index_count);
+            hasher.update(index, static_cast<size_t>(index_size));
+            return hasher.finish();
+        }
+    }
+
+    pack::pack(files::path file)
+        : _file(std::move(file))
+    {
+        map();
+    }
+
+    pack::~pack()
+    {
+        unmap();
+    }
+
+    files::path pack::lock_file() const
+    {
+        files::path file = _file;
+        file += ".lock";
+        return file;
+    }
+
+    void pack::map()
+    {
+        // A damaged file is tried again in case it was only seen in the middle of a header update.
+        for (int tries = 0; tries < 3 && !try_map(); ++tries)
+            ;
+    }
+
+    bool pack::try_map()
+    {
+        unmap();
+#ifdef _WIN32
+        const HANDLE file = CreateFileW(_file.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return true;
+
+        LARGE_INTEGER size;
+        if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+        {
+            if (const HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr))
+            {
+                _mapping = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                _mapping_size = _mapping ? static_cast<size_t>(size.QuadPart) : 0;
+                CloseHandle(mapping);
+            }
+        }
+        CloseHandle(file);
+#else
+        const int file = open(_file.c_str(), O_RDONLY);
+        if (file == -1)
+            return true;
+
+        struct stat status;
+        if (fstat(file, &status) == 0 && status.st_size > 0)
+        {
+            void* const mapping = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_SHARED, file, 0);
+            if (mapping != MAP_FAILED)
+            {
+                _mapping = mapping;
+                _mapping_size = static_cast<size_t>(status.st_size);
+            }
+        }
+        close(file);
+#endif
+        if (!_mapping || _mapping_size < sizeof(header))
+        {
+            unmap();
+            return false;
+        }
+
+        // Anything not pointing into the file makes the whole pack invalid, and it is written anew with the next payload.
+        const auto* const base = static_cast<const uint8_t*>(_mapping);
+        const auto* const h = reinterpret_cast<const header*>(base);
+        const uint64_t index_size = h->index_count * sizeof(index_entry);
+        if (h->tag != make_tag("PACK") || h->version != pack_version || h->index_offset % 8 != 0 || h->index_offset < sizeof(header)
+            || h->index_count > _mapping_size / sizeof(index_entry) || index_size + sizeof(hash128) > _mapping_size
+            || h->index_offset > _mapping_size - index_size - sizeof(hash128))
+        {
+            unmap();
+            return false;
+        }
+        hash128 checksum;
+        std::memcpy(&checksum, base + h->index_offset + index_size, sizeof(checksum));
+        if (checksum != index_checksum(h->index_offset, h->index_count, base + h->index_offset, index_size))
+        {
+            unmap();
+            return false;
+        }
+
+        const auto* const index = reinterpret_cast<const index_entry*>(base + h->index_offset);
+        for (size_t i = 0; i < h->index_count; ++i)
+        {
+            if (index[i].offset < sizeof(header) || index[i].size > h->index_offset || index[i].offset > h->index_offset - index[i].size
+                || (i > 0 && !key_less(index[i - 1].key, index[i].key)))
+            {
+                unmap();
+                return false;
+            }
+        }
+
+        _index = index;
+        _index_count = static_cast<size_t>(h->index_count);
+        return true;
+    }
+
+    void pack::unmap() noexcept
+    {
+        if (_mapping)
+        {
+#ifdef _WIN32
+            UnmapViewOfFile(_mapping);
+#else
+            munmap(_mapping, _mapping_size);
+#endif
+        }
+        _mapping = nullptr;
+        _mapping_size = 0;
+        _index = nullptr;
+        _index_count = 0;
+    }
+
+    void pack::refresh()
+    {
+        map();
+    }
+
+    std::optional<pack::payload> pack::find(const hash128& key) const
+    {
+        for (const auto& pending : _pending)
+        {
+            if (pending.entry.key == key)
+                return payload{ pending.data.data(), pending.data.size(), pending.entry.format, pending.entry.binary_format };
+        }
+
+        if (std::find(_erased.begin(), _erased.end(), key) != _erased.end())
+            return std::nullopt;
+        const index_entry* const end = _index + _index_count;
+        const index_entry* const it = std::lower_bound(_index, end, key, [](const index_entry& entry, const hash128& k) { return key_less(entry.key, k); });
+        if (it == end || it->key != key)
+            return std::nullopt;
+        return payload{ static_cast<const uint8_t*>(_mapping) + it->offset, static_cast<size_t>(it->size), it->format, it->binary_format };
+    }
+
+    void pack::insert(const hash128& key, uint32_t format, uint32_t binary_format, const std::vector<uint8_t>& data)
+    {
+        const index_entry entry{ key, 0, data.size(), format, binary_format };
+        _erased.erase(std::remove(_erased.begin(), _erased.end(), key), _erased.end());
+        const auto it = std::find_if(_pending.begin(), _pending.end(), [&](const pending_entry& p) { return p.entry.key == key; });
+        if (it != _pending.end())
+            *it = { entry, data };
+        else
+            _pending.push_back({ entry, data });
+    }
+
+    void pack::erase(const hash128& key)
+    {
+        _pending.erase(std::remove_if(_pending.begin(), _pending.end(), [&](const pending_entry& p) { return p.entry.key == key; }), _pending.end());
+        const index_entry* const end = _index + _index_count;
+        if (std::any_of(_index, end, [&](const index_entry& entry) { return entry.key == key; })
+            && std::find(_erased.begin(), _erased.end(), key) == _erased.end())
+            _erased.push_back(key);
+    }
+
+    std::vector<hash128> pack::keys() const
+    {
+        std::vector<hash128> result;
+        for (const auto& entry : entries())
+            result.push_back(entry.key);
+        return result;
+    }
+
+    std::vector<pack::index_entry> pack::entries() const
+    {
+        std::vector<index_entry> result;
+        result.reserve(_index_count + _pending.size());
+        std::copy_if(_index, _index + _index_count, std::back_inserter(result), [&](const index_entry& entry) {
+            return std::find(_erased.begin(), _erased.end(), entry.key) == _erased.end();
+        });
+        for (const auto& pending : _pending)
+        {
+            const auto it = std::lower_bound(result.begin(), result.end(), pending.entry.key, [](const index_entry& entry, const hash128& k) { return key_less(entry.key, k); });
+            if (it != result.end() && it->key == pending.entry.key)
+                *it = pending.entry;
+            else
+                result.insert(it, pending.entry);
+        }
+        return result;
+    }
+
+    const uint8_t* pack::data(const index_entry& entry) const
+    {
+        // Payloads which have not been published yet are still in memory.
+        for (const auto& pending : _pending)
+            if (pending.entry.key == entry.key)
+                return pending.data.data();
+        if (entry.offset + entry.size <= _mapping_size)
+            return static_cast<const uint8_t*>(_mapping) + entry.offset;
+        return nullptr;
+    }
+
+    void pack::flush()
+    {
+        if (_pending.empty() && _erased.empty())
+            return;
+
+        const file_lock lock(lock_file());
+        publish();
+    }
+
+    void pack::publish()
+    {
+        // Other processes may have published entries or compacted the file since it was mapped.
+        map();
+        if (!_mapping)
+        {
+            // Missing or damaged files are started anew. Other processes may still read the old one through their mapping.
+            const header empty{ make_tag("PACK"), pack_version, sizeof(header), 0 };
+            const hash128 checksum = index_checksum(empty.index_offset, 0, nullptr, 0);
+            write_atomically(_file, [&](std::ostream& out) {
+                out.write(reinterpret_cast<const char*>(&empty), sizeof(empty));
+                out.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+            });
+            map();
+            if (!_mapping)
+                return;
+        }
+
+        // Everything goes behind whatever has actually been written, including the remains of a failed flush.
+        std::error_code error;
+        uint64_t end = files::file_size(_file, error);
+        if (error)
+            return;
+
+        std::vector<index_entry> all;
+        uint64_t live = 0;
+        {
+            std::ofstream out(_file, std::ios::binary | std::ios::app);
+            for (auto& pending : _pending)
+            {
+                out.write(reinterpret_cast<const char*>(pending.data.data()), pending.data.size());
+                pending.entry.offset = end;
+                end += pending.data.size();
+            }
+
+            all = entries();
+            for (const auto& entry : all)
+                live += entry.size;
+
+            const char padding[8] = {};
+            const uint64_t pad = index_alignment(end);
+            const uint64_t index_size = all.size() * sizeof(index_entry);
+            const header h{ make_tag("PACK"), pack_version, end + pad, all.size() };
+            const hash128 checksum = index_checksum(h.index_offset, h.index_count, all.data(), index_size);
+            out.write(padding, pad);
+            out.write(reinterpret_cast<const char*>(all.data()), index_size);
+            out.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+            out.close();
+            end += pad + index_size + sizeof(checksum);
+
+            // Until the header points to the new index, readers still see the old one. Failed writes are tried again with the next flush.
+            std::fstream head(_file, std::ios::binary | std::ios::in | std::ios::out);
+            head.seekp(0);
+            head.write(reinterpret_cast<const char*>(&h), sizeof(h));
+            head.close();
+            if (out.fail() || head.fail())
+                return;
+        }
+
+        _pending.clear();
+        _erased.clear();
+        map();
+
+        // Superseded payloads and indices are garbage.
+        const uint64_t index_size = all.size() * sizeof(index_entry);
+        if (end > sizeof(header) + index_size + sizeof(hash128) + 2 * live)
+            compact_locked();
+    }
+
+    void pack::compact()
+    {
+        const file_lock lock(lock_file());
+        map();
+        compact_locked();
+    }
+
+    void pack::compact_locked()
+    {
+        const std::vector<index_entry> all = entries();
+        const bool written = write_atomically(_file, [&](std::ostream& out) {
+            std::vector<index_entry> index = all;
+            uint64_t offset = sizeof(header);
+            const header placeholder{};
+            out.write(reinterpret_cast<const char*>(&placeholder), sizeof(placeholder));
+            for (auto& entry : index)
+            {
+                out.write(reinterpret_cast<const char*>(data(entry)), entry.size);
+                entry.offset = offset;
+                offset += entry.size;
+            }
+
+            const char padding[8] = {};
+            const uint64_t pad = index_alignment(offset);
+            const uint64_t index_size = index.size() * sizeof(index_entry);
+            const header h{ make_tag("PACK"), pack_version, offset + pad, index.size() };
+            const hash128 checksum = index_checksum(h.index_offset, h.index_count, index.data(), index_size);
+            out.write(padding, pad);
+            out.write(reinterpret_cast<const char*>(index.data()), index_size);
+            out.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+            out.seekp(0);
+            out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        }, [&] { unmap(); });
+
+        // On failure, the old file and the pending payloads stay in use. Other processes keep reading the old file
+        // through their mapping until they map it again.
+        if (written)
+        {
+            _pending.clear();
+            _erased.clear();
+        }
+        map();
+    }
+}
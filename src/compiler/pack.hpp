@@ -0,0 +1,103 @@
+#pragma once
+
+#include <glsp/preprocess.hpp>
+#include "hash128.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace glshader::process::impl::cache
+{
+    using hash::hash128;
+
+    /* All binaries of a cache directory in one append-only file which is mapped read-only into memory.
+    The file starts with a header pointing to an index sorted by key, which is found by binary search. New payloads and a new
+    index are appended behind the old ones, which stay in the file as garbage until it is compacted. Processes sharing the
+    file write it one at a time under a lock, while readers take no lock and check the index against the checksum behind it. */
+    class pack
+    {
+    public:
+        /* A payload inside the mapped file. Only valid until the next call to flush or compact. */
+        struct payload
+        {
+            const uint8_t* data;
+            size_t size;
+            uint32_t format;            /* The glsp::format the binary was compiled for. */
+            uint32_t binary_format;     /* The vendor binary format. */
+        };
+
+        /* Maps the pack file if it exists. A damaged file is treated like an empty one and replaced by the next flush. */
+        explicit pack(files::path file);
+        ~pack();
+
+        pack(const pack&) = delete;
+        pack& operator=(const pack&) = delete;
+
+        std::optional<payload> find(const hash128& key) const;
+
+        /* Maps the file anew, to find entries other processes have published since. */
+        void refresh();
+
+        /* Adds a payload. It can be found right away, but is only written and published for other readers of the file by flush. */
+        void insert(const hash128& key, uint32_t format, uint32_t binary_format, const std::vector<uint8_t>& data);
+
+        /* Removes an entry. Its payload stays in the file as garbage, and it is only removed for other readers by flush. */
+        void erase(const hash128& key);
+
+        /* Returns the keys of all current entries. */
+        std::vector<hash128> keys() const;
+
+        /* Appends the new payloads and an index of all entries, including those other processes have published, and points
+        the header to it. Compacts the file if most of it is garbage. */
+        void flush();
+
+        /* Rewrites the file with only the payloads of current entries. */
+        void compact();
+
+    private:
+        struct header
+        {
+            uint32_t tag;
+            uint32_t version;
+            uint64_t index_offset;
+            uint64_t index_count;
+        };
+
+        struct index_entry
+        {
+            hash128 key;
+            uint64_t offset;
+            uint64_t size;
+            uint32_t format;
+            uint32_t binary_format;
+        };
+
+        struct pending_entry
+        {
+            index_entry entry;
+            std::vector<uint8_t> data;
+        };
+
+        void map();
+        /* Returns false if the file is damaged, which may also mean that another process has just rewritten its header. */
+        bool try_map();
+        void unmap() noexcept;
+        files::path lock_file() const;
+        /* Both are called while holding the lock. */
+        void publish();
+        void compact_locked();
+        /* Returns all current entries sorted by key. */
+        std::vector<index_entry> entries() const;
+        const uint8_t* data(const index_entry& entry) const;
+
+        files::path _file;
+        void* _mapping = nullptr;
+        size_t _mapping_size = 0;
+        const index_entry* _index = nullptr;
+        size_t _index_count = 0;
+
+        std::vector<pending_entry> _pending;    /* Offsets are only assigned when the payloads are written. */
+        std::vector<hash128> _erased;           /* Entries of the mapped index which are left out of the next one. */
+    };
+}
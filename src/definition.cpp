@@ -35,12 +35,13 @@ namespace glshader::process
         namespace skip = impl::skip;
         namespace cls = impl::classify;
 
-        const char* begin = impl::skip::space(str.data());
+        const char* const str_end = str.data() + str.size();
+        const char* begin = impl::skip::space(str.data(), str_end);
         const char* c = begin;
         while (!cls::is_eof(c) && !cls::is_space(c) && *c != '(')
             ++c;
         const char* end_name = c;
-        c = skip::space(c);
+        c = skip::space(c, str_end);
         if (cls::is_eof(c))
             return { begin, end_name };
         if (*c == '(')
@@ -48,17 +49,24 @@ namespace glshader::process
             definition_info info;
             do
             {
-                const char* begin_param = c=skip::space(++c);
+                const char* begin_param = c=skip::space(++c, str_end);
                 while (!cls::is_eof(c) && !cls::is_space(c) && *c!=',' && *c != ')')
                     ++c;
                 const char* end_param = c;
 
                 info.parameters.emplace_back(begin_param, end_param);
 
-                c = skip::space(c);
+                c = skip::space(c, str_end);
             } while (!cls::is_eof(c) && *c != ')');
-            c = !cls::is_eof(c) ? skip::space(++c) : c;
+            c = !cls::is_eof(c) ? skip::space(++c, str_end) : c;
             info.replacement = std::string{ c, begin + str.size() };
+
+            // MACRO() has no parameters, but must be invoked with parentheses, just like #define MACRO() does.
+            if (info.parameters.size() == 1 && info.parameters[0].empty())
+            {
+                info.parameters.clear();
+                return definition(std::string(begin, end_name) + "()", info);
+            }
             return definition({ begin, end_name }, info);
         }
         else
@@ -38,12 +38,12 @@ namespace glshader::process::impl::loader
             get_fun     = reinterpret_cast<decltype(get_fun)>(get_handle(hnd, "glXGetProcAddressARB"));
             get_ctx_fun = reinterpret_cast<decltype(get_ctx_fun)>(get_handle(hnd, "glXGetCurrentContext"));
 #endif
-            ctx = get_ctx_fun();
+            ctx = get_ctx_fun ? get_ctx_fun() : nullptr;
         }
 
         bool valid() const
         {
-            return ctx && ctx == get_ctx_fun();
+            return ctx && get_ctx_fun && ctx == get_ctx_fun();
         }
 
         ~function_loader()
@@ -0,0 +1,31 @@
+#include <glsp/output.hpp>
+
+namespace glshader::process
+{
+    callback_sink::callback_sink(std::function<void(std::string_view)> callback)
+        : _callback(std::move(callback))
+    {
+
+    }
+
+    void callback_sink::write(const char* data, size_t length)
+    {
+        _callback(std::string_view(data, length));
+    }
+
+    file_sink::file_sink(const files::path& path)
+        : _file(path, std::ios::out | std::ios::binary | std::ios::trunc)
+    {
+
+    }
+
+    void file_sink::write(const char* data, size_t length)
+    {
+        _file.write(data, static_cast<std::streamsize>(length));
+    }
+
+    bool file_sink::good() const noexcept
+    {
+        return _file.good();
+    }
+}
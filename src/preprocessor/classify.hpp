@@ -1,13 +1,16 @@
 #pragma once
 
+#include "lexer.hpp"
+
 namespace glshader::process::impl::classify
 {
-    bool is_eof         (const char* c);
-    bool is_newline     (const char* c);
+    inline bool is_eof      (const char* c) { return lexer::has_class(*c, lexer::char_class::eof); }
+    inline bool is_newline  (const char* c) { return lexer::has_class(*c, lexer::char_class::newline); }
+    inline bool is_space    (const char* c) { return lexer::has_class(*c, lexer::char_class::space); }
+    inline bool is_name_char(const char* c) { return lexer::has_class(*c, lexer::char_class::name); }
+    inline bool is_operator (const char* c) { return lexer::has_class(*c, lexer::char_class::op); }
+
     bool is_comment     (const char* c);
-    bool is_space       (const char* c);
-    bool is_name_char   (const char* c);
-    bool is_operator    (const char* c);
     bool is_directive   (const char* c, bool check_before = true);
     bool is_token_equal (const char* c, const char* token, int token_len, bool check_before = true, bool check_after = true);
-}
\ No newline at end of file
+}
@@ -0,0 +1,116 @@
+#include "conditions.hpp"
+
+#include "macro.hpp"
+
+#include <algorithm>
+
+namespace glshader::process::impl::conditions
+{
+    namespace
+    {
+        uint64_t macro_state(std::string_view name, const context& ctx)
+        {
+            // Extensions are never expanded, only their availability matters.
+            if (name.compare(0, 3, "GL_") == 0)
+                return macro::is_defined(name, ctx) ? 1 : 0;
+            const macro::macro_entry* entry = ctx.definitions.find(name);
+            return entry ? entry->fingerprint : macro::is_builtin(name, ctx) ? 1 : 0;
+        }
+    }
+
+    int64_t file_conditions::evaluate(size_t offset, std::string_view text, const files::path& current_file, const int current_line, context& ctx)
+    {
+        const uint64_t generation = ctx.definitions.generation();
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (const auto it = _conditions.find(offset); it != _conditions.end() && it->second.text == text)
+        {
+            condition& cached = it->second;
+            if (cached.generation == generation)
+                return cached.value;
+
+            bool expansion_changed = false;
+            bool operand_changed = false;
+            for (const auto& dep : cached.dependencies)
+            {
+                if (macro_state(dep.name, ctx) != dep.state)
+                    (dep.expanded ? expansion_changed : operand_changed) = true;
+            }
+
+            if (!expansion_changed)
+            {
+                // Only operands of "defined" changed, the compiled expression can be evaluated again as it is.
+                if (operand_changed)
+                {
+                    const int errors = ctx.processed.error_count;
+                    const int64_t value = cached.expression.evaluate(current_file, current_line, ctx);
+                    if (errors != ctx.processed.error_count)
+                    {
+                        _conditions.erase(it);
+                        return value;
+                    }
+                    for (auto& dep : cached.dependencies)
+                        dep.state = macro_state(dep.name, ctx);
+                    cached.value = value;
+                }
+                cached.generation = generation;
+                return cached.value;
+            }
+        }
+        lock.unlock();
+
+        condition evaluated;
+        evaluated.text = text;
+
+        std::vector<std::string> reads;
+        const int errors = ctx.processed.error_count;
+        const std::string expanded = macro::expand_condition(text, current_file, current_line, ctx, &reads);
+        if (!evaluated.expression.compile(expanded, current_file, current_line, ctx))
+            return 0;
+        evaluated.value = evaluated.expression.evaluate(current_file, current_line, ctx);
+
+        // Results depending on errors are not cached, so that the errors are reported again.
+        // Built-in macros change with the position and are not tracked by the macro table either.
+        if (errors != ctx.processed.error_count || std::any_of(reads.begin(), reads.end(),
+            [&](const std::string& name) { return macro::is_builtin(name, ctx) && !ctx.definitions.defined(name); }))
+            return evaluated.value;
+
+        evaluated.dependencies.reserve(reads.size() + evaluated.expression.defined_names().size());
+        for (auto& name : reads)
+        {
+            const uint64_t state = macro_state(name, ctx);
+            evaluated.dependencies.push_back({ std::move(name), state, true });
+        }
+        for (const auto& name : evaluated.expression.defined_names())
+        {
+            if (std::none_of(evaluated.dependencies.begin(), evaluated.dependencies.end(), [&](const dependency& d) { return d.name == name; }))
+                evaluated.dependencies.push_back({ name, macro_state(name, ctx), false });
+        }
+        evaluated.generation = generation;
+
+        const int64_t value = evaluated.value;
+        lock.lock();
+        _conditions[offset] = std::move(evaluated);
+        return value;
+    }
+
+    std::shared_ptr<file_conditions> storage::file(const files::path& path)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        auto& conditions = _files[path.string()];
+        if (!conditions)
+            conditions = std::make_shared<file_conditions>();
+        return conditions;
+    }
+
+    void storage::evict(const files::path& path)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _files.erase(path.string());
+    }
+
+    void storage::clear()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _files.clear();
+    }
+}
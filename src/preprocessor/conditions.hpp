@@ -0,0 +1,66 @@
+#pragma once
+
+#include <glsp/preprocess.hpp>
+#include <glsp/cache.hpp>
+#include "context.hpp"
+#include "eval.hpp"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace glshader::process::impl::conditions
+{
+    /* A macro read by a condition, and its fingerprint when the condition was evaluated. */
+    struct dependency
+    {
+        std::string name;
+        uint64_t state;         /* Macro fingerprint, or whether the name was defined for GL_ names. 0 if undefined. */
+        bool expanded;          /* Read while expanding the condition. Otherwise only an operand of "defined". */
+    };
+
+    struct condition
+    {
+        std::string text;                       /* The condition as written in the file, to detect changed sources. */
+        operation::expression expression;       /* The macro-expanded condition. */
+        std::vector<dependency> dependencies;
+        int64_t value = 0;
+        uint64_t generation = 0;                /* Macro table generation the value was last validated against. */
+    };
+
+    /* All cached conditions of a single file, keyed by their offset in it. */
+    class file_conditions
+    {
+    public:
+        /* Evaluates the condition text at the given offset, reusing the cached result if none of the macros it reads have changed. */
+        int64_t evaluate(size_t offset, std::string_view text, const files::path& current_file, int current_line, context& ctx);
+
+    private:
+        std::mutex _mutex;
+        std::unordered_map<size_t, condition> _conditions;
+    };
+
+    /* Cached conditions of all files. Safe to be used by multiple preprocessor runs at once. */
+    class storage
+    {
+    public:
+        std::shared_ptr<file_conditions> file(const files::path& path);
+        void evict(const files::path& path);
+        void clear();
+
+    private:
+        std::mutex _mutex;
+        std::unordered_map<std::string, std::shared_ptr<file_conditions>> _files;
+    };
+}
+
+namespace glshader::process::impl
+{
+    /* Access to the internals of the public cache classes. */
+    struct cache_access
+    {
+        static conditions::storage* storage(condition_cache& cache) noexcept { return cache._storage.get(); }
+    };
+}
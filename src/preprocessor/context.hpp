@@ -0,0 +1,38 @@
+#pragma once
+
+#include <glsp/glsp.hpp>
+#include <glsp/capabilities.hpp>
+#include "macro_table.hpp"
+
+namespace glshader::process::impl
+{
+    namespace conditions { class storage; }
+
+    /* State of a single preprocess_source call, threaded through all processing stages.
+    The processed_file receives everything user-visible, the rest is dropped when processing is done. */
+    struct context
+    {
+        processed_file& processed;
+        macro::table definitions{};
+        conditions::storage* conditions = nullptr;
+        file_cache* file_contents = nullptr;
+        include_cache* include_paths = nullptr;
+        bool memory_map = false;
+        const capabilities* gl = nullptr;       /* Available extensions. If not set, the ones of the current GL context are used. */
+        bool named_line_directives = false;     /* Write the file name into #line directives, which only some drivers accept. */
+        std::string version{};                  /* The value of __VERSION__, empty before the #version directive. */
+        files::path end_file{};                 /* The values of __FILE__ and __LINE__ where processing ended. */
+        int end_line = 0;
+
+        /* The source position the driver assigns to the output, as set by the last #line directive or source map run.
+        Files are identified by ids, as the same file may be included multiple times or renamed by #line. */
+        struct output_position
+        {
+            uint32_t file = 0;                  /* 0 until the first directive or run, as no file name is known before. */
+            int line = 1;
+            size_t newlines = 0;                /* Newlines in the output when the position was set. */
+        } output_position{};
+        uint32_t file_ids = 0;                  /* The last id given to a file. */
+        source_map* map = nullptr;              /* If set, positions are recorded here instead of writing #line directives. */
+    };
+}
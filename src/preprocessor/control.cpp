@@ -1,16 +1,14 @@
 #include "control.hpp"
 #include "../opengl/loader.hpp"
 #include <string>
+#include <string_view>
 
 namespace glshader::process::impl::control
 {
     constexpr uint32_t GL_VENDOR = 0x1F00;
 
-    std::string line_directive(const files::path& file, int line, processed_file& processed)
+    bool query_named_line_directives()
     {
-      if (processed.minified)
-        return "";
-
         thread_local struct GetStringFunction
         {
         public:
@@ -22,10 +20,8 @@ namespace glshader::process::impl::control
             }
             const char *operator()(uint32_t param)
             {
-                if(glGetStringFunc != nullptr)
-                    return glGetStringFunc(param);
-                else
-                    return &ns;
+                const char* result = glGetStringFunc != nullptr ? glGetStringFunc(param) : nullptr;
+                return result ? result : &ns;
             }
         private:
             const char ns;
@@ -33,23 +29,47 @@ namespace glshader::process::impl::control
 
         } glGetString;
 
-        std::string fn = file.filename().string();
-        for (auto& c : fn)
-          if (c == '\"')
-            c = ' ';
-        std::string s = glGetString(GL_VENDOR);
-
-        auto const directive = [&] {
-          if (s.find("NVIDIA") != std::string::npos)
-            return "\n#line " + std::to_string(line) + " \"" + fn + "\"\n";
-          else
-            return "\n#line " + std::to_string(line) + "\n";
-        }();
-        return directive;
+        return std::string_view(glGetString(GL_VENDOR)).find("NVIDIA") != std::string_view::npos;
     }
 
-    void increment_line(int& current_line, processed_file& processed)
+    void sync_line(const files::path& file, uint32_t file_id, int line, context& ctx, output::buffer& result)
     {
-        processed.definitions["__LINE__"] = ++current_line;
+        if (ctx.processed.minified && !ctx.map)
+            return;
+
+        auto& position = ctx.output_position;
+        const int output_line = position.line + static_cast<int>(result.newlines() - position.newlines);
+        // Without file names in the directives, the driver cannot tell files apart.
+        const bool same_file = (!ctx.named_line_directives && !ctx.map) || position.file == file_id;
+        if (same_file && output_line == line)
+            return;
+
+        if (ctx.map)
+        {
+            result.map_source(file.string(), line);
+            position = { file_id, line, result.newlines() };
+            return;
+        }
+
+        if (same_file && line > output_line && line - output_line <= max_newline_gap)
+        {
+            for (int i = output_line; i < line; ++i)
+                result.put('\n');
+            return;
+        }
+
+        if (!result.at_line_start())
+            result.put('\n');
+        result << "#line " << line;
+        if (ctx.named_line_directives)
+        {
+            std::string fn = file.filename().string();
+            for (auto& c : fn)
+              if (c == '\"')
+                c = ' ';
+            result << " \"" << fn << '\"';
+        }
+        result.put('\n');
+        position = { file_id, line, result.newlines() };
     }
-}
\ No newline at end of file
+}
@@ -1,9 +1,19 @@
 #pragma once
 
 #include <glsp/glsp.hpp>
+#include "context.hpp"
+#include "output_buffer.hpp"
 
 namespace glshader::process::impl::control
 {
-    std::string line_directive(const files::path& file, int line, processed_file& processed);
-    void increment_line(int& current_line, processed_file& processed);
+    /* Filling a gap with newlines is shorter than a #line directive for up to this many lines. */
+    constexpr int max_newline_gap = 8;
+
+    /* Returns whether the driver of the GL context current on this thread accepts file names in #line directives. */
+    bool query_named_line_directives();
+
+    /* Makes sure that the output written next is attributed to the given file and line by the driver. Writes newlines
+    if the output lags behind by a few lines, or a #line directive if it is further off or was written for another file.
+    With a source map, a run is added to the map instead and nothing is written. */
+    void sync_line(const files::path& file, uint32_t file_id, int line, context& ctx, output::buffer& result);
 }
\ No newline at end of file
@@ -0,0 +1,540 @@
+#include "dead_code.hpp"
+#include "control.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace glshader::process::impl::dead_code
+{
+    namespace {
+        bool is_word_start(char c) noexcept
+        {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+        }
+
+        bool is_digit(char c) noexcept
+        {
+            return c >= '0' && c <= '9';
+        }
+
+        bool is_word_char(char c) noexcept
+        {
+            return is_word_start(c) || is_digit(c);
+        }
+
+        bool is_blank(char c) noexcept
+        {
+            return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+        }
+
+        bool is_interface_qualifier(std::string_view word) noexcept
+        {
+            constexpr std::string_view qualifiers[] = { "in", "out", "uniform", "buffer", "shared", "attribute", "varying", "patch", "layout", "subroutine" };
+            return std::find(std::begin(qualifiers), std::end(qualifiers), word) != std::end(qualifiers);
+        }
+
+        /* A top-level declaration: a function definition or prototype, a struct, an interface block or a list of variables. */
+        struct declaration
+        {
+            size_t begin;
+            size_t end;
+            uint32_t uses_begin;    /* The identifiers used in the declaration, as a range in scanner::uses. */
+            uint32_t uses_end;
+            bool root;              /* Kept in any case. */
+        };
+
+        /* A #line directive in the code. */
+        struct line_directive
+        {
+            size_t begin;
+            size_t next_line;       /* The output line after the directive, which gets the given line. */
+            int line;
+            std::string_view file;  /* Everything after the line number, repeated in directives replacing removed code. */
+        };
+
+        /* Splits code into top-level declarations and collects the names each of them defines and uses. */
+        class scanner
+        {
+        public:
+            explicit scanner(std::string_view code);
+
+            /* The line of the given offset as the driver will report it. */
+            int source_line(size_t offset) const;
+            /* The output line of the given offset, starting at 1. */
+            size_t output_line(size_t offset) const;
+            /* Returns the last #line directive before the given offset, or nullptr. */
+            const line_directive* directive_before(size_t offset) const;
+
+            std::vector<declaration> declarations;
+            std::vector<std::pair<std::string_view, uint32_t>> definitions;     /* Defined names and the declarations defining them. */
+            std::vector<std::string_view> uses;
+            std::vector<line_directive> directives;
+            std::vector<size_t> line_starts;
+            bool has_main = false;
+
+        private:
+            void directive(size_t begin, size_t end);
+            void token(size_t begin, size_t end);
+            void identifier(std::string_view name);
+            void define_candidate();
+            void finish(size_t end, bool root);
+
+            std::string_view _code;
+            bool _active = false;           /* A declaration has been started. */
+            size_t _begin = 0;
+            int _depth = 0;
+            bool _after_paren = false;      /* The last token closed a parenthesis at depth 0. */
+            bool _member = false;           /* The last token was a '.', so the next identifier is a member or swizzle. */
+            bool _function = false;
+            bool _body = false;
+            bool _initializer = false;
+            bool _root = false;
+            std::string_view _candidate;    /* The last identifier at depth 0, which is a declared name if ';', ',', '=', '(' or '{' follows. */
+            size_t _definitions_begin = 0;
+            size_t _uses_begin = 0;
+        };
+
+        scanner::scanner(std::string_view code)
+            : _code(code)
+        {
+            line_starts.push_back(0);
+            bool line_start = true;
+            size_t i = 0;
+            while (i < code.size())
+            {
+                const char c = code[i];
+                const char next = i + 1 < code.size() ? code[i + 1] : '\0';
+                if (c == '\n')
+                {
+                    line_starts.push_back(++i);
+                    line_start = true;
+                }
+                else if (is_blank(c))
+                {
+                    ++i;
+                }
+                else if (c == '#' && line_start)
+                {
+                    size_t end = i;
+                    while ((end = code.find('\n', end)) != std::string_view::npos && code[end - 1] == '\\')
+                        line_starts.push_back(++end);
+                    end = std::min(end, code.size());
+                    directive(i, end);
+                    i = end;
+                }
+                else if (c == '/' && next == '/')
+                {
+                    i = std::min(code.find('\n', i), code.size());
+                }
+                else if (c == '/' && next == '*')
+                {
+                    const size_t end = std::min(code.find("*/", i + 2), code.size() - 2) + 2;
+                    for (; i < end; ++i)
+                        if (code[i] == '\n')
+                            line_starts.push_back(i + 1);
+                }
+                else
+                {
+                    line_start = false;
+                    size_t end = i + 1;
+                    if (is_word_start(c))
+                    {
+                        while (end < code.size() && is_word_char(code[end]))
+                            ++end;
+                    }
+                    else if (is_digit(c) || (c == '.' && is_digit(next)))
+                    {
+                        const bool hex = c == '0' && (next == 'x' || next == 'X');
+                        while (end < code.size() && (is_word_char(code[end]) || code[end] == '.'
+                            || (!hex && (code[end] == '+' || code[end] == '-') && (code[end - 1] == 'e' || code[end - 1] == 'E'))))
+                            ++end;
+                    }
+                    token(i, end);
+                    i = end;
+                }
+            }
+
+            // An unterminated declaration is kept.
+            if (_active)
+                finish(code.size(), true);
+        }
+
+        void scanner::directive(size_t begin, size_t end)
+        {
+            std::string_view text = _code.substr(begin + 1, end - begin - 1);
+            const auto skip_blanks = [&] { while (!text.empty() && is_blank(text.front())) text.remove_prefix(1); };
+            skip_blanks();
+            if (text.substr(0, 4) != "line" || text.size() < 5 || !is_blank(text[4]))
+                return;
+            text.remove_prefix(4);
+            skip_blanks();
+            int line = 0;
+            size_t digits = 0;
+            for (; digits < text.size() && is_digit(text[digits]); ++digits)
+                line = line * 10 + (text[digits] - '0');
+            if (digits == 0)
+                return;
+            text.remove_prefix(digits);
+            while (!text.empty() && is_blank(text.back()))
+                text.remove_suffix(1);
+            directives.push_back({ begin, line_starts.size() + 1, line, text });
+        }
+
+        void scanner::token(size_t begin, size_t end)
+        {
+            const std::string_view text = _code.substr(begin, end - begin);
+            if (!_active)
+            {
+                // Empty declarations are left alone.
+                if (text == ";")
+                    return;
+                _active = true;
+                _begin = begin;
+            }
+
+            const bool member = std::exchange(_member, false);
+            const bool after_paren = std::exchange(_after_paren, false);
+            if (is_word_start(text.front()))
+            {
+                if (!member)
+                    identifier(text);
+                return;
+            }
+            if (text.size() != 1)
+                return;
+
+            switch (text.front())
+            {
+            case '.':
+                _member = true;
+                break;
+            case '(':
+                // The first parenthesis after a name outside of an initializer opens a parameter list.
+                if (_depth++ == 0 && !_initializer && !_function && !_candidate.empty())
+                {
+                    _function = true;
+                    if (_candidate == "main")
+                        has_main = _root = true;
+                    define_candidate();
+                }
+                break;
+            case '[':
+                ++_depth;
+                break;
+            case ')':
+            case ']':
+                if (_depth > 0 && --_depth == 0)
+                    _after_paren = text.front() == ')';
+                break;
+            case '{':
+                if (_depth++ == 0)
+                {
+                    if (_function && after_paren)
+                        _body = true;
+                    else
+                        define_candidate();     // A struct or block name.
+                }
+                break;
+            case '}':
+                if (_depth > 0 && --_depth == 0 && _body)
+                    finish(end, false);
+                break;
+            case ',':
+                if (_depth == 0)
+                {
+                    define_candidate();
+                    _initializer = false;
+                }
+                break;
+            case '=':
+                if (_depth == 0 && !_initializer)
+                {
+                    define_candidate();
+                    _initializer = true;
+                }
+                break;
+            case ';':
+                if (_depth == 0)
+                {
+                    define_candidate();
+                    finish(end, false);
+                }
+                break;
+            default:
+                break;
+            }
+        }
+
+        void scanner::identifier(std::string_view name)
+        {
+            if (_depth > 0 || _initializer)
+            {
+                uses.push_back(name);
+            }
+            else if (is_interface_qualifier(name))
+            {
+                _root = true;
+            }
+            else
+            {
+                // Only the last name before a declarator ends is declared, all names before are types or qualifiers.
+                if (!_candidate.empty())
+                    uses.push_back(_candidate);
+                _candidate = name;
+            }
+        }
+
+        void scanner::define_candidate()
+        {
+            if (_candidate.empty())
+                return;
+            // Redeclared built-in variables, e.g. with invariant, are part of the interface.
+            if (_candidate.substr(0, 3) == "gl_")
+                _root = true;
+            definitions.emplace_back(_candidate, static_cast<uint32_t>(declarations.size()));
+            _candidate = {};
+        }
+
+        void scanner::finish(size_t end, bool root)
+        {
+            // Declarations without a name, e.g. precision statements, are kept.
+            const bool defines_names = definitions.size() > _definitions_begin;
+            declarations.push_back({ _begin, end, static_cast<uint32_t>(_uses_begin), static_cast<uint32_t>(uses.size()),
+                root || _root || !defines_names });
+
+            _active = false;
+            _depth = 0;
+            _after_paren = _member = _function = _body = _initializer = _root = false;
+            _candidate = {};
+            _definitions_begin = definitions.size();
+            _uses_begin = uses.size();
+        }
+
+        size_t scanner::output_line(size_t offset) const
+        {
+            return static_cast<size_t>(std::upper_bound(line_starts.begin(), line_starts.end(), offset) - line_starts.begin());
+        }
+
+        const line_directive* scanner::directive_before(size_t offset) const
+        {
+            const auto it = std::lower_bound(directives.begin(), directives.end(), offset, [](const line_directive& directive, size_t offset) {
+                return directive.begin < offset;
+            });
+            return it == directives.begin() ? nullptr : &*std::prev(it);
+        }
+
+        int scanner::source_line(size_t offset) const
+        {
+            const size_t line = output_line(offset);
+            if (const auto directive = directive_before(offset))
+                return directive->line + static_cast<int>(line - directive->next_line);
+            return static_cast<int>(line);
+        }
+
+        /* A removed range of code and what replaces it. */
+        struct edit
+        {
+            size_t begin;
+            size_t end;
+            size_t new_begin;
+            size_t new_end;
+        };
+
+        /* Returns true if the code between two removed ranges can be removed with them: whitespace and, if a #line directive
+        replaces the removed code, other #line directives. */
+        bool only_separators(const scanner& scan, std::string_view code, size_t begin, size_t end, bool line_directives)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                if (code[i] == '\n' || is_blank(code[i]))
+                    continue;
+                const auto directive = scan.directive_before(i + 1);
+                if (!line_directives || !directive || directive->begin != i)
+                    return false;
+                i = std::min(code.find('\n', i), end);
+            }
+            return true;
+        }
+
+        /* Moves all runs of the map to the positions of the code after the edits. Runs in removed code are dropped, and the
+        code after removed lines gets a new run. */
+        source_map update(const source_map& map, const scanner& scan, const std::vector<edit>& edits, std::string_view code)
+        {
+            std::vector<size_t> line_starts{ 0 };
+            for (size_t i = 0; i < code.size(); ++i)
+                if (code[i] == '\n')
+                    line_starts.push_back(i + 1);
+
+            source_map result;
+            const auto add = [&](size_t offset, uint32_t file, int line) {
+                const size_t output_line = static_cast<size_t>(std::upper_bound(line_starts.begin(), line_starts.end(), offset) - line_starts.begin());
+                result.add(static_cast<int>(output_line), static_cast<int>(offset - line_starts[output_line - 1] + 1), map.files()[file], line);
+            };
+
+            const auto runs = map.runs();
+            const auto offset_of = [&](const source_map::run& run) {
+                const size_t line = std::min(static_cast<size_t>(run.output_line), scan.line_starts.size());
+                return scan.line_starts[line - 1] + static_cast<size_t>(run.output_column - 1);
+            };
+
+            auto run = runs.begin();
+            const source_map::run* current = nullptr;
+            size_t removed = 0;
+            for (const auto& e : edits)
+            {
+                for (; run != runs.end() && offset_of(*run) < e.begin; ++run)
+                {
+                    add(offset_of(*run) - removed, run->file, run->line);
+                    current = &*run;
+                }
+                bool dropped = false;
+                for (; run != runs.end() && offset_of(*run) < e.end; ++run)
+                {
+                    current = &*run;
+                    dropped = true;
+                }
+                removed += (e.end - e.begin) - (e.new_end - e.new_begin);
+
+                const size_t end_line = scan.output_line(e.end);
+                if (current && (dropped || end_line != scan.output_line(e.begin)))
+                    add(e.new_end, current->file, current->line + static_cast<int>(end_line) - current->output_line);
+            }
+            for (; run != runs.end(); ++run)
+                add(offset_of(*run) - removed, run->file, run->line);
+            return result;
+        }
+    }
+
+    size_t eliminate(std::string& code, source_map* map, bool line_directives)
+    {
+        const scanner scan(code);
+        if (!scan.has_main)
+            return 0;
+
+        // Group the definitions by name.
+        auto definitions = scan.definitions;
+        std::sort(definitions.begin(), definitions.end());
+        std::unordered_map<std::string_view, std::pair<uint32_t, uint32_t>> defined;
+        defined.reserve(definitions.size());
+        for (uint32_t i = 0; i < definitions.size();)
+        {
+            uint32_t end = i + 1;
+            while (end < definitions.size() && definitions[end].first == definitions[i].first)
+                ++end;
+            defined.emplace(definitions[i].first, std::make_pair(i, end));
+            i = end;
+        }
+
+        // Follow all uses from the roots.
+        const auto& declarations = scan.declarations;
+        std::vector<bool> reachable(declarations.size(), false);
+        std::vector<uint32_t> pending;
+        for (uint32_t i = 0; i < declarations.size(); ++i)
+        {
+            if (declarations[i].root)
+            {
+                reachable[i] = true;
+                pending.push_back(i);
+            }
+        }
+        while (!pending.empty())
+        {
+            const auto& d = declarations[pending.back()];
+            pending.pop_back();
+            for (uint32_t u = d.uses_begin; u < d.uses_end; ++u)
+            {
+                const auto it = defined.find(scan.uses[u]);
+                if (it == defined.end())
+                    continue;
+                for (uint32_t k = it->second.first; k < it->second.second; ++k)
+                {
+                    if (const uint32_t index = definitions[k].second; !reachable[index])
+                    {
+                        reachable[index] = true;
+                        pending.push_back(index);
+                    }
+                }
+            }
+        }
+
+        // Remove unreachable declarations with the lines they stand on, merging neighbouring ones.
+        std::vector<edit> edits;
+        for (uint32_t i = 0; i < declarations.size(); ++i)
+        {
+            if (reachable[i])
+                continue;
+            size_t begin = declarations[i].begin;
+            size_t end = declarations[i].end;
+            size_t line_begin = begin;
+            while (line_begin > 0 && is_blank(code[line_begin - 1]))
+                --line_begin;
+            size_t line_end = end;
+            while (line_end < code.size() && is_blank(code[line_end]))
+                ++line_end;
+            if ((line_begin == 0 || code[line_begin - 1] == '\n') && (line_end == code.size() || code[line_end] == '\n'))
+            {
+                begin = line_begin;
+                end = std::min(line_end + 1, code.size());
+                // Empty lines after the declaration go with it.
+                for (line_end = end; line_end < code.size() && is_blank(code[line_end]); )
+                    ++line_end;
+                while (line_end < code.size() && code[line_end] == '\n')
+                {
+                    end = ++line_end;
+                    while (line_end < code.size() && is_blank(code[line_end]))
+                        ++line_end;
+                }
+            }
+
+            if (!edits.empty() && only_separators(scan, code, edits.back().end, begin, line_directives))
+                edits.back().end = end;
+            else
+                edits.push_back({ begin, end, 0, 0 });
+        }
+        if (edits.empty())
+            return 0;
+
+        std::string result;
+        result.reserve(code.size());
+        size_t kept = 0;
+        for (auto& e : edits)
+        {
+            result.append(code, kept, e.begin - kept);
+            kept = e.end;
+            e.new_begin = result.size();
+            if (line_directives)
+            {
+                // Lines are kept as they are, unless a directive is shorter or removed directives have to be replaced.
+                const auto newlines = std::count(code.begin() + e.begin, code.begin() + e.end, '\n');
+                const auto directive = scan.directive_before(e.end);
+                if (newlines <= control::max_newline_gap && (!directive || directive->begin < e.begin))
+                {
+                    result.append(static_cast<size_t>(newlines), '\n');
+                }
+                else
+                {
+                    if (!result.empty() && result.back() != '\n')
+                        result.push_back('\n');
+                    result.append("#line ").append(std::to_string(scan.source_line(e.end)));
+                    if (directive && !directive->file.empty())
+                        result.append(" ").append(directive->file);
+                    result.push_back('\n');
+                }
+            }
+            e.new_end = result.size();
+        }
+        result.append(code, kept, std::string::npos);
+
+        if (map)
+            *map = update(*map, scan, edits, result);
+
+        // Replacing directives can make very small removals longer.
+        const size_t removed = code.size() > result.size() ? code.size() - result.size() : 0;
+        code = std::move(result);
+        return removed;
+    }
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <glsp/source_map.hpp>
+
+#include <string>
+
+namespace glshader::process::impl::dead_code
+{
+    /* Removes all functions, structs and global variables from processed code which are not reachable from main or from an
+    interface declaration, i.e. one with in, out, uniform, buffer, shared, attribute, varying, patch, layout or subroutine
+    qualifiers. Declarations are connected by the identifiers they use, without resolving scopes or overloads, so everything
+    that might be used is kept. Code without a main function is left untouched.
+    With line_directives, removed code containing a #line directive or more than a few lines is replaced by a #line
+    directive, so the driver still reports the original lines. A given source map is updated to the new positions.
+    Returns the number of bytes removed. */
+    size_t eliminate(std::string& code, source_map* map, bool line_directives);
+}
@@ -1,194 +1,443 @@
 #include "eval.hpp"
 
+#include "classify.hpp"
 #include "control.hpp"
+#include "lexer.hpp"
+#include "macro.hpp"
 #include "../strings.hpp"
 
-#include <cstring>
-#include <list>
+#include <charconv>
 
 namespace glshader::process::impl::operation
 {
-    enum eval_op
+    namespace cls = impl::classify;
+
+    /* Single-pass precedence climbing parser, emitting bytecode while reading the expression. */
+    class expression::parser
     {
-        /*** http://de.cppreference.com/w/cpp/language/operator_precedence ***/
-        /*** priority: 3 ***/
-        op_neg = 0, op_pos = 1,
-        op_not = 2, op_inv = 3,
+    public:
+        parser(expression& expr, std::string_view text, const files::path& file, const int line, context& ctx)
+            : _expr(expr), _pos(text.data()), _end(text.data() + text.size()), _file(file), _line(line), _ctx(ctx)
+        {}
 
-        /*** priority: 5 ***/
-        op_mul = 4, op_div = 5,
-        op_mod = 6,
+        bool parse()
+        {
+            next();
+            if (!parse_conditional())
+                return false;
+            if (_token.type != token_type::end)
+                return unexpected();
+            return true;
+        }
 
-        /*** priority: 6 ***/
-        op_add = 7, op_sub = 8,
+    private:
+        enum class token_type
+        {
+            end,
+            number,
+            name,
+            op,
+            invalid
+        };
 
-        /*** priority: 8 ***/
-        op_lt = 9, op_leq = 10,
-        op_gt = 11, op_geq = 12,
+        struct token
+        {
+            token_type type;
+            std::string_view text;
+            int64_t value;
+        };
 
-        /*** priority: 9 ***/
-        op_eq = 13, op_neq = 14,
+        struct binary_operator
+        {
+            std::string_view text;
+            int precedence;
+            op_code code;
+        };
 
-        /*** priority: 10 ***/
-        op_and = 15,
+        /*** https://en.cppreference.com/w/cpp/language/operator_precedence ***/
+        static const binary_operator* find_binary(const token& t) noexcept
+        {
+            static constexpr binary_operator operators[] = {
+                { "||", 1, op_code::lor },
+                { "&&", 2, op_code::land },
+                { "|", 3, op_code::bor },
+                { "^", 4, op_code::bxor },
+                { "&", 5, op_code::band },
+                { "==", 6, op_code::eq }, { "!=", 6, op_code::neq },
+                { "<", 7, op_code::lt }, { "<=", 7, op_code::leq }, { ">", 7, op_code::gt }, { ">=", 7, op_code::geq },
+                { "<<", 8, op_code::shl }, { ">>", 8, op_code::shr },
+                { "+", 9, op_code::add }, { "-", 9, op_code::sub },
+                { "*", 10, op_code::mul }, { "/", 10, op_code::div }, { "%", 10, op_code::mod },
+            };
 
-        /*** priority: 11 ***/
-        op_xor = 16,
+            if (t.type != token_type::op)
+                return nullptr;
+            for (const auto& op : operators)
+                if (op.text == t.text)
+                    return &op;
+            return nullptr;
+        }
 
-        /*** priority: 12 ***/
-        op_or = 17,
+        bool is_op(std::string_view op) const noexcept
+        {
+            return _token.type == token_type::op && _token.text == op;
+        }
 
-        /*** priority: 13 ***/
-        op_land = 18,
+        void next()
+        {
+            while (_pos != _end && (cls::is_space(_pos) || cls::is_newline(_pos) || *_pos == '\\'))
+                ++_pos;
 
-        /*** priority: 14 ***/
-        op_lor = 19,
-    };
-
-    struct eval_item
-    {
-        const char* first_after_op;
-        const char* first_of_op;
-        eval_op o;
-    };
-    
-    bool substreq(const char* x, const char* y, int len)
-    {
-        return std::strncmp(x, y, len) == 0;
-    }
+            if (_pos == _end)
+            {
+                _token = { token_type::end, {}, 0 };
+                return;
+            }
 
-    int eval_operator(const char* begin, const eval_item& o, int len, const files::path& file, const int line, processed_file& processed);
-    int eval(const char* x, int len, const files::path& file, const int line, processed_file& processed)
-    {
-        enum state
+            const char* const begin = _pos;
+            if (lexer::has_class(*_pos, lexer::char_class::digit))
+            {
+                int base = 10;
+                if (_pos[0] == '0' && _end - _pos > 1 && (_pos[1] == 'x' || _pos[1] == 'X'))
+                {
+                    base = 16;
+                    _pos += 2;
+                }
+                else if (_pos[0] == '0')
+                    base = 8;
+
+                uint64_t value = 0;
+                const auto [number_end, error] = std::from_chars(_pos, _end, value, base);
+                _pos = number_end;
+                while (_pos != _end && (*_pos == 'u' || *_pos == 'U' || *_pos == 'l' || *_pos == 'L'))
+                    ++_pos;
+
+                // A single "0" is a valid octal number with no digits after the prefix.
+                const bool valid = (error == std::errc{} || (base == 8 && number_end == begin + 1))
+                    && (_pos == _end || !lexer::has_class(*_pos, lexer::char_class::name));
+                while (_pos != _end && lexer::has_class(*_pos, lexer::char_class::name))
+                    ++_pos;
+                _token = { valid ? token_type::number : token_type::invalid, { begin, static_cast<size_t>(_pos - begin) }, static_cast<int64_t>(value) };
+                return;
+            }
+
+            if (lexer::has_class(*_pos, lexer::char_class::name))
+            {
+                while (_pos != _end && lexer::has_class(*_pos, lexer::char_class::name))
+                    ++_pos;
+                _token = { token_type::name, { begin, static_cast<size_t>(_pos - begin) }, 0 };
+                return;
+            }
+
+            if (_end - _pos > 1)
+            {
+                for (const std::string_view op : { "||", "&&", "==", "!=", "<=", ">=", "<<", ">>" })
+                {
+                    if (_pos[0] == op[0] && _pos[1] == op[1])
+                    {
+                        _pos += 2;
+                        _token = { token_type::op, op, 0 };
+                        return;
+                    }
+                }
+            }
+
+            ++_pos;
+            constexpr std::string_view single_ops = "+-*/%<>&^|!~?:()";
+            _token = { single_ops.find(*begin) != std::string_view::npos ? token_type::op : token_type::invalid,
+                { begin, 1 }, 0 };
+        }
+
+        size_t emit(op_code code, uint32_t operand = 0)
         {
-            def = 0,
-            inop = 1,
-        };
+            _expr._code.push_back({ code, operand });
+            return _expr._code.size() - 1;
+        }
 
-        state s = def;
-        std::list<eval_item> opstack;
+        void emit_constant(int64_t value)
+        {
+            _expr._constants.push_back(value);
+            emit(op_code::constant, static_cast<uint32_t>(_expr._constants.size() - 1));
+        }
 
-        while (*x == ' ' || *x == '\t')
+        /* Lets a previously emitted jump target the next instruction. */
+        void patch(size_t jump)
         {
-            ++x;
-            --len;
+            _expr._code[jump].operand = static_cast<uint32_t>(_expr._code.size());
         }
-        while (*(x + len - 1) == ' ' || *(x + len - 1) == '\t')
-            --len;
 
-        if (*x == '(' && *(x + len - 1) == ')')
-            ++x, len -= 2;
+        bool error(const std::string& message)
+        {
+            ++_ctx.processed.error_count;
+            syntax_error_print(_file, _line, message);
+            return false;
+        }
 
-        const char* begin = x;
+        bool unexpected()
+        {
+            const std::string text = _token.type == token_type::end ? "end of expression" : std::string(_token.text);
+            return error(strfmt(strings::serr_eval_unexpected_token, text.c_str()));
+        }
 
-        for (auto c = x; c < x + len; ++c)
+        bool parse_conditional()
         {
-            if (s == def)
+            if (!parse_binary(1))
+                return false;
+            if (!is_op("?"))
+                return true;
+            next();
+
+            const size_t jump_to_else = emit(op_code::jump_if_zero);
+            if (!parse_conditional())
+                return false;
+            if (!is_op(":"))
+                return unexpected();
+            next();
+
+            const size_t jump_to_end = emit(op_code::jump);
+            patch(jump_to_else);
+            if (!parse_conditional())
+                return false;
+            patch(jump_to_end);
+            return true;
+        }
+
+        bool parse_binary(int min_precedence)
+        {
+            if (!parse_unary())
+                return false;
+
+            for (;;)
             {
-                if (substreq(c, "-", 1))      opstack.push_back({ c + 1, c, op_neg });
-                else if (substreq(c, "+", 1)) opstack.push_back({ c + 1, c, op_pos });
-                else if (substreq(c, "!", 1)) opstack.push_back({ c + 1, c, op_not });
-                else if (substreq(c, "~", 1)) opstack.push_back({ c + 1, c, op_inv });
-                else if (substreq(c, "(", 1))
+                const binary_operator* op = find_binary(_token);
+                if (!op || op->precedence < min_precedence)
+                    return true;
+                next();
+
+                if (op->code == op_code::land || op->code == op_code::lor)
                 {
-                    for (int stk = 1; stk != 0; )
-                    {
-                        ++c;
-                        if (c - begin > len)
-                        {
-                            ++processed.error_count;
-                            syntax_error_print(file, line, strings::serr_eval_end_of_brackets);
-                            return 0;
-                        }
-                        if (*c == '(') ++stk;
-                        if (*c == ')') --stk;
-                    }
-                    ++c;
-                    s = inop;
+                    const size_t jump = emit(op->code);
+                    if (!parse_binary(op->precedence + 1))
+                        return false;
+                    emit(op_code::to_bool);
+                    patch(jump);
+                }
+                else
+                {
+                    if (!parse_binary(op->precedence + 1))
+                        return false;
+                    emit(op->code);
                 }
             }
-            else if (s == inop)
+        }
+
+        bool parse_unary()
+        {
+            switch (_token.type)
             {
-                if      (substreq(c, "*",  1)) opstack.push_back({ c + 1, c, op_mul  });
-                else if (substreq(c, "/",  1)) opstack.push_back({ c + 1, c, op_div  });
-                else if (substreq(c, "%",  1)) opstack.push_back({ c + 1, c, op_mod  });
-                else if (substreq(c, "+",  1)) opstack.push_back({ c + 1, c, op_add  });
-                else if (substreq(c, "-",  1)) opstack.push_back({ c + 1, c, op_sub  });
-                else if (substreq(c, "<=", 2)) opstack.push_back({ c + 2, c, op_leq  });
-                else if (substreq(c, "<",  1)) opstack.push_back({ c + 1, c, op_lt   });
-                else if (substreq(c, ">=", 2)) opstack.push_back({ c + 2, c, op_geq  });
-                else if (substreq(c, ">",  1)) opstack.push_back({ c + 1, c, op_gt   });
-                else if (substreq(c, "==", 2)) opstack.push_back({ c + 2, c, op_eq   });
-                else if (substreq(c, "!=", 2)) opstack.push_back({ c + 2, c, op_neq  });
-                else if (substreq(c, "&&", 2)) opstack.push_back({ c + 2, c, op_land });
-                else if (substreq(c, "||", 2)) opstack.push_back({ c + 2, c, op_lor  });
-                else if (substreq(c, "&",  1)) opstack.push_back({ c + 1, c, op_and  });
-                else if (substreq(c, "^",  1)) opstack.push_back({ c + 1, c, op_xor  });
-                else if (substreq(c, "|",  1)) opstack.push_back({ c + 1, c, op_or   });
+            case token_type::number:
+                emit_constant(_token.value);
+                next();
+                return true;
+
+            case token_type::name:
+                if (_token.text == "defined")
+                {
+                    next();
+                    const bool parenthesized = is_op("(");
+                    if (parenthesized)
+                        next();
+                    if (_token.type != token_type::name)
+                        return error(strings::serr_eval_defined_operand);
+
+                    _expr._names.emplace_back(_token.text);
+                    emit(op_code::defined, static_cast<uint32_t>(_expr._names.size() - 1));
+                    next();
+                    if (parenthesized)
+                    {
+                        if (!is_op(")"))
+                            return error(strings::serr_eval_end_of_brackets);
+                        next();
+                    }
+                    return true;
+                }
+                // Identifiers which are left after macro expansion evaluate to 0.
+                emit_constant(0);
+                next();
+                return true;
+
+            case token_type::op:
+                if (is_op("("))
+                {
+                    next();
+                    if (!parse_conditional())
+                        return false;
+                    if (!is_op(")"))
+                        return error(strings::serr_eval_end_of_brackets);
+                    next();
+                    return true;
+                }
+                if (is_op("+"))
+                {
+                    next();
+                    return parse_unary();
+                }
+                for (const auto& [text, code] : { std::pair{ "-", op_code::neg }, std::pair{ "!", op_code::lnot }, std::pair{ "~", op_code::inv } })
+                {
+                    if (is_op(text))
+                    {
+                        next();
+                        if (!parse_unary())
+                            return false;
+                        emit(code);
+                        return true;
+                    }
+                }
+                return unexpected();
+
+            default:
+                return unexpected();
             }
+        }
+
+        expression& _expr;
+        const char* _pos;
+        const char* const _end;
+        token _token{ token_type::end, {}, 0 };
+
+        const files::path& _file;
+        const int _line;
+        context& _ctx;
+    };
+
+    bool expression::compile(std::string_view text, const files::path& current_file, const int current_line, context& ctx)
+    {
+        _code.clear();
+        _constants.clear();
+        _names.clear();
+
+        if (parser(*this, text, current_file, current_line, ctx).parse())
+            return true;
+
+        _code.clear();
+        _constants.clear();
+        _names.clear();
+        return false;
+    }
+
+    int64_t expression::evaluate(const files::path& current_file, const int current_line, context& ctx) const
+    {
+        if (_code.empty())
+            return 0;
 
-            if (isdigit(*c))
-                s = inop;
-            else if (*c != ' ')
-                s = def;
+        // The stack never holds more values than there are instructions.
+        constexpr size_t local_size = 32;
+        int64_t local_stack[local_size];
+        std::vector<int64_t> heap_stack;
+        int64_t* stack = local_stack;
+        if (_code.size() > local_size)
+        {
+            heap_stack.resize(_code.size());
+            stack = heap_stack.data();
         }
 
-        if (opstack.empty())
+        // Arithmetic wraps around instead of overflowing.
+        const auto wrap = [](uint64_t value) { return static_cast<int64_t>(value); };
+
+        size_t top = 0;
+        for (size_t pc = 0; pc < _code.size(); ++pc)
         {
-            std::string val(begin, begin + len);
-            for(const auto& c : val)
+            const instruction& in = _code[pc];
+            switch (in.code)
             {
-                if (!(c >= '0' && c <= '9'))
-                    return 0;
+            case op_code::constant:
+                stack[top++] = _constants[in.operand];
+                continue;
+            case op_code::defined:
+                stack[top++] = macro::is_defined(_names[in.operand], ctx) ? 1 : 0;
+                continue;
+            case op_code::jump:
+                pc = in.operand - 1;
+                continue;
+            default:
+                break;
             }
-            return std::stoi(std::string(begin, begin + len));
-        }
 
-        eval_op ox = opstack.front().o;
-        auto limit = opstack.begin();
-        for (auto it = opstack.begin(); it != opstack.end(); ++it)
-            if (it->o > ox)
+            // Unary operators and conditional jumps
+            int64_t& value = stack[top - 1];
+            switch (in.code)
             {
-                ox = it->o;
-                limit = it;
+            case op_code::neg: value = wrap(0 - static_cast<uint64_t>(value)); continue;
+            case op_code::inv: value = ~value; continue;
+            case op_code::lnot: value = !value; continue;
+            case op_code::to_bool: value = value != 0; continue;
+            case op_code::land:
+                if (value == 0)
+                    pc = in.operand - 1;
+                else
+                    --top;
+                continue;
+            case op_code::lor:
+                if (value != 0)
+                {
+                    value = 1;
+                    pc = in.operand - 1;
+                }
+                else
+                    --top;
+                continue;
+            case op_code::jump_if_zero:
+                --top;
+                if (value == 0)
+                    pc = in.operand - 1;
+                continue;
+            default:
+                break;
             }
 
-        if (limit == opstack.end())
-            limit = opstack.begin();
-
-        return eval_operator(begin, *limit, len, file, line, processed);
+            // Binary operators
+            const int64_t rhs = stack[--top];
+            int64_t& lhs = stack[top - 1];
+            switch (in.code)
+            {
+            case op_code::mul: lhs = wrap(static_cast<uint64_t>(lhs) * static_cast<uint64_t>(rhs)); break;
+            case op_code::add: lhs = wrap(static_cast<uint64_t>(lhs) + static_cast<uint64_t>(rhs)); break;
+            case op_code::sub: lhs = wrap(static_cast<uint64_t>(lhs) - static_cast<uint64_t>(rhs)); break;
+            case op_code::div:
+            case op_code::mod:
+                if (rhs == 0)
+                {
+                    ++ctx.processed.error_count;
+                    syntax_error_print(current_file, current_line, strings::serr_eval_division_by_zero);
+                    lhs = 0;
+                }
+                else if (rhs == -1)
+                    lhs = in.code == op_code::div ? wrap(0 - static_cast<uint64_t>(lhs)) : 0;
+                else
+                    lhs = in.code == op_code::div ? lhs / rhs : lhs % rhs;
+                break;
+            case op_code::shl: lhs = (rhs < 0 || rhs > 63) ? 0 : wrap(static_cast<uint64_t>(lhs) << rhs); break;
+            case op_code::shr: lhs = (rhs < 0 || rhs > 63) ? (lhs < 0 ? -1 : 0) : lhs >> rhs; break;
+            case op_code::lt: lhs = lhs < rhs; break;
+            case op_code::leq: lhs = lhs <= rhs; break;
+            case op_code::gt: lhs = lhs > rhs; break;
+            case op_code::geq: lhs = lhs >= rhs; break;
+            case op_code::eq: lhs = lhs == rhs; break;
+            case op_code::neq: lhs = lhs != rhs; break;
+            case op_code::band: lhs = lhs & rhs; break;
+            case op_code::bxor: lhs = lhs ^ rhs; break;
+            case op_code::bor: lhs = lhs | rhs; break;
+            default: break;
+            }
+        }
+        return top == 0 ? 0 : stack[top - 1];
     }
 
-    int eval_operator(const char* begin, const eval_item& o, int len, const files::path& file, const int line, processed_file& processed)
+    int64_t eval(std::string_view text, const files::path& current_file, const int current_line, context& ctx)
     {
-        const int num_begin = int(o.first_of_op - begin);
-        const int num_end = int(len - (o.first_after_op - begin));
-
-        /*** Curious switch :P ***/
-        switch (o.o)
-        {
-        case op_neg:    return - eval(o.first_after_op, num_end, file, line, processed);
-        case op_pos:    return + eval(o.first_after_op, num_end, file, line, processed);
-        case op_not:    return ! eval(o.first_after_op, num_end, file, line, processed);
-        case op_inv:    return ~ eval(o.first_after_op, num_end, file, line, processed);
-        case op_mul:    return eval(begin, num_begin, file, line, processed) *  eval(o.first_after_op, num_end, file, line, processed);
-        case op_div:    return eval(begin, num_begin, file, line, processed) /  eval(o.first_after_op, num_end, file, line, processed);
-        case op_mod:    return eval(begin, num_begin, file, line, processed) %  eval(o.first_after_op, num_end, file, line, processed);
-        case op_add:    return eval(begin, num_begin, file, line, processed) +  eval(o.first_after_op, num_end, file, line, processed);
-        case op_sub:    return eval(begin, num_begin, file, line, processed) -  eval(o.first_after_op, num_end, file, line, processed);
-        case op_lt:     return eval(begin, num_begin, file, line, processed) <  eval(o.first_after_op, num_end, file, line, processed);
-        case op_leq:    return eval(begin, num_begin, file, line, processed) <= eval(o.first_after_op, num_end, file, line, processed);
-        case op_gt:     return eval(begin, num_begin, file, line, processed) >  eval(o.first_after_op, num_end, file, line, processed);
-        case op_geq:    return eval(begin, num_begin, file, line, processed) >= eval(o.first_after_op, num_end, file, line, processed);
-        case op_eq:     return eval(begin, num_begin, file, line, processed) == eval(o.first_after_op, num_end, file, line, processed);
-        case op_neq:    return eval(begin, num_begin, file, line, processed) != eval(o.first_after_op, num_end, file, line, processed);
-        case op_and:    return eval(begin, num_begin, file, line, processed) &  eval(o.first_after_op, num_end, file, line, processed);
-        case op_xor:    return eval(begin, num_begin, file, line, processed) ^  eval(o.first_after_op, num_end, file, line, processed);
-        case op_or:     return eval(begin, num_begin, file, line, processed) |  eval(o.first_after_op, num_end, file, line, processed);
-        case op_land:   return eval(begin, num_begin, file, line, processed) && eval(o.first_after_op, num_end, file, line, processed);
-        case op_lor:    return eval(begin, num_begin, file, line, processed) || eval(o.first_after_op, num_end, file, line, processed);
-        default:        return 0;
-        }
+        expression expr;
+        if (!expr.compile(text, current_file, current_line, ctx))
+            return 0;
+        return expr.evaluate(current_file, current_line, ctx);
     }
-}
\ No newline at end of file
+}
@@ -1,12 +1,62 @@
 #pragma once
 
 #include <glsp/preprocess.hpp>
+#include "context.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace glshader::process::impl::operation
 {
     /***
-    Takes a const char* substring with a given length and tries to evaluate it's value.
-    Evaluates arithmetical, logical and comparison operations on integral values.
+    An #if expression compiled into bytecode for a small stack machine with 64-bit integer semantics.
+    "defined X" and "defined(X)" are resolved at evaluation time, so a compiled expression can be evaluated
+    again after the set of macros has changed. && , || and ?: only evaluate the operands they need.
+    ***/
+    class expression
+    {
+    public:
+        /* Parses a macro-expanded expression in a single pass. Reports an error and returns false on syntax errors. */
+        bool compile(std::string_view text, const files::path& current_file, int current_line, context& ctx);
+
+        int64_t evaluate(const files::path& current_file, int current_line, context& ctx) const;
+
+        /* All names used as operands of "defined". */
+        const std::vector<std::string>& defined_names() const noexcept { return _names; }
+
+    private:
+        class parser;
+
+        enum class op_code : uint8_t
+        {
+            constant,       /* push constants[operand] */
+            defined,        /* push whether names[operand] is defined */
+            neg, inv, lnot,
+            mul, div, mod, add, sub, shl, shr,
+            lt, leq, gt, geq, eq, neq,
+            band, bxor, bor,
+            land,           /* if top is 0, jump to operand, otherwise pop */
+            lor,            /* if top is not 0, replace with 1 and jump to operand, otherwise pop */
+            to_bool,
+            jump_if_zero,   /* pop and jump to operand if 0 */
+            jump,
+        };
+
+        struct instruction
+        {
+            op_code code;
+            uint32_t operand;
+        };
+
+        std::vector<instruction> _code;
+        std::vector<int64_t> _constants;
+        std::vector<std::string> _names;
+    };
+
+    /***
+    Compiles and evaluates a macro-expanded #if expression once.
     ***/
-    int eval(const char* x, int len, const files::path& current_file, const int current_line, processed_file& processed);
+    int64_t eval(std::string_view text, const files::path& current_file, const int current_line, context& ctx);
 }
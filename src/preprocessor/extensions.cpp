@@ -1,22 +1,150 @@
 #include "extensions.hpp"
-#include <set>
-#include <string>
+#include "extension_names.hpp"
+
+#include <array>
+#include <mutex>
+#include <shared_mutex>
 
 namespace glshader::process::impl::ext
 {
-    std::set<std::string> _extensions;
-    void enable_extension(const char* extension)
+    namespace
+    {
+        constexpr uint64_t hash(std::string_view name) noexcept
+        {
+            uint64_t hash = 0xcbf29ce484222325ull;
+            for (const char c : name)
+                hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3ull;
+            return hash;
+        }
+
+        constexpr uint64_t mix(uint64_t x) noexcept
+        {
+            x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+            x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+            return x ^ (x >> 31);
+        }
+
+        constexpr size_t bucket_count = known_names.size() / 4 + 1;
+        constexpr size_t slot_count = 1024;
+        constexpr uint16_t empty_slot = 0xffff;
+        static_assert(known_names.size() < slot_count, "Increase slot_count to keep the load factor below 1.");
+
+        constexpr size_t bucket(uint64_t hash) noexcept { return static_cast<size_t>(hash >> 32) % bucket_count; }
+        constexpr size_t slot(uint64_t hash, uint16_t displacement) noexcept
+        {
+            return static_cast<size_t>(mix(hash + displacement * 0x9e3779b97f4a7c15ull)) & (slot_count - 1);
+        }
+
+        /* Hash and displace: every name is assigned to a bucket by its hash, and every bucket gets the smallest
+        displacement which moves all of its names into free slots. Larger buckets are placed first. */
+        struct perfect_hash
+        {
+            std::array<uint16_t, bucket_count> displacements{};
+            std::array<uint16_t, slot_count> ids{};
+        };
+
+        constexpr perfect_hash build_perfect_hash()
+        {
+            std::array<uint64_t, known_names.size()> hashes{};
+            std::array<uint16_t, bucket_count> sizes{};
+            size_t largest = 0;
+            for (size_t i = 0; i < known_names.size(); ++i)
+            {
+                hashes[i] = hash(known_names[i]);
+                const size_t size = ++sizes[bucket(hashes[i])];
+                largest = size > largest ? size : largest;
+            }
+
+            perfect_hash result{};
+            for (auto& id : result.ids)
+                id = empty_slot;
+
+            for (size_t size = largest; size > 0; --size)
+            {
+                for (size_t b = 0; b < bucket_count; ++b)
+                {
+                    if (sizes[b] != size)
+                        continue;
+
+                    std::array<uint16_t, known_names.size()> members{};
+                    size_t member_count = 0;
+                    for (size_t i = 0; i < known_names.size(); ++i)
+                        if (bucket(hashes[i]) == b)
+                            members[member_count++] = static_cast<uint16_t>(i);
+
+                    for (uint32_t displacement = 0;; ++displacement)
+                    {
+                        if (displacement > 0xffff)
+                            throw "No displacement found for an extension bucket.";
+
+                        std::array<size_t, known_names.size()> slots{};
+                        bool fits = true;
+                        for (size_t m = 0; m < member_count && fits; ++m)
+                        {
+                            slots[m] = slot(hashes[members[m]], static_cast<uint16_t>(displacement));
+                            fits = result.ids[slots[m]] == empty_slot;
+                            for (size_t other = 0; other < m && fits; ++other)
+                                fits = slots[other] != slots[m];
+                        }
+                        if (!fits)
+                            continue;
+
+                        result.displacements[b] = static_cast<uint16_t>(displacement);
+                        for (size_t m = 0; m < member_count; ++m)
+                            result.ids[slots[m]] = members[m];
+                        break;
+                    }
+                }
+            }
+            return result;
+        }
+
+        constexpr perfect_hash table = build_perfect_hash();
+
+        constexpr uint32_t find_id(std::string_view name) noexcept
+        {
+            const uint64_t name_hash = hash(name);
+            const uint16_t id = table.ids[slot(name_hash, table.displacements[bucket(name_hash)])];
+            return id != empty_slot && known_names[id] == name ? id : unknown_id;
+        }
+    }
+
+    static_assert(find_id("GL_ARB_bindless_texture") != unknown_id && known_names[find_id("GL_ARB_bindless_texture")] == "GL_ARB_bindless_texture");
+    static_assert(find_id("GL_ARB_not_an_extension") == unknown_id);
+
+    uint32_t known_id(std::string_view name) noexcept
+    {
+        return find_id(name);
+    }
+
+    std::string_view known_name(uint32_t id) noexcept
+    {
+        return known_names[id];
+    }
+
+    size_t known_count() noexcept
+    {
+        return known_names.size();
+    }
+
+    std::shared_mutex _extensions_mutex;
+    extension_set _extensions;
+
+    void enable_extensions(const extension_set& extensions)
     {
-        _extensions.emplace(extension);
+        std::unique_lock<std::shared_mutex> lock(_extensions_mutex);
+        _extensions.merge(extensions);
     }
 
-    bool extension_available(const std::string& extension)
+    bool extension_available(std::string_view extension)
     {
-        return _extensions.count(extension) != 0;
+        std::shared_lock<std::shared_mutex> lock(_extensions_mutex);
+        return _extensions.contains(extension);
     }
 
-    const std::set<std::string>& extensions() noexcept
+    extension_set extensions()
     {
+        std::shared_lock<std::shared_mutex> lock(_extensions_mutex);
         return _extensions;
     }
-}
\ No newline at end of file
+}
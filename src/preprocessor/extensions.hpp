@@ -1,11 +1,24 @@
 #pragma once
 
-#include <set>
+#include <glsp/capabilities.hpp>
+
+#include <cstdint>
 #include <string>
+#include <string_view>
 
 namespace glshader::process::impl::ext
 {
-    void enable_extension(const char* extension);
-    bool extension_available(const std::string& extension);
-    const std::set<std::string>& extensions() noexcept;
-}
\ No newline at end of file
+    constexpr uint32_t unknown_id = ~uint32_t(0);
+
+    /* Returns the index of a registry extension name in known_names, or unknown_id. Costs one hash and one string comparison. */
+    uint32_t known_id(std::string_view name) noexcept;
+    /* Returns the name of a registry extension. */
+    std::string_view known_name(uint32_t id) noexcept;
+    /* The number of registry extensions. */
+    size_t known_count() noexcept;
+
+    /* The extensions of all GL contexts seen so far, used when no capabilities are given. Shared by all threads. */
+    void enable_extensions(const extension_set& extensions);
+    bool extension_available(std::string_view extension);
+    extension_set extensions();
+}
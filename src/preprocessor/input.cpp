@@ -0,0 +1,39 @@
+#include "input.hpp"
+
+#include <glsp/cache.hpp>
+
+
+namespace glshader::process::impl::input
+{
+    files::path find_include(const files::path& name, const files::path& including_directory, const std::vector<files::path>& include_directories)
+    {
+        std::error_code error;
+        const auto canonical_if_file = [&](const files::path& candidate) {
+            if (!files::is_regular_file(candidate, error))
+                return files::path{};
+            auto path = files::canonical(candidate, error);
+            return error ? files::path{} : path;
+        };
+
+        for (auto directory = include_directories.rbegin(); directory != include_directories.rend(); ++directory)
+        {
+            if (auto path = canonical_if_file(*directory / name); !path.empty())
+                return path;
+        }
+        return canonical_if_file(including_directory / name);
+    }
+
+    files::path resolve_include(const files::path& name, const files::path& including_directory, const std::vector<files::path>& include_directories,
+        const context& ctx)
+    {
+        return ctx.include_paths ? ctx.include_paths->resolve(name, including_directory, include_directories)
+            : find_include(name, including_directory, include_directories);
+    }
+
+    std::shared_ptr<const source_buffer> load(const files::path& path, const context& ctx)
+    {
+        if (ctx.file_contents)
+            return ctx.file_contents->load(path, ctx.memory_map);
+        return ctx.memory_map ? source_buffer::map(path) : source_buffer::read(path);
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <glsp/preprocess.hpp>
+#include <glsp/source_buffer.hpp>
+#include "context.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace glshader::process::impl::input
+{
+    /* Searches an included file in the include directories and then in the directory of the including file.
+    If multiple include directories contain the file, the last one wins. Returns the canonical path of the match, or an empty path. */
+    files::path find_include(const files::path& name, const files::path& including_directory, const std::vector<files::path>& include_directories);
+
+    /* Resolves an included file through the include cache of the current run. */
+    files::path resolve_include(const files::path& name, const files::path& including_directory, const std::vector<files::path>& include_directories,
+        const context& ctx);
+
+    /* Loads a file through the file cache of the current run, or reads or maps it if there is none. */
+    std::shared_ptr<const source_buffer> load(const files::path& path, const context& ctx);
+}
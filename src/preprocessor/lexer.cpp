@@ -0,0 +1,165 @@
+#include "lexer.hpp"
+
+#include <cstddef>
+
+#if defined(__has_feature)
+    #if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer)
+        #define GLSP_LEXER_SANITIZED
+    #endif
+#endif
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+    #define GLSP_LEXER_SANITIZED
+#endif
+
+// The vectorized scanners load whole aligned blocks around the terminating '\0', which sanitizers report as overflows.
+#if defined(GLSP_LEXER_SANITIZED)
+#elif defined(__AVX2__)
+    #include <immintrin.h>
+    #define GLSP_LEXER_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define GLSP_LEXER_SSE2
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+    #include <intrin.h>
+#endif
+
+namespace glshader::process::impl::lexer
+{
+    namespace
+    {
+        /* Bytes a scanner stops at: an arbitrary set of characters, optionally extended by all name characters. */
+        template<bool Names, char... Chars>
+        struct stop_set
+        {
+            static constexpr bool match(char c) noexcept
+            {
+                return ((c == Chars) || ...) || (Names && has_class(c, char_class::name));
+            }
+        };
+
+#if defined(GLSP_LEXER_AVX2) || defined(GLSP_LEXER_SSE2)
+        inline unsigned first_bit(uint32_t mask) noexcept
+        {
+#if defined(_MSC_VER) && !defined(__clang__)
+            unsigned long index;
+            _BitScanForward(&index, mask);
+            return static_cast<unsigned>(index);
+#else
+            return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+        }
+#endif
+
+#if defined(GLSP_LEXER_AVX2)
+        using vector = __m256i;
+        constexpr size_t vector_size = 32;
+
+        inline vector load(const char* c) noexcept { return _mm256_load_si256(reinterpret_cast<const vector*>(c)); }
+        inline vector splat(char c) noexcept { return _mm256_set1_epi8(c); }
+        inline vector eq(vector a, vector b) noexcept { return _mm256_cmpeq_epi8(a, b); }
+        inline vector gt(vector a, vector b) noexcept { return _mm256_cmpgt_epi8(a, b); }
+        inline vector bit_or(vector a, vector b) noexcept { return _mm256_or_si256(a, b); }
+        inline vector bit_and(vector a, vector b) noexcept { return _mm256_and_si256(a, b); }
+        inline vector zero() noexcept { return _mm256_setzero_si256(); }
+        inline uint32_t movemask(vector v) noexcept { return static_cast<uint32_t>(_mm256_movemask_epi8(v)); }
+#elif defined(GLSP_LEXER_SSE2)
+        using vector = __m128i;
+        constexpr size_t vector_size = 16;
+
+        inline vector load(const char* c) noexcept { return _mm_load_si128(reinterpret_cast<const vector*>(c)); }
+        inline vector splat(char c) noexcept { return _mm_set1_epi8(c); }
+        inline vector eq(vector a, vector b) noexcept { return _mm_cmpeq_epi8(a, b); }
+        inline vector gt(vector a, vector b) noexcept { return _mm_cmpgt_epi8(a, b); }
+        inline vector bit_or(vector a, vector b) noexcept { return _mm_or_si128(a, b); }
+        inline vector bit_and(vector a, vector b) noexcept { return _mm_and_si128(a, b); }
+        inline vector zero() noexcept { return _mm_setzero_si128(); }
+        inline uint32_t movemask(vector v) noexcept { return static_cast<uint32_t>(_mm_movemask_epi8(v)); }
+#endif
+
+#if defined(GLSP_LEXER_AVX2) || defined(GLSP_LEXER_SSE2)
+        /* Signed byte range check. Bytes >= 0x80 are negative and therefore never inside of an ASCII range. */
+        inline vector in_range(vector v, char lo, char hi) noexcept
+        {
+            return bit_and(gt(v, splat(lo - 1)), gt(splat(hi + 1), v));
+        }
+
+        template<bool Names, char... Chars>
+        inline uint32_t match(vector v) noexcept
+        {
+            vector m = zero();
+            ((m = bit_or(m, eq(v, splat(Chars)))), ...);
+            if constexpr (Names)
+            {
+                const vector lower = bit_or(v, splat(0x20));
+                m = bit_or(m, in_range(lower, 'a', 'z'));
+                m = bit_or(m, in_range(v, '0', '9'));
+                m = bit_or(m, eq(v, splat('_')));
+            }
+            return movemask(m);
+        }
+#endif
+
+        template<bool Names, char... Chars>
+        const char* find_first(const char* c, const char* end) noexcept
+        {
+#if defined(GLSP_LEXER_AVX2) || defined(GLSP_LEXER_SSE2)
+            if (c >= end)
+                return end;
+
+            // Only aligned blocks starting before end are loaded. They never cross a page boundary,
+            // so reading the bytes around the range is safe even though they are outside of it.
+            const size_t misalignment = reinterpret_cast<uintptr_t>(c) & (vector_size - 1);
+            const char* block = c - misalignment;
+            uint32_t mask = match<Names, Chars...>(load(block)) & (~uint32_t(0) << misalignment);
+            while (mask == 0)
+            {
+                block += vector_size;
+                if (block >= end)
+                    return end;
+                mask = match<Names, Chars...>(load(block));
+            }
+            const char* const found = block + first_bit(mask);
+            return found < end ? found : end;
+#else
+            while (c < end && !stop_set<Names, Chars...>::match(*c))
+                ++c;
+            return c < end ? c : end;
+#endif
+        }
+    }
+
+    const char* scan_verbatim(const char* c, const char* end) noexcept
+    {
+        return find_first<true, '\n', '\r', '#', '/'>(c, end);
+    }
+
+    const char* scan_line(const char* c, const char* end) noexcept
+    {
+        return find_first<false, '\n', '\r'>(c, end);
+    }
+
+    const char* scan_line_or_comment(const char* c, const char* end) noexcept
+    {
+        return find_first<false, '\n', '\r', '/'>(c, end);
+    }
+
+    const char* scan_line_or_directive(const char* c, const char* end) noexcept
+    {
+        return find_first<false, '\n', '\r', '#'>(c, end);
+    }
+
+    const char* scan_block_comment(const char* c, const char* end) noexcept
+    {
+        return find_first<false, '\n', '\r', '*'>(c, end);
+    }
+
+    const char* scan_name(const char* c, const char* end) noexcept
+    {
+        // Names are short, a table lookup per character beats setting up a vector compare.
+        while (c < end && has_class(*c, char_class::name))
+            ++c;
+        return c;
+    }
+}
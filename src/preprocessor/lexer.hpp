@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace glshader::process::impl::lexer
+{
+    /* Bit flags describing the lexical class of a single byte. */
+    namespace char_class
+    {
+        constexpr uint8_t eof       = 1 << 0;
+        constexpr uint8_t newline   = 1 << 1;
+        constexpr uint8_t space     = 1 << 2;
+        constexpr uint8_t alpha     = 1 << 3;
+        constexpr uint8_t digit     = 1 << 4;
+        constexpr uint8_t name      = 1 << 5;
+        constexpr uint8_t op        = 1 << 6;
+        constexpr uint8_t special   = 1 << 7;   /* '#' and '/', which may start a directive or a comment. */
+    }
+
+    constexpr std::array<uint8_t, 256> make_class_table()
+    {
+        std::array<uint8_t, 256> table{};
+        table['\0'] = char_class::eof;
+        table['\n'] = table['\r'] = char_class::newline;
+        table[' '] = table['\t'] = char_class::space;
+        for (int c = 'a'; c <= 'z'; ++c)
+            table[c] = char_class::alpha | char_class::name;
+        for (int c = 'A'; c <= 'Z'; ++c)
+            table[c] = char_class::alpha | char_class::name;
+        for (int c = '0'; c <= '9'; ++c)
+            table[c] = char_class::digit | char_class::name;
+        table['_'] = char_class::name;
+        for (const char c : std::string_view("+-*/&|^()[]={}~!<>.,;?:"))
+            table[static_cast<uint8_t>(c)] |= char_class::op;
+        table['#'] |= char_class::special;
+        table['/'] |= char_class::special;
+        return table;
+    }
+
+    inline constexpr std::array<uint8_t, 256> class_table = make_class_table();
+
+    constexpr bool has_class(char c, uint8_t classes) noexcept
+    {
+        return (class_table[static_cast<uint8_t>(c)] & classes) != 0;
+    }
+
+    /* All scanners work on the bounded range [c, end) and return end if nothing was found.
+    The byte at end must be readable, the vectorized scanners may read up to the end of its aligned block. */
+
+    /* Returns the first newline, '#', '/' or name character. Everything before it can be copied verbatim. */
+    const char* scan_verbatim           (const char* c, const char* end) noexcept;
+    /* Returns the first newline character. */
+    const char* scan_line               (const char* c, const char* end) noexcept;
+    /* Returns the first newline or '/' character. */
+    const char* scan_line_or_comment    (const char* c, const char* end) noexcept;
+    /* Returns the first newline or '#' character. */
+    const char* scan_line_or_directive  (const char* c, const char* end) noexcept;
+    /* Returns the first newline or '*' character. */
+    const char* scan_block_comment      (const char* c, const char* end) noexcept;
+    /* Returns the first character which is not a name character. */
+    const char* scan_name               (const char* c, const char* end) noexcept;
+}
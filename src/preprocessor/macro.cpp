@@ -4,223 +4,464 @@
 #include "control.hpp"
 #include "skip.hpp"
 #include "extensions.hpp"
+#include "lexer.hpp"
 #include "../strings.hpp"
 
-#include <sstream>
+#include <algorithm>
 #include <cstring>
-#include <optional>
+#include <deque>
 
 namespace glshader::process::impl::macro
 {
   namespace cls = impl::classify;
   namespace ctrl = impl::control;
   namespace skip = impl::skip;
+  namespace lexer = impl::lexer;
 
-  definition_info* parse_macro_definition(const char* text_ptr, processed_file& processed)
+  struct macro_name
   {
-    const auto begin = text_ptr;
-    while (cls::is_name_char(text_ptr))
-      ++text_ptr;
+    std::string_view name;
+    bool has_trailing_brackets;
+  };
 
-    const bool has_trailing_brackets = *skip::space(text_ptr) == '(' && *skip::space(skip::space(text_ptr) + 1) == ')';
+  macro_name read_macro_name(const char* text_ptr, const char* text_end)
+  {
+    const auto name_end = lexer::scan_name(text_ptr, text_end);
+    const auto after_name = skip::space(name_end, text_end);
+    const bool has_trailing_brackets = after_name < text_end && *after_name == '(' && *skip::space(after_name + 1, text_end) == ')';
+    return { { text_ptr, static_cast<size_t>(name_end - text_ptr) }, has_trailing_brackets };
+  }
 
-    const std::string str = std::string(begin, text_ptr) + (has_trailing_brackets ? "()" : "");
+  const macro_entry* parse_macro_definition(const char* text_ptr, const char* text_end, context& ctx)
+  {
+    const auto [name, has_trailing_brackets] = read_macro_name(text_ptr, text_end);
+    if (name.compare(0, 3, "GL_") == 0)
+      return nullptr;
 
-    if (std::strncmp(str.data(), "GL_", 3) == 0)
+    const macro_entry* entry = ctx.definitions.find(name);
+    if (!entry || (entry->empty_parentheses && !has_trailing_brackets))
       return nullptr;
-    if (auto const it = processed.definitions.find(str); it != processed.definitions.end())
-      return &it->second;
-    return nullptr;
+    return entry;
   }
 
-  bool is_defined(const std::string& val, const processed_file& processed)
+  bool is_builtin(std::string_view name, const context& ctx)
   {
-    if (std::strncmp(val.data(), "GL_", 3) == 0 && ext::extension_available(val))
-      return true;
-    return processed.definitions.count(val) != 0;
+    return name.compare(0, 2, "__") == 0 && (name == "__LINE__" || name == "__FILE__" || (name == "__VERSION__" && !ctx.version.empty()));
   }
 
-  bool is_macro(const char* text_ptr, processed_file& processed)
+  bool is_defined(std::string_view val, const context& ctx)
   {
-    const auto begin = text_ptr;
-    while (cls::is_name_char(text_ptr))
-      ++text_ptr;
-
-    const bool has_trailing_brackets = *skip::space(text_ptr) == '(' && *skip::space(skip::space(text_ptr) + 1) == ')';
+    if (val.compare(0, 3, "GL_") == 0 && (ctx.gl ? ctx.gl->has_extension(val) : ext::extension_available(val)))
+      return true;
+    return ctx.definitions.defined(val) || is_builtin(val, ctx);
+  }
 
-    const std::string str = std::string(begin, text_ptr) + (has_trailing_brackets ? "()" : "");
-    return is_defined(str, processed);
+  bool is_macro(const char* text_ptr, const char* text_end, context& ctx)
+  {
+    if (parse_macro_definition(text_ptr, text_end, ctx) != nullptr)
+      return true;
+    return *text_ptr == '_' && is_builtin(read_macro_name(text_ptr, text_end).name, ctx);
   }
 
-  std::string expand_macro(std::string name, const char* param_start, int param_length,
-    const files::path& current_file, const int current_line, processed_file& processed)
+  /* Splits a macro invocation's arguments at all commas which are not nested in parentheses and trims them. */
+  void split_arguments(const char* begin, const char* end, std::vector<std::string_view>& arguments)
   {
-    std::stringstream stream;
-    if (processed.definitions.count(name) == 0)
+    const auto add_argument = [&](const char* arg_begin, const char* arg_end) {
+      while (arg_begin != arg_end && (cls::is_space(arg_begin) || cls::is_newline(arg_begin)))
+        ++arg_begin;
+      while (arg_end != arg_begin && (cls::is_space(arg_end - 1) || cls::is_newline(arg_end - 1)))
+        --arg_end;
+      arguments.emplace_back(arg_begin, static_cast<size_t>(arg_end - arg_begin));
+    };
+
+    int depth = 0;
+    const char* arg_begin = begin;
+    for (const char* c = begin; c != end; ++c)
     {
-      if (param_length == 0)
+      if (*c == '(')
+        ++depth;
+      else if (*c == ')')
+        --depth;
+      else if (*c == ',' && depth == 0)
       {
-        name = name + "()";
-        param_start = nullptr;
-        if (processed.definitions.count(name) == 0)
-          return name;
+        add_argument(arg_begin, c);
+        arg_begin = c + 1;
       }
+    }
+    add_argument(arg_begin, end);
+  }
+
+  /* Rescanning macro expander working on a stack of text chunks instead of re-splicing strings.
+  Each chunk carries a hide-set, the macros whose expansion produced it. Those are not expanded again inside of it,
+  which keeps expansion linear in the output size and terminates for self-referential macros. */
+  class expander
+  {
+  public:
+    expander(const files::path& file, int line, context& ctx, bool keep_defined_operands = false, std::vector<std::string>* reads = nullptr)
+      : _file(file), _line(line), _ctx(ctx), _keep_defined_operands(keep_defined_operands), _reads(reads)
+    {
+      // Hide-set 0 is the empty set.
+      _hide_sets.push_back({ nullptr, 0 });
+    }
+
+    /* Expands the invocation of the macro named at the start of text and everything it pulls in after it.
+    Returns where the invocation ended in text. */
+    const char* expand_invocation(std::string_view text, std::string& out)
+    {
+      _chunks.push_back({ text.data(), text.data() + text.size(), 0 });
+
+      const char* const name_end = lexer::scan_name(text.data(), text.data() + text.size());
+      const std::string_view name(text.data(), static_cast<size_t>(name_end - text.data()));
+      _chunks.back().pos = name_end;
+
+      const macro_entry* entry = find(name);
+      if (entry && expand_macro(*entry, 0, 0))
+        rescan(1, 0, out);
       else
-      {
-        int param_len = static_cast<int>(skip::space(param_start) - param_start);
-        if (param_len == param_length)
-        {
-          name = name + "()";
-          param_start = nullptr;
-          if (processed.definitions.count(name) == 0)
-            return name;
-        }
-        else
-        {
-          return name;
-        }
-      }
+        out.append(name);
+
+      const char* const end = _chunks.front().pos;
+      _chunks.clear();
+      return end;
     }
 
-    auto info = processed.definitions.at(name);
+    void expand_all(std::string_view text, std::string& out)
+    {
+      _chunks.push_back({ text.data(), text.data() + text.size(), 0 });
+      rescan(0, 0, out);
+    }
 
-    if (info.parameters.empty())
-      return info.replacement + (param_start ? std::string(param_start - 1, param_length + 2) : "");
+  private:
+    struct chunk
+    {
+      const char* pos;
+      const char* end;
+      uint32_t hide_set;
+    };
+
+    struct hide_set_node
+    {
+      const macro_entry* macro;
+      uint32_t parent;
+    };
 
-    std::vector<std::string> inputs;
+    /* Fully expanded macro argument. Every run of it keeps the hide-set it was produced with, so that substituting
+    the argument does not make names expandable again which were hidden while expanding it. */
+    struct painted_text
+    {
+      std::string text;
+      std::vector<std::pair<size_t, uint32_t>> runs;   /* Start offset and hide-set of each run. */
+
+      void append(std::string_view part, uint32_t hide_set)
+      {
+        if (part.empty())
+          return;
+        if (runs.empty() || runs.back().second != hide_set)
+          runs.emplace_back(text.size(), hide_set);
+        text.append(part);
+      }
+    };
+
+    /* Position of a character in the chunk stack. */
+    struct cursor
+    {
+      size_t chunk;
+      const char* pos;
+    };
 
-    if (param_start != nullptr)
+    /* Looks up a macro in the table, or creates the entry of a built-in macro with its value at the current position. */
+    const macro_entry* find(std::string_view name)
     {
-      std::stringstream param_stream({ param_start, param_start + param_length });
-      std::string in;
+      if (const macro_entry* entry = _ctx.definitions.find(name))
+        return entry;
+      if (!is_builtin(name, _ctx))
+        return nullptr;
+      for (const auto& builtin : _builtins)
+        if (builtin.name == name)
+          return &builtin;
 
-      while (std::getline(param_stream, in, ','))
+      macro_entry& entry = _builtins.emplace_back();
+      if (name == "__LINE__")
       {
-        const auto bg = skip::space(in.data());
-        inputs.push_back(in.data() + (bg - in.data()));
+        entry.name = "__LINE__";
+        entry.info.replacement = std::to_string(_line);
       }
+      else if (name == "__FILE__")
+      {
+        entry.name = "__FILE__";
+        entry.info.replacement = _file.string();
+      }
+      else
+      {
+        entry.name = "__VERSION__";
+        entry.info.replacement = _ctx.version;
+      }
+      entry.body = macro_body::compile(entry.info);
+      entry.alive = true;
+      return &entry;
     }
 
-    if (inputs.size() != info.parameters.size() || (info.parameters.size() >= inputs.size() - 1 && inputs.back() ==
-      "..."))
+    bool is_hidden(uint32_t hide_set, const macro_entry* macro) const
     {
-      ++processed.error_count;
-      syntax_error_print(current_file, current_line, strfmt(strings::serr_non_matching_argc, name));
-      return "";
+      for (; hide_set != 0; hide_set = _hide_sets[hide_set].parent)
+        if (_hide_sets[hide_set].macro == macro)
+          return true;
+      return false;
     }
 
+    uint32_t hide(uint32_t hide_set, const macro_entry* macro)
+    {
+      _hide_sets.push_back({ macro, hide_set });
+      return static_cast<uint32_t>(_hide_sets.size() - 1);
+    }
 
-    bool skip_stream = false;
-    for (int replacement_offset = 0; replacement_offset < static_cast<int>(info.replacement.length()); ++
-      replacement_offset)
+    /* Processes tokens until the stack shrinks to stop_depth chunks.
+    Function-like invocations may read their arguments from all chunks down to the one at index floor.
+    If painted is set, the output goes there together with its hide-sets instead of into out. */
+    void rescan(size_t stop_depth, size_t floor, std::string& out, painted_text* painted = nullptr)
     {
-      for (int parameter = 0; parameter < static_cast<int>(info.parameters.size()); ++parameter)
+      const auto emit = [&](std::string_view text, uint32_t hide_set) {
+        if (painted)
+          painted->append(text, hide_set);
+        else
+          out.append(text);
+      };
+
+      while (_chunks.size() > stop_depth)
       {
-        if (cls::is_token_equal(&info.replacement[replacement_offset], info.parameters[parameter].data(),
-          static_cast<unsigned>(info.parameters[parameter].length()),
-          replacement_offset != 0))
+        chunk& top = _chunks.back();
+        if (top.pos == top.end)
         {
-          skip_stream = true;
-          stream << inputs[parameter];
-          replacement_offset += static_cast<int>(info.parameters[parameter].length() - 1);
-          break;
+          _chunks.pop_back();
+          continue;
         }
-        if (cls::is_token_equal(&info.replacement[replacement_offset], "__VA_ARGS__", 11, replacement_offset != 0) && info
-          .parameters[parameter] == "...")
+
+        const char* const begin = top.pos;
+        if (lexer::has_class(*begin, lexer::char_class::name))
         {
-          skip_stream = true;
-          for (auto input_parameter = parameter; input_parameter != inputs.size(); ++input_parameter)
-            stream << inputs[input_parameter];
-          break;
+          const char* name_end = begin;
+          while (name_end != top.end && lexer::has_class(*name_end, lexer::char_class::name))
+            ++name_end;
+          top.pos = name_end;
+
+          const std::string_view name(begin, static_cast<size_t>(name_end - begin));
+          if (_keep_defined_operands)
+          {
+            // In conditions, the operand of "defined" is a name and must not be replaced.
+            const bool is_operand = _after_defined;
+            _after_defined = name == "defined";
+            if (is_operand || _after_defined)
+            {
+              emit(name, top.hide_set);
+              continue;
+            }
+          }
+          if (!lexer::has_class(*begin, lexer::char_class::digit) && name.compare(0, 3, "GL_") != 0)
+          {
+            if (_reads && std::find(_reads->begin(), _reads->end(), name) == _reads->end())
+              _reads->emplace_back(name);
+            if (const macro_entry* entry = find(name);
+              entry && !is_hidden(top.hide_set, entry) && expand_macro(*entry, top.hide_set, floor))
+              continue;
+          }
+          emit(name, top.hide_set);
+        }
+        else
+        {
+          const char* run_end = begin + 1;
+          while (run_end != top.end && !lexer::has_class(*run_end, lexer::char_class::name))
+            ++run_end;
+          top.pos = run_end;
+          emit({ begin, static_cast<size_t>(run_end - begin) }, top.hide_set);
         }
       }
-      if (skip_stream)
-        skip_stream = false;
-      else
-        stream << info.replacement[replacement_offset];
     }
-    return stream.str();
-  }
 
-  std::string expand(const char* text_ptr, const char*& text_ptr_after,
-    const files::path& current_file, const int current_line,
-    processed_file& processed)
-  {
-    std::string line(text_ptr, skip::to_endline(text_ptr));
-    bool first_replacement = true;
-    while (true)
+    /* Moves the cursor to the next character which is not a space, descending the stack down to floor. Consumes nothing. */
+    bool peek(cursor& c, size_t floor, bool skip_newlines) const
     {
-      const auto begin = text_ptr;
-      while (cls::is_name_char(text_ptr))
-        ++text_ptr;
-
-      auto* definition = parse_macro_definition(begin, processed);
-      if (!definition)
+      for (;;)
       {
-        if (cls::is_eof(text_ptr) || cls::is_newline(text_ptr) || line.empty() || text_ptr == &line[line.size() - 1])
-          break;
-        ++text_ptr;
-        if (cls::is_eof(text_ptr) || cls::is_newline(text_ptr) || line.empty() || text_ptr == &line[line.size() - 1])
-          break;
-        continue;
+        const chunk& ch = _chunks[c.chunk];
+        while (c.pos != ch.end && (cls::is_space(c.pos) || (skip_newlines && cls::is_newline(c.pos))))
+          ++c.pos;
+        if (c.pos != ch.end)
+          return true;
+        if (c.chunk == floor)
+          return false;
+        --c.chunk;
+        c.pos = _chunks[c.chunk].pos;
       }
+    }
+
+    /* Reads the arguments of a function-like macro invocation if the next token is '('. Consumes them on success. */
+    bool read_arguments(size_t floor, std::string& arguments)
+    {
+      cursor c{ _chunks.size() - 1, _chunks.back().pos };
+      if (!peek(c, floor, false) || *c.pos != '(')
+        return false;
+      ++c.pos;
 
-      char const* params_start = nullptr;
-      char const* end_params = skip::space(text_ptr)-1;
-      int params_length = 0;
-      if (!definition->parameters.empty())
+      int depth = 0;
+      for (;;)
       {
-        const auto begin_params = end_params+1;
-        if (*begin_params == '(')
+        const chunk& ch = _chunks[c.chunk];
+        const char* const begin = c.pos;
+        while (c.pos != ch.end && !(*c.pos == ')' && depth == 0))
         {
-          int bracket_stack = 0;
-          do
-          {
-            ++end_params;
-            if (*end_params == ')')
-              --bracket_stack;
-            else if (*end_params == '(')
-              ++bracket_stack;
-          } while (bracket_stack && !cls::is_eof(end_params));
+          if (*c.pos == '(')
+            ++depth;
+          else if (*c.pos == ')')
+            --depth;
+          ++c.pos;
         }
-        params_start = *begin_params == '(' ? begin_params + 1 : nullptr;
-        params_length = static_cast<int>(*begin_params == '(' ? end_params - params_start : 0);
+        arguments.append(begin, c.pos);
+        if (c.pos != ch.end)
+          break;
+        if (c.chunk == floor)
+          return false;
+        --c.chunk;
+        c.pos = _chunks[c.chunk].pos;
       }
 
-      std::string expanded_macro = expand_macro({ begin, text_ptr }, params_start, static_cast<int>(params_length),
-        current_file, current_line, processed);
+      _chunks.resize(c.chunk + 1);
+      _chunks.back().pos = c.pos + 1;
+      return true;
+    }
 
-      if (first_replacement)
+    bool expand_macro(const macro_entry& entry, uint32_t hide_set, size_t floor)
+    {
+      const definition_info& info = entry.info;
+      if (info.parameters.empty() && !entry.empty_parentheses)
       {
-        first_replacement = false;
-        text_ptr_after = end_params;
-        line = expanded_macro;
+        push_replacement(entry, {}, hide(hide_set, &entry));
+        return true;
       }
-      else
+
+      std::string& arguments = _storage.emplace_back();
+      if (!read_arguments(floor, arguments))
       {
-        line.replace(line.begin() + static_cast<size_t>(begin - line.data()),
-          line.begin() + static_cast<size_t>(text_ptr + params_length + (params_length == 0 ? 0 : 2) - line.data()), expanded_macro.begin(),
-          expanded_macro.end());
+        _storage.pop_back();
+        return false;
       }
 
-      text_ptr = line.data();
-      bool enable_test_macro = true;
-      while (!line.empty() && ((!enable_test_macro || !is_macro(text_ptr, processed)) && text_ptr != &line[line.size() - 1]))
+      std::vector<std::string_view> inputs;
+      split_arguments(arguments.data(), arguments.data() + arguments.size(), inputs);
+      if (info.parameters.empty() && inputs.size() == 1 && inputs[0].empty())
+        inputs.clear();
+
+      const size_t fixed_parameters = info.parameters.size() - (entry.body.variadic ? 1 : 0);
+      if (entry.body.variadic ? inputs.size() < fixed_parameters : inputs.size() != fixed_parameters)
       {
-        if (!cls::is_name_char(text_ptr))
-          enable_test_macro = true;
-        else
-          enable_test_macro = false;
-        ++text_ptr;
+        ++_ctx.processed.error_count;
+        syntax_error_print(_file, _line, strfmt(strings::serr_non_matching_argc, std::string(entry.name).c_str()));
+        return true;
+      }
+
+      // Arguments are fully expanded on their own before being substituted.
+      std::vector<const painted_text*> expanded_inputs;
+      expanded_inputs.reserve(inputs.size());
+      for (const auto& input : inputs)
+      {
+        painted_text& expanded = _arguments.emplace_back();
+        const size_t depth = _chunks.size();
+        _chunks.push_back({ input.data(), input.data() + input.size(), hide_set });
+        rescan(depth, depth, expanded.text, &expanded);
+        expanded_inputs.push_back(&expanded);
       }
 
-      if (line.empty() || text_ptr == &line[line.size() - 1])
-        break;
+      if (entry.body.variadic && inputs.size() > fixed_parameters)
+      {
+        // __VA_ARGS__ keeps the separating commas.
+        painted_text& variadic = _arguments.emplace_back();
+        for (size_t i = fixed_parameters; i < expanded_inputs.size(); ++i)
+        {
+          if (i != fixed_parameters)
+            variadic.append(", ", hide_set);
+          const painted_text& argument = *expanded_inputs[i];
+          for (size_t run = 0; run < argument.runs.size(); ++run)
+          {
+            const size_t begin = argument.runs[run].first;
+            const size_t end = run + 1 < argument.runs.size() ? argument.runs[run + 1].first : argument.text.size();
+            variadic.append(std::string_view(argument.text).substr(begin, end - begin), argument.runs[run].second);
+          }
+        }
+        expanded_inputs.resize(fixed_parameters);
+        expanded_inputs.push_back(&variadic);
+      }
+
+      push_replacement(entry, expanded_inputs, hide_set);
+      return true;
+    }
+
+    /* Pushes the pieces of a macro body onto the chunk stack, so that the first piece is on top.
+    Everything is hidden from the macro itself, argument runs additionally keep their own hide-sets. */
+    void push_replacement(const macro_entry& entry, const std::vector<const painted_text*>& arguments, uint32_t hide_set)
+    {
+      const uint32_t body_hide_set = hide(hide_set, &entry);
+      const auto& pieces = entry.body.pieces;
+      for (auto it = pieces.rbegin(); it != pieces.rend(); ++it)
+      {
+        if (it->type == macro_body::piece_type::literal)
+        {
+          const std::string_view text = std::string_view(entry.info.replacement).substr(it->begin, it->length);
+          if (!text.empty())
+            _chunks.push_back({ text.data(), text.data() + text.size(), body_hide_set });
+          continue;
+        }
+        if (it->begin >= arguments.size())
+          continue;
+
+        const painted_text& argument = *arguments[it->begin];
+        for (size_t run = argument.runs.size(); run-- > 0;)
+        {
+          const char* const begin = argument.text.data() + argument.runs[run].first;
+          const char* const end = run + 1 < argument.runs.size() ? argument.text.data() + argument.runs[run + 1].first : argument.text.data() + argument.text.size();
+          const uint32_t run_hide_set = argument.runs[run].second == hide_set ? body_hide_set : hide(argument.runs[run].second, &entry);
+          _chunks.push_back({ begin, end, run_hide_set });
+        }
+      }
     }
-    if (line.empty())
-      return line;
-    if (line[line.size() - 1] == '\0')
-      line[line.size() - 1] = '\n';
-    return line;
+
+    const files::path& _file;
+    const int _line;
+    context& _ctx;
+    const bool _keep_defined_operands;
+    bool _after_defined = false;
+    std::vector<std::string>* const _reads;
+
+    std::vector<chunk> _chunks;
+    std::vector<hide_set_node> _hide_sets;
+    std::deque<std::string> _storage;
+    std::deque<painted_text> _arguments;
+    std::deque<macro_entry> _builtins;
+  };
+
+  std::string expand(const char* text_ptr, const char* text_end, const char*& text_ptr_after,
+    const files::path& current_file, const int current_line, context& ctx)
+  {
+    std::string expanded;
+    expander e(current_file, current_line, ctx);
+    text_ptr_after = e.expand_invocation({ text_ptr, static_cast<size_t>(text_end - text_ptr) }, expanded) - 1;
+    return expanded;
+  }
+
+  std::string expand_all(std::string_view text, const files::path& current_file, const int current_line, context& ctx)
+  {
+    std::string expanded;
+    expanded.reserve(text.size());
+    expander e(current_file, current_line, ctx);
+    e.expand_all(text, expanded);
+    return expanded;
+  }
+
+  std::string expand_condition(std::string_view text, const files::path& current_file, const int current_line, context& ctx,
+    std::vector<std::string>* reads)
+  {
+    std::string expanded;
+    expanded.reserve(text.size());
+    expander e(current_file, current_line, ctx, true, reads);
+    e.expand_all(text, expanded);
+    return expanded;
   }
-}
\ No newline at end of file
+}
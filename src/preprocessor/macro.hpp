@@ -1,10 +1,22 @@
 #pragma once
 
 #include <glsp/glsp.hpp>
+#include "context.hpp"
 
 namespace glshader::process::impl::macro
 {
-    bool is_defined(const std::string& val, const processed_file& processed);
-    bool is_macro(const char* text_ptr, processed_file& processed);
-    std::string expand(const char* text_ptr, const char* & text_ptr_after, const files::path& current_file, int current_line, processed_file& processed);
+    /* __FILE__, __LINE__ and __VERSION__ are not stored in the macro table, their values are taken from the current
+    position when they are expanded. Macros of the same name in the table take precedence. */
+    bool is_builtin(std::string_view name, const context& ctx);
+    bool is_defined(std::string_view val, const context& ctx);
+    bool is_macro(const char* text_ptr, const char* text_end, context& ctx);
+    /* Expands the macro invocation starting at text_ptr, including everything its replacement pulls in from the following text.
+    text_ptr_after will point to the last consumed character. */
+    std::string expand(const char* text_ptr, const char* text_end, const char* & text_ptr_after, const files::path& current_file, int current_line, context& ctx);
+    /* Expands all macros in the given text. */
+    std::string expand_all(std::string_view text, const files::path& current_file, int current_line, context& ctx);
+    /* Expands all macros in an #if condition, leaving the operands of "defined" untouched.
+    If reads is set, it receives the names of all identifiers looked up in the macro table. */
+    std::string expand_condition(std::string_view text, const files::path& current_file, int current_line, context& ctx,
+        std::vector<std::string>* reads = nullptr);
 }
\ No newline at end of file
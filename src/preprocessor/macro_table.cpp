@@ -0,0 +1,303 @@
+#include "macro_table.hpp"
+#include "lexer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace glshader::process::impl::macro
+{
+    std::string_view string_pool::intern(std::string_view str)
+    {
+        if (str.empty())
+            return {};
+        if (str.size() > block_size / 4)
+        {
+            // Large strings get a block of their own. The rest of the current block is abandoned.
+            char* const data = _blocks.emplace_back(std::make_unique<char[]>(str.size())).get();
+            std::memcpy(data, str.data(), str.size());
+            _block_used = block_size;
+            return { data, str.size() };
+        }
+
+        if (_block_used + str.size() > block_size)
+        {
+            _blocks.emplace_back(std::make_unique<char[]>(block_size));
+            _block_used = 0;
+        }
+        char* const data = _blocks.back().get() + _block_used;
+        std::memcpy(data, str.data(), str.size());
+        _block_used += str.size();
+        return { data, str.size() };
+    }
+
+    macro_body macro_body::compile(const definition_info& info)
+    {
+        macro_body body;
+        body.variadic = !info.parameters.empty() && info.parameters.back() == "...";
+
+        const std::string_view replacement = info.replacement;
+        const auto add_literal = [&](size_t begin, size_t end) {
+            if (begin == end)
+                return;
+            if (!body.pieces.empty() && body.pieces.back().type == piece_type::literal)
+                body.pieces.back().length += static_cast<uint32_t>(end - begin);
+            else
+                body.pieces.push_back({ piece_type::literal, static_cast<uint32_t>(begin), static_cast<uint32_t>(end - begin) });
+            body.literal_size += end - begin;
+        };
+
+        size_t literal_begin = 0;
+        for (size_t i = 0; i < replacement.size();)
+        {
+            if (!lexer::has_class(replacement[i], lexer::char_class::name))
+            {
+                ++i;
+                continue;
+            }
+
+            const size_t name_begin = i;
+            while (i < replacement.size() && lexer::has_class(replacement[i], lexer::char_class::name))
+                ++i;
+
+            // Numbers can never be parameters.
+            if (lexer::has_class(replacement[name_begin], lexer::char_class::digit))
+                continue;
+
+            const std::string_view name = replacement.substr(name_begin, i - name_begin);
+            if (body.variadic && name == "__VA_ARGS__")
+            {
+                add_literal(literal_begin, name_begin);
+                body.pieces.push_back({ piece_type::variadic_arguments, static_cast<uint32_t>(info.parameters.size() - 1), 0 });
+                literal_begin = i;
+                continue;
+            }
+
+            for (size_t parameter = 0; parameter < info.parameters.size(); ++parameter)
+            {
+                if (info.parameters[parameter] == name)
+                {
+                    add_literal(literal_begin, name_begin);
+                    body.pieces.push_back({ piece_type::argument, static_cast<uint32_t>(parameter), 0 });
+                    literal_begin = i;
+                    break;
+                }
+            }
+        }
+        add_literal(literal_begin, replacement.size());
+        return body;
+    }
+
+    table::table()
+    {
+        rehash(64);
+    }
+
+    uint32_t table::hash(std::string_view name) noexcept
+    {
+        // FNV-1a
+        uint32_t h = 2166136261u;
+        for (const char c : name)
+            h = (h ^ static_cast<uint8_t>(c)) * 16777619u;
+        return h;
+    }
+
+    uint64_t table::next_generation() noexcept
+    {
+        static std::atomic<uint64_t> generation{ 0 };
+        return ++generation;
+    }
+
+    namespace
+    {
+        uint64_t fingerprint(const definition_info& info, bool empty_parentheses) noexcept
+        {
+            // FNV-1a over all parameters and the replacement, separated by bytes which cannot be part of them.
+            uint64_t h = 14695981039346656037ull;
+            const auto add = [&](std::string_view str, char separator) {
+                for (const char c : str)
+                    h = (h ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+                h = (h ^ static_cast<uint8_t>(separator)) * 1099511628211ull;
+            };
+            for (const auto& parameter : info.parameters)
+                add(parameter, ',');
+            add(info.replacement, empty_parentheses ? '\1' : '\0');
+            return h | 1;
+        }
+    }
+
+    bool table::may_contain(std::string_view name) const noexcept
+    {
+        if (name.empty())
+            return false;
+        const auto first = static_cast<uint8_t>(name[0]);
+        return (_first_chars[first >> 6] >> (first & 63) & 1) && (_lengths >> std::min<size_t>(name.size(), 63) & 1);
+    }
+
+    size_t table::find_slot(std::string_view name, uint32_t hash) const noexcept
+    {
+        const size_t mask = _slots.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask)
+        {
+            const slot& s = _slots[i];
+            if (s.entry == empty_slot || (s.hash == hash && _entries[s.entry].name == name))
+                return i;
+        }
+    }
+
+    void table::rehash(size_t capacity)
+    {
+        _slots.assign(capacity, slot{ 0, empty_slot });
+        for (uint32_t i = 0; i < static_cast<uint32_t>(_entries.size()); ++i)
+        {
+            const uint32_t h = hash(_entries[i].name);
+            _slots[find_slot(_entries[i].name, h)] = { h, i };
+        }
+    }
+
+    macro_entry* table::find(std::string_view name)
+    {
+        return const_cast<macro_entry*>(static_cast<const table*>(this)->find(name));
+    }
+
+    const macro_entry* table::find(std::string_view name) const
+    {
+        // Numbers are looked up as well while scanning, but can never be defined.
+        const auto miss = [&] {
+            if (_record_misses && _condition_depth > 0 && !name.empty() && !lexer::has_class(name[0], lexer::char_class::digit))
+                _missed.emplace(name);
+            return nullptr;
+        };
+        if (!may_contain(name))
+            return miss();
+        const uint32_t h = hash(name);
+        const slot& s = _slots[find_slot(name, h)];
+        if (s.entry == empty_slot)
+            return miss();
+        const macro_entry& entry = _entries[s.entry];
+        if (_recording && !entry.changed)
+            entry.read = true;
+        return entry.alive ? &entry : nullptr;
+    }
+
+    macro_entry& table::entry(std::string_view name, uint32_t hash)
+    {
+        size_t index = find_slot(name, hash);
+        if (_slots[index].entry == empty_slot)
+        {
+            if ((_entries.size() + 1) * 2 > _slots.size())
+            {
+                rehash(_slots.size() * 2);
+                index = find_slot(name, hash);
+            }
+            _slots[index] = { hash, static_cast<uint32_t>(_entries.size()) };
+            macro_entry& added = _entries.emplace_back();
+            added.name = _names.intern(name);
+
+            if (!name.empty())
+            {
+                const auto first = static_cast<uint8_t>(name[0]);
+                _first_chars[first >> 6] |= uint64_t(1) << (first & 63);
+                _lengths |= uint64_t(1) << std::min<size_t>(name.size(), 63);
+            }
+        }
+        return _entries[_slots[index].entry];
+    }
+
+    macro_entry& table::define(std::string_view name, definition_info info)
+    {
+        bool empty_parentheses = false;
+        if (name.size() > 2 && name.compare(name.size() - 2, 2, "()") == 0)
+        {
+            name.remove_suffix(2);
+            empty_parentheses = true;
+        }
+
+        macro_entry& entry = this->entry(name, hash(name));
+        // Even an equal redefinition hides the value the macro had before.
+        entry.changed = _recording;
+        const uint64_t new_fingerprint = fingerprint(info, empty_parentheses);
+        // The fingerprint only rules out most changes quickly, a redefinition is only skipped if it is exactly equal.
+        if (entry.alive && entry.fingerprint == new_fingerprint && entry.empty_parentheses == empty_parentheses
+            && entry.info.parameters == info.parameters && entry.info.replacement == info.replacement)
+            return entry;
+
+        entry.info = std::move(info);
+        entry.body = macro_body::compile(entry.info);
+        entry.empty_parentheses = empty_parentheses;
+        entry.alive = true;
+        entry.fingerprint = new_fingerprint;
+        _generation = next_generation();
+        return entry;
+    }
+
+    bool table::undefine(std::string_view name)
+    {
+        // Not a lookup: the result does not depend on whether the name was defined before.
+        if (_recording)
+        {
+            // Later lookups do not depend on the definition from before the recording either.
+            macro_entry& entry = this->entry(name, hash(name));
+            entry.changed = true;
+            if (!entry.alive)
+                return false;
+        }
+        const slot& s = _slots[find_slot(name, hash(name))];
+        if (s.entry == empty_slot || !_entries[s.entry].alive)
+            return false;
+        macro_entry& entry = _entries[s.entry];
+        entry.alive = false;
+        entry.info = {};
+        entry.body = {};
+        entry.fingerprint = 0;
+        _generation = next_generation();
+        return true;
+    }
+
+    void table::record_reads(bool misses)
+    {
+        _recording = true;
+        _record_misses = misses;
+    }
+
+    void table::watch(std::string_view name)
+    {
+        if (name.size() > 2 && name.compare(name.size() - 2, 2, "()") == 0)
+            name.remove_suffix(2);
+        entry(name, hash(name));
+    }
+
+    bool table::was_read(std::string_view name) const
+    {
+        if (name.size() > 2 && name.compare(name.size() - 2, 2, "()") == 0)
+            name.remove_suffix(2);
+        const slot& s = _slots[find_slot(name, hash(name))];
+        if (s.entry == empty_slot)
+            return _missed.count(std::string(name)) != 0;
+        return _entries[s.entry].read || _missed.count(std::string(name)) != 0;
+    }
+
+    std::vector<std::string> table::reads() const
+    {
+        std::vector<std::string> names(_missed.begin(), _missed.end());
+        for (const auto& entry : _entries)
+            if (entry.read)
+                names.emplace_back(entry.name);
+        // Entries created after a miss are changed and never read, so no name is listed twice.
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+
+    void table::materialize(std::map<std::string, definition_info>& definitions) const
+    {
+        for (const auto& entry : _entries)
+        {
+            if (!entry.alive)
+                continue;
+            std::string name(entry.name);
+            if (entry.empty_parentheses)
+                name += "()";
+            definitions[std::move(name)] = entry.info;
+        }
+    }
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <glsp/definition.hpp>
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace glshader::process::impl::macro
+{
+    /* Append-only storage for strings which have to stay at a stable address, e.g. macro names used as hash keys. */
+    class string_pool
+    {
+    public:
+        std::string_view intern(std::string_view str);
+
+    private:
+        static constexpr size_t block_size = 4096;
+
+        std::vector<std::unique_ptr<char[]>> _blocks;
+        size_t _block_used = block_size;
+    };
+
+    /* A macro replacement compiled into literal spans and argument slots, so that expanding it is a plain concatenation. */
+    struct macro_body
+    {
+        enum class piece_type : uint8_t
+        {
+            literal = 0,            /* A span of the replacement string. */
+            argument,               /* The argument for the parameter with the given index. */
+            variadic_arguments      /* __VA_ARGS__, all arguments from the given index on including the commas between them. */
+        };
+
+        struct piece
+        {
+            piece_type type;
+            uint32_t begin;         /* Offset into the replacement, or parameter index. */
+            uint32_t length;        /* Literal length in bytes. */
+        };
+
+        std::vector<piece> pieces;
+        size_t literal_size = 0;    /* Sum of all literal lengths. */
+        bool variadic = false;      /* The last parameter is "...". */
+
+        static macro_body compile(const definition_info& info);
+    };
+
+    /* A single macro as stored in a table. */
+    struct macro_entry
+    {
+        std::string_view name;          /* Interned name, without a trailing "()". */
+        definition_info info;
+        macro_body body;
+        bool empty_parentheses = false; /* Defined as NAME() with no parameters, which must then be invoked with parentheses. */
+        bool alive = false;             /* Undefined macros keep their entry, so that a redefinition reuses the interned name. */
+        uint64_t fingerprint = 0;       /* Hash of parameters and replacement, never 0 while alive. Equal definitions have equal fingerprints in all tables. */
+        bool changed = false;           /* Defined or undefined since reads are recorded. */
+        mutable bool read = false;      /* Looked up while recording and before being changed, also while undefined. */
+    };
+
+    /* Preprocessing-time macro table. Names are interned and looked up in an open-addressing hash map without
+    allocating. A prefilter on the first character and the length of a name rejects most non-macro identifiers
+    before hashing them. */
+    class table
+    {
+    public:
+        table();
+
+        /* Returns the macro with the given name or nullptr. The name must not contain a trailing "()". */
+        macro_entry* find(std::string_view name);
+        const macro_entry* find(std::string_view name) const;
+
+        /* Adds or replaces a macro. A name written as NAME() declares a macro with empty parentheses. */
+        macro_entry& define(std::string_view name, definition_info info);
+
+        /* Removes a macro. Returns false if it was not defined. */
+        bool undefine(std::string_view name);
+
+        bool defined(std::string_view name) const { return find(name) != nullptr; }
+
+        /* Starts recording which names are looked up before they are defined or undefined, i.e. which of the macros
+        defined until now have influenced the result, and which names would have if they had been defined.
+        Lookups of names without an entry are only recorded with misses set, and only inside a condition_scope. */
+        void record_reads(bool misses);
+
+        /* Marks lookups as part of an #if, #elif, #ifdef or #ifndef condition while it exists. Ordinary code looks up every
+        identifier, so misses there would list all keywords, types and variables of a shader. */
+        class condition_scope
+        {
+        public:
+            explicit condition_scope(const table& t) : _table(t) { ++_table._condition_depth; }
+            ~condition_scope() { --_table._condition_depth; }
+            condition_scope(const condition_scope&) = delete;
+            condition_scope& operator=(const condition_scope&) = delete;
+
+        private:
+            const table& _table;
+        };
+
+        /* Creates an entry for the name if there is none, so that lookups are recorded even while it is not defined. */
+        void watch(std::string_view name);
+
+        /* Returns true if the name has been looked up while recording. Only known for names which have been defined or
+        watched, or with recorded misses. */
+        bool was_read(std::string_view name) const;
+
+        /* Returns all names recorded as read, sorted and without a trailing "()". */
+        std::vector<std::string> reads() const;
+
+        /* Changes whenever a macro is added, removed or redefined differently. Values are unique across all tables,
+        so two tables with the same generation are copies of each other. */
+        uint64_t generation() const noexcept { return _generation; }
+
+        /* Writes all macros into the user-facing representation, where empty-parentheses macros are named NAME(). */
+        void materialize(std::map<std::string, definition_info>& definitions) const;
+
+    private:
+        static constexpr uint32_t empty_slot = ~uint32_t(0);
+
+        struct slot
+        {
+            uint32_t hash;
+            uint32_t entry;
+        };
+
+        static uint32_t hash(std::string_view name) noexcept;
+        static uint64_t next_generation() noexcept;
+        bool may_contain(std::string_view name) const noexcept;
+        size_t find_slot(std::string_view name, uint32_t hash) const noexcept;
+        macro_entry& entry(std::string_view name, uint32_t hash);
+        void rehash(size_t capacity);
+
+        std::vector<slot> _slots;
+        std::deque<macro_entry> _entries;
+        string_pool _names;
+
+        std::array<uint64_t, 4> _first_chars{};
+        uint64_t _lengths = 0;
+        uint64_t _generation = next_generation();
+
+        bool _recording = false;
+        bool _record_misses = false;
+        mutable int _condition_depth = 0;
+        mutable std::unordered_set<std::string> _missed;
+    };
+}
@@ -0,0 +1,945 @@
+#include "minifier.hpp"
+
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace glshader::process::impl::output
+{
+    namespace {
+        enum class token_kind : uint8_t
+        {
+            identifier,
+            number,
+            symbol,
+            directive   /* A whole preprocessor directive line. */
+        };
+
+        struct token
+        {
+            token_kind kind;
+            std::string text{};
+            uint32_t file = 0;  /* Source position, only set with a source map. */
+            int line = 0;
+        };
+
+        enum char_class : uint8_t
+        {
+            word = 1,
+            space = 2,
+            breaks_code = 4     /* Ends code which is written as it is: whitespace and the start of a directive. */
+        };
+
+        constexpr std::array<uint8_t, 256> make_char_classes()
+        {
+            std::array<uint8_t, 256> classes{};
+            for (int c = 0; c < 256; ++c)
+            {
+                if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_')
+                    classes[c] = word;
+                else if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f')
+                    classes[c] = space | breaks_code;
+                else if (c == '#')
+                    classes[c] = breaks_code;
+            }
+            return classes;
+        }
+        constexpr std::array<uint8_t, 256> char_classes = make_char_classes();
+
+        bool is_word_char(char c)
+        {
+            return char_classes[static_cast<uint8_t>(c)] & word;
+        }
+
+        bool is_space(char c)
+        {
+            return char_classes[static_cast<uint8_t>(c)] & space;
+        }
+
+        bool is_digit(char c)
+        {
+            return c >= '0' && c <= '9';
+        }
+
+        bool is_symbol(const token& t, std::string_view text)
+        {
+            return t.kind == token_kind::symbol && t.text == text;
+        }
+
+        /* Returns true if text followed by c is a prefix of an operator, so both have to be separated when written. */
+        bool continues_operator(std::string_view text, char c)
+        {
+            // ++ -- << >> && || ^^, the assignments += -= *= /= %= &= |= ^= <<= >>= and the comparisons <= >= == !=.
+            constexpr std::string_view before_assignment = "+-*/%<>=!&|^";
+            constexpr std::string_view doubled = "+-<>&|^";
+            if (text.size() == 1)
+                return c == '=' ? before_assignment.find(text[0]) != std::string_view::npos : c == text[0] && doubled.find(c) != std::string_view::npos;
+            return text.size() == 2 && c == '=' && (text == "<<" || text == ">>");
+        }
+
+        bool is_builtin_type(std::string_view name)
+        {
+            static const std::unordered_set<std::string_view> types = {
+                "void", "bool", "int", "uint", "float", "double", "atomic_uint",
+                "vec2", "vec3", "vec4", "bvec2", "bvec3", "bvec4", "ivec2", "ivec3", "ivec4", "uvec2", "uvec3", "uvec4", "dvec2", "dvec3", "dvec4",
+                "mat2", "mat3", "mat4", "mat2x2", "mat2x3", "mat2x4", "mat3x2", "mat3x3", "mat3x4", "mat4x2", "mat4x3", "mat4x4",
+                "dmat2", "dmat3", "dmat4", "dmat2x2", "dmat2x3", "dmat2x4", "dmat3x2", "dmat3x3", "dmat3x4", "dmat4x2", "dmat4x3", "dmat4x4",
+                "sampler", "samplerShadow"
+            };
+            if (types.count(name))
+                return true;
+
+            // Opaque types, e.g. sampler2DShadow, uimageCubeArray or isamplerBuffer, but not functions like imageLoad.
+            if (!name.empty() && (name[0] == 'i' || name[0] == 'u') && name.size() > 1 && name[1] != 'n')
+                name.remove_prefix(1);
+            for (const std::string_view prefix : { "sampler", "image", "texture", "subpassInput" })
+            {
+                if (name.substr(0, prefix.size()) != prefix)
+                    continue;
+                const std::string_view rest = name.substr(prefix.size());
+                return (prefix == "subpassInput" && (rest.empty() || rest == "MS")) || (!rest.empty() && is_digit(rest[0]))
+                    || rest.substr(0, 4) == "Cube" || rest.substr(0, 6) == "Buffer" || rest.substr(0, 8) == "External";
+            }
+            return false;
+        }
+
+        bool is_qualifier(std::string_view name)
+        {
+            static const std::unordered_set<std::string_view> qualifiers = {
+                "const", "in", "out", "inout", "uniform", "buffer", "shared", "attribute", "varying", "patch", "sample", "centroid",
+                "flat", "smooth", "noperspective", "invariant", "precise", "highp", "mediump", "lowp", "coherent", "volatile",
+                "restrict", "readonly", "writeonly", "layout", "subroutine"
+            };
+            return qualifiers.count(name) != 0;
+        }
+
+        /* Qualifiers of global declarations which make the names visible to the application or other stages. */
+        bool is_interface_qualifier(std::string_view name)
+        {
+            static const std::unordered_set<std::string_view> qualifiers = {
+                "in", "out", "uniform", "buffer", "shared", "attribute", "varying", "patch", "layout", "subroutine"
+            };
+            return qualifiers.count(name) != 0;
+        }
+
+        /* Names which cannot be given to renamed identifiers. Only short names matter, as new names are as short as possible. */
+        bool is_reserved(std::string_view name)
+        {
+            static const std::unordered_set<std::string_view> reserved = {
+                "break", "continue", "do", "for", "while", "switch", "case", "default", "if", "else", "discard", "return", "struct",
+                "true", "false", "precision", "asm", "class", "union", "enum", "typedef", "this", "goto", "inline", "static",
+                "extern", "public", "long", "short", "half", "fixed", "input", "output", "cast", "using", "filter", "common",
+                "active", "superp", "hvec2", "hvec3", "hvec4", "fvec2", "fvec3", "fvec4",
+                "abs", "acos", "acosh", "all", "any", "asin", "asinh", "atan", "atanh", "ceil", "clamp", "cos", "cosh", "cross",
+                "dFdx", "dFdy", "dot", "equal", "exp", "exp2", "floor", "fma", "fract", "frexp", "ldexp", "log", "log2", "max",
+                "min", "mix", "mod", "modf", "not", "pow", "round", "sign", "sin", "sinh", "sqrt", "step", "tan", "tanh", "trunc"
+            };
+            return reserved.count(name) || is_qualifier(name) || is_builtin_type(name);
+        }
+
+        /* Returns the index-th name of the form a, b, ..., Z, aa, ab, ... */
+        std::string short_name(size_t index, std::string_view prefix)
+        {
+            constexpr std::string_view first = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+            constexpr std::string_view other = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+            std::string name(prefix);
+            name.push_back(first[index % first.size()]);
+            index /= first.size();
+            while (index > 0)
+            {
+                --index;
+                name.push_back(other[index % other.size()]);
+                index /= other.size();
+            }
+            return name;
+        }
+
+        /* Writes code with the least whitespace needed and records where it comes from. */
+        class writer
+        {
+        public:
+            writer(source_map* map, const std::vector<std::string>& files)
+                : _map(map), _files(files) {}
+
+            void write_directive(std::string_view text, uint32_t file, int line, std::string& output)
+            {
+                if (_last_char != '\0')
+                    new_line(output);
+                record(file, line);
+                output.append(text);
+                new_line(output);
+            }
+
+            /* Writes code without whitespace. If it followed whitespace or other code in the input, a space is written
+            first where both would otherwise merge into one token. ends_with_number tells whether the last token is a number. */
+            void write_code(std::string_view code, bool separated, bool ends_with_number, uint32_t file, int line, std::string& output)
+            {
+                // With a source map, every output line holds code of one source line only. Otherwise logs which only
+                // report a line could not be mapped back.
+                if (_map && line > 0 && _last_char != '\0' && (file != _code_file || line != _code_line))
+                    new_line(output);
+                _code_file = file;
+                _code_line = line;
+
+                if (separated && _last_char != '\0' && needs_space(code.front()))
+                {
+                    output.push_back(' ');
+                    ++_column;
+                }
+                record(file, line);
+                output.append(code);
+                _column += code.size();
+                _last_char = code.back();
+                _last_number = ends_with_number;
+            }
+
+            void write(const token& t, std::string& output)
+            {
+                if (t.kind == token_kind::directive)
+                    write_directive(t.text, t.file, t.line, output);
+                else
+                    write_code(t.text, true, t.kind == token_kind::number, t.file, t.line, output);
+            }
+
+        private:
+            bool needs_space(char next) const
+            {
+                if (is_word_char(_last_char) && is_word_char(next))
+                    return true;
+                if (_last_number && (next == '.' || ((_last_char == 'e' || _last_char == 'E') && (next == '+' || next == '-'))))
+                    return true;
+                return continues_operator(std::string_view(&_last_char, 1), next) || (_last_char == '/' && (next == '/' || next == '*'));
+            }
+
+            void new_line(std::string& output)
+            {
+                output.push_back('\n');
+                ++_line;
+                _column = 0;
+                _last_char = '\0';
+            }
+
+            void record(uint32_t file, int line)
+            {
+                if (!_map || line <= 0)
+                    return;
+                if (_run_line == 0 || file != _run_file || _run_line + (_line - _run_output_line) != line)
+                {
+                    _map->add(_line, static_cast<int>(_column) + 1, _files[file], line);
+                    _run_file = file;
+                    _run_line = line;
+                    _run_output_line = _line;
+                }
+            }
+
+            source_map* _map;
+            const std::vector<std::string>& _files;
+            int _line = 1;
+            size_t _column = 0;
+            char _last_char = '\0';        /* The last character written, or 0 at the start of a line. */
+            bool _last_number = false;
+            uint32_t _run_file = 0;
+            int _run_line = 0;
+            int _run_output_line = 0;
+            uint32_t _code_file = 0;        /* The source position of the last code written. */
+            int _code_line = 0;
+        };
+
+        /* Follows declarations and scopes to give locals, parameters and private globals short names. */
+        class renamer
+        {
+        public:
+            renamer()
+            {
+                _scopes.emplace_back();
+                _contexts.push_back({ role::global, 1 });
+            }
+
+            void rename(token& t)
+            {
+                if (t.kind == token_kind::directive)
+                    return;
+                resolve_pending(t);
+
+                context& ctx = _contexts.back();
+                declaration& d = ctx.decl;
+                const bool after_dot = _after_dot;
+                _after_dot = is_symbol(t, ".");
+
+                switch (t.kind)
+                {
+                case token_kind::identifier:
+                    if (!after_dot)
+                        identifier(t, ctx);
+                    break;
+                case token_kind::number:
+                    if (d.state == phase::statement_start)
+                        d.state = phase::expression;
+                    break;
+                case token_kind::symbol:
+                    symbol(t, ctx);
+                    break;
+                default:
+                    break;
+                }
+            }
+
+        private:
+            enum class role : uint8_t
+            {
+                global,
+                block,
+                parameters,
+                for_header,
+                members,    /* Struct and interface block bodies. */
+                other       /* Parentheses, brackets and initializer lists. */
+            };
+
+            enum class phase : uint8_t
+            {
+                statement_start,
+                qualifiers,
+                struct_name,
+                type,
+                declarator,
+                initializer,
+                expression
+            };
+
+            struct declaration
+            {
+                phase state = phase::statement_start;
+                bool interface = false; /* Interface qualifiers were given. */
+                bool keep = false;      /* Struct declarations and members keep their names. */
+            };
+
+            struct context
+            {
+                role kind;
+                size_t scope_depth;     /* The number of scopes to keep when the context is closed. */
+                declaration decl = {};
+            };
+
+            struct scope
+            {
+                std::unordered_map<std::string, std::string> names;
+                bool single_statement = false;  /* A for scope whose body is a single statement. */
+            };
+
+            void resolve_pending(const token& t)
+            {
+                const bool opens_block = is_symbol(t, "{");
+                if (_pending_for_pops)
+                {
+                    _pending_for_pops = false;
+                    if (!(t.kind == token_kind::identifier && t.text == "else"))
+                    {
+                        while (_scopes.size() > _contexts.back().scope_depth && _scopes.back().single_statement)
+                            _scopes.pop_back();
+                    }
+                }
+                if (_function_pending)
+                {
+                    _function_pending = false;
+                    if (opens_block)
+                        _body_pending = true;
+                    else
+                        _scopes.pop_back();
+                }
+                if (_for_body_pending)
+                {
+                    _for_body_pending = false;
+                    if (opens_block)
+                        _body_pending = true;
+                    else
+                        _scopes.back().single_statement = true;
+                }
+            }
+
+            void identifier(token& t, context& ctx)
+            {
+                declaration& d = ctx.decl;
+                const std::string& name = t.text;
+                if (name == "for")
+                {
+                    _for_pending = true;
+                    d.state = phase::expression;
+                    return;
+                }
+
+                switch (d.state)
+                {
+                case phase::statement_start:
+                case phase::qualifiers:
+                    if (name == "struct")
+                    {
+                        d.keep = true;
+                        d.state = phase::struct_name;
+                        return;
+                    }
+                    if (is_qualifier(name))
+                    {
+                        d.state = phase::qualifiers;
+                        d.interface |= is_interface_qualifier(name);
+                        return;
+                    }
+                    if (is_builtin_type(name) || _struct_names.count(name) || d.state == phase::qualifiers)
+                    {
+                        // After qualifiers, unknown names are block names or types declared elsewhere.
+                        _taken.insert(name);
+                        d.state = phase::type;
+                        return;
+                    }
+                    d.state = phase::expression;
+                    break;
+                case phase::struct_name:
+                    _struct_names.insert(name);
+                    _taken.insert(name);
+                    d.state = phase::type;
+                    return;
+                case phase::type:
+                    declare(t, ctx);
+                    d.state = phase::declarator;
+                    return;
+                case phase::declarator:
+                    d.state = phase::expression;
+                    break;
+                default:
+                    break;
+                }
+
+                for (auto it = _scopes.rbegin(); it != _scopes.rend(); ++it)
+                {
+                    if (const auto found = it->names.find(name); found != it->names.end())
+                    {
+                        t.text = found->second;
+                        return;
+                    }
+                }
+                _taken.insert(name);
+            }
+
+            void declare(token& t, const context& ctx)
+            {
+                const declaration& d = ctx.decl;
+                const bool global = ctx.kind == role::global;
+                if (d.keep || ctx.kind == role::members || (global && d.interface) || t.text == "main" || t.text.compare(0, 3, "gl_") == 0)
+                {
+                    _taken.insert(t.text);
+                    return;
+                }
+
+                auto& names = _scopes.back().names;
+                if (const auto found = names.find(t.text); global && found != names.end())
+                {
+                    // Overloads and definitions of declared functions.
+                    t.text = found->second;
+                    return;
+                }
+
+                std::string name;
+                do
+                    name = global ? short_name(_global_names++, "_") : short_name(_local_names++, "");
+                while (_taken.count(name) || is_reserved(name));
+                names[t.text] = name;
+                t.text = std::move(name);
+            }
+
+            void symbol(const token& t, context& ctx)
+            {
+                declaration& d = ctx.decl;
+                const char c = t.text.size() == 1 ? t.text[0] : '\0';
+                switch (c)
+                {
+                case '(':
+                    if (_for_pending)
+                    {
+                        _for_pending = false;
+                        _scopes.emplace_back();
+                        _contexts.push_back({ role::for_header, _scopes.size() - 1 });
+                    }
+                    else if (d.state == phase::declarator && ctx.kind == role::global)
+                    {
+                        // A function: its parameters and body share one scope, and local names start over.
+                        _local_names = 0;
+                        _scopes.emplace_back();
+                        _contexts.push_back({ role::parameters, _scopes.size() - 1 });
+                    }
+                    else
+                    {
+                        if (d.state == phase::type || d.state == phase::statement_start)
+                            d.state = phase::expression;
+                        _contexts.push_back({ role::other, _scopes.size(), { phase::expression } });
+                    }
+                    return;
+                case '[':
+                    if (d.state == phase::statement_start)
+                        d.state = phase::expression;
+                    _contexts.push_back({ role::other, _scopes.size(), { phase::expression } });
+                    return;
+                case '{':
+                    if (_body_pending)
+                    {
+                        _body_pending = false;
+                        _contexts.push_back({ role::block, _scopes.size() - 1 });
+                    }
+                    else if (d.state == phase::initializer)
+                    {
+                        _contexts.push_back({ role::other, _scopes.size(), { phase::expression } });
+                    }
+                    else if (d.keep || d.interface || d.state == phase::type)
+                    {
+                        _contexts.push_back({ role::members, _scopes.size(), { phase::statement_start, false, true } });
+                    }
+                    else
+                    {
+                        _scopes.emplace_back();
+                        _contexts.push_back({ role::block, _scopes.size() - 1 });
+                    }
+                    return;
+                case ')':
+                case ']':
+                case '}':
+                    close(c);
+                    return;
+                case ';':
+                    if (ctx.kind == role::for_header)
+                    {
+                        d = { phase::expression };
+                        return;
+                    }
+                    end_statement(ctx);
+                    return;
+                case ',':
+                    if (ctx.kind == role::parameters)
+                        d = {};
+                    else if (d.state == phase::declarator || d.state == phase::initializer)
+                        d.state = phase::type;
+                    return;
+                case '=':
+                    if (d.state == phase::declarator)
+                        d.state = phase::initializer;
+                    return;
+                default:
+                    if (d.state == phase::statement_start)
+                        d.state = phase::expression;
+                    return;
+                }
+            }
+
+            void close(char c)
+            {
+                if (_contexts.size() < 2)
+                    return;
+                const context closed = _contexts.back();
+                _contexts.pop_back();
+
+                if (closed.kind == role::parameters)
+                {
+                    _function_pending = true;
+                    return;
+                }
+                if (closed.kind == role::for_header)
+                {
+                    _for_body_pending = true;
+                    return;
+                }
+                if (c == '}' && closed.kind == role::block)
+                {
+                    _scopes.resize(std::max<size_t>(closed.scope_depth, 1));
+                    end_statement(_contexts.back());
+                }
+            }
+
+            void end_statement(context& ctx)
+            {
+                ctx.decl = {};
+                ctx.decl.keep = ctx.kind == role::members;
+                if (_scopes.size() > ctx.scope_depth && _scopes.back().single_statement)
+                    _pending_for_pops = true;
+            }
+
+            std::vector<scope> _scopes;
+            std::vector<context> _contexts;
+            std::unordered_set<std::string> _taken;         /* All names which are not renamed. */
+            std::unordered_set<std::string> _struct_names;
+            size_t _global_names = 0;
+            size_t _local_names = 0;
+            bool _after_dot = false;
+            bool _for_pending = false;          /* "for" was read, the next parenthesis opens its header. */
+            bool _for_body_pending = false;     /* A for header was closed. */
+            bool _function_pending = false;     /* A parameter list was closed, a body or a semicolon follows. */
+            bool _body_pending = false;         /* The next brace opens a body for the current scope. */
+            bool _pending_for_pops = false;     /* A single statement ended, which might have been the body of for loops. */
+        };
+
+        /* Holds back parenthesized tokens until the token after the closing parenthesis shows whether they are needed. */
+        class parentheses
+        {
+        public:
+            explicit parentheses(writer& out) : _writer(out) {}
+
+            void push(token&& t, std::string& output)
+            {
+                if (_closed)
+                    resolve(&t, output);
+
+                if (is_symbol(t, "("))
+                {
+                    _groups.push_back({ last(), std::move(t) });
+                }
+                else if (is_symbol(t, ")") && !_groups.empty())
+                {
+                    _closed = std::move(_groups.back());
+                    _groups.pop_back();
+                    _closed->close = std::move(t);
+                }
+                else
+                {
+                    forward(std::move(t), output);
+                }
+            }
+
+            void finish(std::string& output)
+            {
+                if (_closed)
+                    resolve(nullptr, output);
+                while (!_groups.empty())
+                {
+                    group g = std::move(_groups.back());
+                    _groups.pop_back();
+                    forward(std::move(g.open), output);
+                    for (auto& t : g.inner)
+                        forward(std::move(t), output);
+                }
+            }
+
+        private:
+            struct previous
+            {
+                token_kind kind = token_kind::directive;
+                std::string text;
+            };
+
+            struct group
+            {
+                previous before;
+                token open;
+                std::vector<token> inner{};
+                token close{};
+            };
+
+            previous last() const
+            {
+                if (_groups.empty())
+                    return _last;
+                const group& g = _groups.back();
+                const token& t = g.inner.empty() ? g.open : g.inner.back();
+                return { t.kind, t.text };
+            }
+
+            void forward(token&& t, std::string& output)
+            {
+                if (!_groups.empty())
+                {
+                    _groups.back().inner.push_back(std::move(t));
+                    return;
+                }
+                _writer.write(t, output);
+                _last = { t.kind, std::move(t.text) };
+            }
+
+            void resolve(const token* next, std::string& output)
+            {
+                group g = std::move(*_closed);
+                _closed.reset();
+                const bool redundant = next && is_redundant(g, *next);
+                if (!redundant)
+                    forward(std::move(g.open), output);
+                for (auto& t : g.inner)
+                    forward(std::move(t), output);
+                if (!redundant)
+                    forward(std::move(g.close), output);
+            }
+
+            static bool is_redundant(const group& g, const token& next)
+            {
+                const auto& inner = g.inner;
+                if (inner.empty() || std::any_of(inner.begin(), inner.end(), [](const token& t) { return t.kind == token_kind::directive; }))
+                    return false;
+
+                // Calls, constructors and statement headers like if (...) need their parentheses.
+                const previous& before = g.before;
+                if ((before.kind == token_kind::identifier && before.text != "return") || before.kind == token_kind::number
+                    || (before.kind == token_kind::symbol && (before.text == ")" || before.text == "]")))
+                    return false;
+
+                // A single name, member access or literal binds stronger than any operator.
+                bool primary = inner.size() % 2 == 1 && (inner[0].kind == token_kind::identifier || (inner.size() == 1 && inner[0].kind == token_kind::number));
+                for (size_t i = 1; primary && i < inner.size(); i += 2)
+                    primary = is_symbol(inner[i], ".") && inner[i + 1].kind == token_kind::identifier;
+                if (primary)
+                    return !(inner[0].kind == token_kind::number && is_symbol(next, "."));
+
+                // A whole expression in a place which takes any expression without a top-level comma, like an argument,
+                // an index, the right side of an assignment or a return value.
+                int depth = 0;
+                for (const auto& t : inner)
+                {
+                    if (t.kind != token_kind::symbol)
+                        continue;
+                    if (t.text == "(" || t.text == "[" || t.text == "{")
+                        ++depth;
+                    else if (t.text == ")" || t.text == "]" || t.text == "}")
+                        --depth;
+                    else if (t.text == "," && depth == 0)
+                        return false;
+                }
+                static const std::unordered_set<std::string_view> expression_start = {
+                    "(", "[", ",", "{", "}", ";", "=", "+=", "-=", "*=", "/=", "%=", "<<=", ">>=", "&=", "^=", "|="
+                };
+                static const std::unordered_set<std::string_view> expression_end = { ")", "]", ",", ";", "}" };
+                const bool starts = (before.kind == token_kind::symbol && expression_start.count(before.text)) || before.text == "return";
+                return starts && next.kind == token_kind::symbol && expression_end.count(next.text);
+            }
+
+            writer& _writer;
+            std::vector<group> _groups;
+            std::optional<group> _closed;
+            previous _last;
+        };
+    }
+
+    class minifier::implementation
+    {
+    public:
+        implementation(minify_mode mode, source_map* map)
+            : _map(map), _writer(map, _files), _parentheses(_writer), _glsl(mode == minify_mode::glsl) {}
+
+        void write(const char* data, size_t length, std::string& output)
+        {
+            const char* const end = data + length;
+            while (data != end)
+            {
+                if (_state == state::directive)
+                {
+                    const char* const line_end = std::find(data, end, '\n');
+                    _current.text.append(data, line_end);
+                    data = line_end;
+                    if (data != end)
+                        end_token(output);
+                    continue;
+                }
+
+                const char c = *data;
+                if (is_space(c))
+                {
+                    end_token(output);
+                    _newlines += c == '\n' ? 1 : 0;
+                    _separated = true;
+                    ++data;
+                }
+                else if (c == '#')
+                {
+                    end_token(output);
+                    start_token(token_kind::directive, c);
+                    ++data;
+                }
+                else if (_glsl)
+                {
+                    data = tokenize(data, end, output);
+                }
+                else
+                {
+                    // Without renaming, code between whitespace is written as it is.
+                    const char* code_end = data + 1;
+                    while (code_end != end && !(char_classes[static_cast<uint8_t>(*code_end)] & breaks_code))
+                        ++code_end;
+                    const char* number_start = code_end;
+                    while (number_start != data && (is_word_char(number_start[-1]) || number_start[-1] == '.'))
+                        --number_start;
+                    const bool number = number_start != code_end && (is_digit(*number_start) || *number_start == '.');
+                    const auto [file, line] = position();
+                    _writer.write_code(std::string_view(data, static_cast<size_t>(code_end - data)), _separated, number, file, line, output);
+                    _separated = false;
+                    data = code_end;
+                }
+            }
+        }
+
+        void map_source(std::string_view file, int line)
+        {
+            if (_files.empty() || _files[_anchor.file] != file)
+            {
+                const auto it = std::find(_files.begin(), _files.end(), file);
+                _anchor.file = static_cast<uint32_t>(it - _files.begin());
+                if (it == _files.end())
+                    _files.emplace_back(file);
+            }
+            _anchor.line = line;
+            _anchor.newlines = _newlines;
+        }
+
+        void finish(std::string& output)
+        {
+            end_token(output);
+            if (_glsl)
+                _parentheses.finish(output);
+        }
+
+    private:
+        enum class state : uint8_t
+        {
+            between,
+            identifier,
+            number,
+            symbol,
+            directive
+        };
+
+        struct anchor
+        {
+            uint32_t file = 0;
+            int line = 0;
+            size_t newlines = 0;
+        };
+
+        /* The source file and line of the code written next. */
+        std::pair<uint32_t, int> position() const
+        {
+            if (!_map || _files.empty())
+                return { 0, 0 };
+            return { _anchor.file, _anchor.line + static_cast<int>(_newlines - _anchor.newlines) };
+        }
+
+        /* Reads the next characters of a token, or starts a new one. Returns where reading stopped. */
+        const char* tokenize(const char* data, const char* end, std::string& output)
+        {
+            const char c = *data;
+            switch (_state)
+            {
+            case state::identifier:
+            case state::number:
+                if (is_word_char(c) || (_state == state::number && (c == '.'
+                    || ((c == '+' || c == '-') && !_hex && (_current.text.back() == 'e' || _current.text.back() == 'E')))))
+                {
+                    _hex |= _state == state::number && _current.text == "0" && (c == 'x' || c == 'X');
+                    _current.text.push_back(c);
+                    return data + 1;
+                }
+                break;
+            case state::symbol:
+                if (_current.text == "." && is_digit(c))
+                {
+                    _state = state::number;
+                    _current.kind = token_kind::number;
+                    _current.text.push_back(c);
+                    return data + 1;
+                }
+                if (continues_operator(_current.text, c))
+                {
+                    _current.text.push_back(c);
+                    return data + 1;
+                }
+                break;
+            default:
+                break;
+            }
+
+            end_token(output);
+            if (is_digit(c))
+                start_token(token_kind::number, c);
+            else if (is_word_char(c))
+                start_token(token_kind::identifier, c);
+            else
+                start_token(token_kind::symbol, c);
+
+            // Names are read at once.
+            if (_state == state::identifier)
+            {
+                const char* const name_end = std::find_if_not(data + 1, end, is_word_char);
+                _current.text.append(data + 1, name_end);
+                return name_end;
+            }
+            return data + 1;
+        }
+
+        void start_token(token_kind kind, char c)
+        {
+            _current.kind = kind;
+            _current.text.assign(1, c);
+            std::tie(_current.file, _current.line) = position();
+            _hex = false;
+            switch (kind)
+            {
+            case token_kind::identifier: _state = state::identifier; break;
+            case token_kind::number: _state = state::number; break;
+            case token_kind::symbol: _state = state::symbol; break;
+            case token_kind::directive: _state = state::directive; break;
+            }
+        }
+
+        void end_token(std::string& output)
+        {
+            if (_state == state::between)
+                return;
+            if (_state == state::directive)
+            {
+                while (!_current.text.empty() && (_current.text.back() == ' ' || _current.text.back() == '\t' || _current.text.back() == '\r'))
+                    _current.text.pop_back();
+            }
+            _state = state::between;
+            _separated = false;
+
+            if (_glsl)
+            {
+                _renamer.rename(_current);
+                _parentheses.push(std::move(_current), output);
+                _current = {};
+            }
+            else
+            {
+                _writer.write(_current, output);
+            }
+        }
+
+        source_map* _map;
+        std::vector<std::string> _files;
+        writer _writer;
+        renamer _renamer;
+        parentheses _parentheses;
+        bool _glsl;
+
+        state _state = state::between;
+        token _current{ token_kind::symbol };
+        bool _hex = false;
+        bool _separated = false;    /* Whitespace was read since the last code. */
+        size_t _newlines = 0;
+        anchor _anchor;
+    };
+
+    minifier::minifier(minify_mode mode, source_map* map)
+        : _implementation(std::make_unique<implementation>(mode, map))
+    {
+    }
+
+    minifier::~minifier() = default;
+
+    void minifier::write(const char* data, size_t length, std::string& output)
+    {
+        _implementation->write(data, length, output);
+    }
+
+    void minifier::map_source(std::string_view file, int line)
+    {
+        _implementation->map_source(file, line);
+    }
+
+    void minifier::finish(std::string& output)
+    {
+        _implementation->finish(output);
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <glsp/source_map.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace glshader::process::impl::output
+{
+    enum class minify_mode
+    {
+        none,
+        whitespace,     /* Only write the whitespace needed to separate tokens. */
+        glsl            /* Also remove redundant parentheses and give local variables and private globals short names. */
+    };
+
+    /* Minifies code while it is written. The code is split into tokens, which are written with as little whitespace as
+    possible. Preprocessor directives are kept on their own lines.
+    In glsl mode, declarations are followed through scopes. Locals, parameters, functions and globals without interface
+    qualifiers are renamed; main, gl_ names, struct members and everything with in, out, uniform, buffer, shared, layout or
+    subroutine qualifiers keep their names. Names are only taken from identifiers not seen before, so identifiers declared
+    outside of the processed code, e.g. in a prefix, could be shadowed. */
+    class minifier
+    {
+    public:
+        minifier(minify_mode mode, source_map* map);
+        ~minifier();
+
+        /* Minifies the given code and appends the result to output. */
+        void write(const char* data, size_t length, std::string& output);
+
+        /* Code written from now on comes from the given file and line. Only needed with a source map. */
+        void map_source(std::string_view file, int line);
+
+        /* Writes everything held back, e.g. parentheses which might have been redundant. */
+        void finish(std::string& output);
+
+    private:
+        class implementation;
+        std::unique_ptr<implementation> _implementation;
+    };
+}
@@ -0,0 +1,99 @@
+#include "output_buffer.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+
+namespace glshader::process::impl::output
+{
+    /* Pending code is handed to an attached sink as soon as it reaches this size. */
+    constexpr size_t sink_chunk_size = 64 * 1024;
+
+    buffer::buffer(output_sink* sink, size_t expected_size, minify_mode minify, source_map* map)
+        : _sink(sink), _map(map), _minifier(minify != minify_mode::none ? std::make_unique<minifier>(minify, map) : nullptr)
+    {
+        _data.reserve(sink ? sink_chunk_size : expected_size);
+    }
+
+    void buffer::reserve_for(size_t length)
+    {
+        if (_data.size() + length > _data.capacity())
+            _data.reserve(std::max(_data.capacity() * 2, _data.size() + length));
+    }
+
+    void buffer::write(const char* data, size_t length)
+    {
+        if (length == 0)
+            return;
+        if (const auto newlines = static_cast<size_t>(std::count(data, data + length, '\n')); newlines != 0)
+        {
+            _newlines += newlines;
+            _column = static_cast<size_t>(std::find(std::make_reverse_iterator(data + length), std::make_reverse_iterator(data), '\n') - std::make_reverse_iterator(data + length));
+        }
+        else
+        {
+            _column += length;
+        }
+        if (_minifier)
+        {
+            _minifier->write(data, length, _data);
+        }
+        else
+        {
+            reserve_for(length);
+            _data.append(data, length);
+        }
+        if (_sink && _data.size() >= sink_chunk_size)
+            flush();
+    }
+
+    void buffer::put(char c)
+    {
+        _newlines += c == '\n' ? 1 : 0;
+        _column = c == '\n' ? 0 : _column + 1;
+        if (_minifier)
+        {
+            _minifier->write(&c, 1, _data);
+        }
+        else
+        {
+            reserve_for(1);
+            _data.push_back(c);
+        }
+        if (_sink && _data.size() >= sink_chunk_size)
+            flush();
+    }
+
+    buffer& buffer::operator<<(int value)
+    {
+        char digits[16];
+        const int length = std::snprintf(digits, sizeof(digits), "%d", value);
+        write(digits, static_cast<size_t>(length));
+        return *this;
+    }
+
+    void buffer::map_source(std::string_view file, int line)
+    {
+        if (_minifier)
+            _minifier->map_source(file, line);
+        else if (_map)
+            _map->add(static_cast<int>(_newlines) + 1, static_cast<int>(_column) + 1, file, line);
+    }
+
+    void buffer::flush()
+    {
+        if (_sink && !_data.empty())
+        {
+            _sink->write(_data.data(), _data.size());
+            _data.clear();
+        }
+    }
+
+    std::string buffer::take()
+    {
+        if (_minifier)
+            _minifier->finish(_data);
+        flush();
+        return std::move(_data);
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glsp/output.hpp>
+#include "minifier.hpp"
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace glshader::process::impl::output
+{
+    /* Contiguous output buffer for processed code. Appends are amortized, the buffer grows geometrically.
+    If a sink is attached, the buffer is handed to it in chunks and only holds the code not yet written.
+    When minifying, code is minified on its way into the buffer. Newlines and columns are still counted for the code as
+    it was written, so line tracking works the same in all modes. */
+    class buffer
+    {
+    public:
+        explicit buffer(output_sink* sink = nullptr, size_t expected_size = 0, minify_mode minify = minify_mode::none, source_map* map = nullptr);
+
+        void write(const char* data, size_t length);
+        void write(const char* begin, const char* end) { write(begin, static_cast<size_t>(end - begin)); }
+        void put(char c);
+
+        buffer& operator<<(std::string_view str) { write(str.data(), str.size()); return *this; }
+        buffer& operator<<(char c) { put(c); return *this; }
+        buffer& operator<<(int value);
+
+        /* The number of newlines written so far, including the ones already handed to the sink. */
+        size_t newlines() const noexcept { return _newlines; }
+        /* Returns true if nothing or a newline was written last. */
+        bool at_line_start() const noexcept { return _column == 0; }
+        /* The number of characters written since the last newline. */
+        size_t column() const noexcept { return _column; }
+
+        /* Records in the source map that code written from now on comes from the given file and line. */
+        void map_source(std::string_view file, int line);
+
+        /* Writes all pending code into the sink. Does nothing without a sink. */
+        void flush();
+
+        /* Flushes and moves out the buffered code. The result is empty if a sink is attached. Must be called once at the end. */
+        std::string take();
+
+    private:
+        void reserve_for(size_t length);
+
+        std::string _data;
+        output_sink* _sink;
+        source_map* _map;
+        std::unique_ptr<minifier> _minifier;
+        size_t _newlines = 0;
+        size_t _column = 0;
+    };
+}
@@ -1,14 +1,21 @@
 #include <glsp/preprocess.hpp>
 #include <glsp/config.hpp>
+#include <glsp/cache.hpp>
 
 /* Impl */
 #include "../strings.hpp"
-#include "eval.hpp"
 #include "control.hpp"
 #include "classify.hpp"
+#include "lexer.hpp"
 #include "skip.hpp"
 #include "macro.hpp"
 #include "extensions.hpp"
+#include "output_buffer.hpp"
+#include "context.hpp"
+#include "conditions.hpp"
+#include "dead_code.hpp"
+#include "input.hpp"
+#include "preprocessor.hpp"
 #include "../opengl/loader.hpp"
 
 #include <fstream>
@@ -22,178 +29,157 @@
 namespace glshader::process
 {
     namespace cls = impl::classify;
+    namespace lexer = impl::lexer;
     namespace ctrl = impl::control;
     namespace skip = impl::skip;
     namespace macro = impl::macro;
     namespace ext = impl::ext;
     namespace lgl = impl::loader;
+    namespace output = impl::output;
 
     std::function<void(const std::string &)> ERR_OUTPUT = [](const std::string& x){ std::cerr << "[glsp error] " << (x) << std::endl; };
 
-    inline std::string minify(std::string const& original) {
-      std::string minified;
-      //preallocate a bit more than needed.
-      minified.reserve(original.size());
-
-      enum class state {
-        normal,
-        space,
-        preprocessor
-      } current_state = state::normal;
-
-      bool alphanumeric = false;
-
-      for (char c : original) {
-        switch (current_state) {
-        case state::space:
-          if (!(cls::is_space(&c) || cls::is_newline(&c)) && !(c == '\n' || c == '\r'))
-          {
-            current_state = state::normal;
-
-            if (alphanumeric && !cls::is_operator(&c))
-              minified.push_back(' ');
-          }
-        case state::normal:
-          if (cls::is_space(&c) || cls::is_newline(&c))
-            current_state = state::space;
-          else if (c == '#') {
-            if (!minified.empty() && !cls::is_newline(&minified.back()))
-              minified.push_back('\n');
-            current_state = state::preprocessor;
-            minified.push_back(c);
-          }
-          else {
-            alphanumeric = !cls::is_operator(&c);
-            minified.push_back(c);
-          }
-          break;
-
-        case state::preprocessor:
-          if (c == '\n' || c == '\r')
-            current_state = state::space;
-          minified.push_back(c);
-          break;
-        }
-      }
-      minified.shrink_to_fit();
-      return minified;
-    }
-
-    void process_impl(const files::path& file_path, const std::string& contents, const std::vector<files::path>& include_directories,
-        processed_file& processed, std::set<files::path>& unique_includes,
-        std::stringstream& result, bool expand_in_macros)
+    void process_impl(const files::path& file_path, std::string_view contents, const std::vector<files::path>& include_directories,
+        impl::context& ctx, std::set<files::path>& unique_includes,
+        output::buffer& result, bool expand_in_macros)
     {
+        processed_file& processed = ctx.processed;
         int defines_nesting = 0;
         std::stack<bool> accept_else_directive;
 
         const char* text_ptr = contents.data();
+        const char* const contents_end = contents.data() + contents.size();
+        const auto conditions = ctx.conditions->file(file_path);
         files::path current_file = file_path;
-        processed.definitions["__FILE__"] = current_file.string();
+        uint32_t current_file_id = ++ctx.file_ids;
         int current_line = 1;
         std::string curr = current_file.filename().string();
         std::replace(curr.begin(), curr.end(), '\\', '/');
 
+        // The position where the root file ends is what __FILE__ and __LINE__ are listed with in the definitions.
+        struct end_position
+        {
+            impl::context& ctx;
+            const files::path& file;
+            const int& line;
+            ~end_position() { ctx.end_file = file; ctx.end_line = line; }
+        } end{ ctx, current_file, current_line };
+
         // There is no way you could put a macro starting from the first character of the shader.
         // Set to true if the current text_ptr may point to the start of a macro name.
         bool enable_macro = false;
 
-        while (!cls::is_eof(text_ptr))
+        while (text_ptr < contents_end)
         {
-            text_ptr = skip::over_comments(text_ptr, current_file, current_line, processed, result);
-            if (cls::is_eof(text_ptr))
+            text_ptr = skip::over_comments(text_ptr, contents_end, current_line);
+            if (text_ptr >= contents_end)
                 break;
 
             if (cls::is_newline(text_ptr))
             {
-                ctrl::increment_line(current_line, processed);
+                ++current_line;
                 result << '\n';
                 ++text_ptr;
                 enable_macro = true;
             }
-            else if (enable_macro && macro::is_macro(text_ptr, processed))
+            else if (enable_macro && macro::is_macro(text_ptr, contents_end, ctx))
             {
+              const auto invocation_begin = text_ptr;
+              const auto invocation_line = current_line;
+              std::string expanded = macro::expand(text_ptr, contents_end, text_ptr, current_file, current_line, ctx);
+
+              // Macro arguments may span multiple lines.
+              for (auto c = invocation_begin; c <= text_ptr; ++c)
+                if (*c == '\n')
+                  ++current_line;
+
               if (expand_in_macros) {
                 std::stringstream tempstream;
+                tempstream << "\n#line " << invocation_line << '\n';
+                tempstream << expanded;
                 tempstream << '\n';
-                tempstream << ctrl::line_directive(current_file, current_line, processed);
-                tempstream << macro::expand(text_ptr, text_ptr, current_file, current_line, processed);
-                tempstream << ctrl::line_directive(current_file, current_line + 1, processed);
-                tempstream << '\n';
-                process_impl(file_path, tempstream.str(), include_directories, processed, unique_includes, result, expand_in_macros);
+                process_impl(file_path, tempstream.str(), include_directories, ctx, unique_includes, result, expand_in_macros);
               }
               else
               {
-                result << ctrl::line_directive(current_file, current_line, processed);
-                result << macro::expand(text_ptr, text_ptr, current_file, current_line, processed);
-                result << ctrl::line_directive(current_file, current_line + 1, processed);
+                ctrl::sync_line(current_file, current_file_id, invocation_line, ctx, result);
+                result << expanded;
               }
               ++text_ptr;
             }
             else if (cls::is_directive(text_ptr, current_line != 1))
             {
-                const auto directive_name = skip::space(text_ptr + 1);
-                if (cls::is_token_equal(directive_name, "version", 7))
+                const auto directive_name = skip::space(text_ptr + 1, contents_end);
+                if (cls::is_token_equal(directive_name, "version", 7) && contents_end - skip::to_next_token(directive_name, contents_end) < 3)
+                {
+                    // Not even room for a version number.
+                    ++processed.error_count;
+                    syntax_error_print(current_file, current_line, strings::serr_invalid_version);
+                    text_ptr = contents_end;
+                }
+                else if (cls::is_token_equal(directive_name, "version", 7))
                 {
-                    text_ptr = skip::to_next_token(directive_name);
+                    text_ptr = skip::to_next_token(directive_name, contents_end);
                     processed.version = (*text_ptr - '0') * 100 +
                         (*(text_ptr + 1) - '0') * 10 +
                         (*(text_ptr + 2) - '0');
 
-                    processed.definitions["__VERSION__"] = std::string{ text_ptr, text_ptr + 3 };
+                    ctx.version.assign(text_ptr, text_ptr + 3);
 
                     result << "#version " << *text_ptr << *(text_ptr + 1) << *(text_ptr + 2) << " ";
-                    text_ptr = skip::to_next_token(text_ptr);
+                    text_ptr = skip::to_next_token(text_ptr, contents_end);
 
                     if (cls::is_newline(text_ptr))
                     {
-                        processed.definitions["GL_core_profile"] = 1;
+                        ctx.definitions.define("GL_core_profile", 1);
                         processed.profile = shader_profile::core;
                     }
                     else if (cls::is_token_equal(text_ptr, "core", 4))
                     {
-                        processed.definitions["GL_core_profile"] = 1;
+                        ctx.definitions.define("GL_core_profile", 1);
                         processed.profile = shader_profile::core;
                     }
                     else if (cls::is_token_equal(text_ptr, "compatibility", 13))
                     {
-                        processed.definitions["GL_compatibility_profile"] = 1;
+                        ctx.definitions.define("GL_compatibility_profile", 1);
                         processed.profile = shader_profile::compatibility;
                     }
                     else
                     {
                         ++processed.error_count;
-                        syntax_error_print(current_file, current_line, strfmt(strings::serr_unrecognized_profile, std::string(text_ptr, skip::to_endline(text_ptr)).c_str()));
-                        processed.definitions["GL_core_profile"] = 1;
+                        syntax_error_print(current_file, current_line, strfmt(strings::serr_unrecognized_profile, std::string(text_ptr, skip::to_endline(text_ptr, contents_end)).c_str()));
+                        ctx.definitions.define("GL_core_profile", 1);
                         processed.profile = shader_profile::core;
                     }
 
-                    while (!cls::is_newline(text_ptr))
-                        result << *text_ptr++;
-
-                    result << ctrl::line_directive(current_file, current_line, processed);
+                    const auto line_end = skip::to_endline(text_ptr, contents_end);
+                    result.write(text_ptr, line_end);
+                    text_ptr = line_end;
                 }
                 else if (cls::is_token_equal(directive_name, "extension", 9))
                 {
-                    text_ptr = skip::to_next_token(directive_name);
+                    text_ptr = skip::to_next_token(directive_name, contents_end);
+                    ctrl::sync_line(current_file, current_file_id, current_line, ctx, result);
                     result << "#extension ";
 
-                    const auto name_end = skip::to_next_space(text_ptr, ':');
+                    const auto name_end = skip::to_next_space(text_ptr, contents_end, ':');
                     const std::string extension(text_ptr, name_end);
 
                     result << extension << " : ";
 
-                    text_ptr = skip::space((*(text_ptr - 1) == ':') ? text_ptr : skip::space(name_end) + 1);
+                    const auto colon = skip::space(name_end, contents_end);
+                    text_ptr = skip::space(colon < contents_end && *colon == ':' ? colon + 1 : colon, contents_end);
 
                     if (extension == "all")
                     {
-                        if (cls::is_token_equal(text_ptr, "warn", 6))
+                        if (cls::is_token_equal(text_ptr, "warn", 4))
                             processed.extensions[extension] = ext_behavior::warn;
-                        else if (cls::is_token_equal(text_ptr, "disable", 6))
+                        else if (cls::is_token_equal(text_ptr, "disable", 7))
                             processed.extensions[extension] = ext_behavior::disable;
                         else
                         {
                             ++processed.error_count;
-                            syntax_error_print(current_file, current_line, strfmt(strings::serr_extension_all_behavior, std::string(text_ptr, skip::to_endline(text_ptr)).c_str()));
+                            syntax_error_print(current_file, current_line, strfmt(strings::serr_extension_all_behavior, std::string(text_ptr, skip::to_endline(text_ptr, contents_end)).c_str()));
                         }
                     }
                     else
@@ -202,102 +188,105 @@ namespace glshader::process
                             processed.extensions[extension] = ext_behavior::require;
                         else if (cls::is_token_equal(text_ptr, "enable", 6))
                             processed.extensions[extension] = ext_behavior::enable;
-                        else if (cls::is_token_equal(text_ptr, "warn", 6))
+                        else if (cls::is_token_equal(text_ptr, "warn", 4))
                             processed.extensions[extension] = ext_behavior::warn;
-                        else if (cls::is_token_equal(text_ptr, "disable", 6))
+                        else if (cls::is_token_equal(text_ptr, "disable", 7))
                             processed.extensions[extension] = ext_behavior::disable;
                         else
                         {
                             ++processed.error_count;
-                            syntax_error_print(current_file, current_line, strfmt(strings::serr_extension_behavior, std::string(text_ptr, skip::to_endline(text_ptr)).c_str()));
+                            syntax_error_print(current_file, current_line, strfmt(strings::serr_extension_behavior, std::string(text_ptr, skip::to_endline(text_ptr, contents_end)).c_str()));
                         }
                     }
-                    while (!cls::is_newline(text_ptr))
-                        result << *text_ptr++;
+                    const auto line_end = skip::to_endline(text_ptr, contents_end);
+                    result.write(text_ptr, line_end);
+                    text_ptr = line_end;
                 }
                 else if (cls::is_token_equal(directive_name, "pragma", 6))
                 {
-                    text_ptr = skip::to_next_token(directive_name);
+                    text_ptr = skip::to_next_token(directive_name, contents_end);
 
                     if (cls::is_token_equal(text_ptr, "once", 4))
                     {
                         unique_includes.emplace(current_file);
-                        text_ptr = skip::to_endline(text_ptr);
+                        text_ptr = skip::to_endline(text_ptr, contents_end);
                     }
                     else
                     {
+                        ctrl::sync_line(current_file, current_file_id, current_line, ctx, result);
                         result << "#pragma ";
                     }
                     // It is possible to add custom pragmas
                 }
                 else if (cls::is_token_equal(directive_name, "define", 6))
                 {
-                    text_ptr = skip::to_next_token(directive_name);
+                    text_ptr = skip::to_next_token(directive_name, contents_end);
                     const auto name_begin = text_ptr;
-                    while (!cls::is_space(text_ptr) && !cls::is_newline(text_ptr) && (*text_ptr != '(' || (*text_ptr == '(' && *skip::space(text_ptr+1)==')')))
+                    while (text_ptr < contents_end && !cls::is_space(text_ptr) && !cls::is_newline(text_ptr) && (*text_ptr != '(' || (*text_ptr == '(' && *skip::space(text_ptr+1, contents_end)==')')))
                         ++text_ptr;
 
-                    if (const auto space_skipped = skip::space(text_ptr);
-                    cls::is_space(text_ptr) && !cls::is_newline(space_skipped) && !cls::is_comment(space_skipped))
+                    if (const auto space_skipped = skip::space(text_ptr, contents_end);
+                    cls::is_space(text_ptr) && space_skipped < contents_end && !cls::is_newline(space_skipped) && !cls::is_comment(space_skipped))
                     {
                         // macro without params
                         auto value_end = space_skipped;
                         std::stringstream val;
-                        while (!cls::is_newline(value_end) && !cls::is_eof(value_end) && !cls::is_comment(value_end))
+                        while (value_end < contents_end && !cls::is_newline(value_end) && !cls::is_comment(value_end))
                         {
                             if (*value_end != '\\')
                                 val << *value_end;
                             else
                             {
-                                value_end = skip::to_endline(value_end) + 1;
-                                ctrl::increment_line(current_line, processed);
+                                value_end = skip::to_endline(value_end, contents_end);
+                                if (value_end == contents_end)
+                                    break;
+                                ++value_end;
+                                ++current_line;
                             }
                             ++value_end;
                         }
 
-                        processed.definitions[{name_begin, text_ptr}] = val.str();
+                        ctx.definitions.define({ name_begin, static_cast<size_t>(text_ptr - name_begin) }, val.str());
 
                         text_ptr = value_end;
                     }
-                    else if (cls::is_newline(text_ptr) || cls::is_newline(space_skipped) || cls::is_comment(space_skipped))
+                    else if (space_skipped == contents_end || cls::is_newline(text_ptr) || cls::is_newline(space_skipped) || cls::is_comment(space_skipped))
                     {
                         // define without value
-                        processed.definitions[{name_begin, text_ptr}];
+                        ctx.definitions.define({ name_begin, static_cast<size_t>(text_ptr - name_begin) }, {});
                     }
                     else if (*space_skipped == '(')
                     {
                         // macro with params
                         const auto name_end = text_ptr;
                         const auto params_begin = space_skipped + 1;
-                        while (*text_ptr != ')')
+                        while (text_ptr < contents_end && *text_ptr != ')')
                             ++text_ptr;
                         const auto params_end = text_ptr;
 
                         // macro without params
-                        auto value_end = skip::space(params_end + 1);
+                        auto value_end = skip::space(params_end < contents_end ? params_end + 1 : params_end, contents_end);
                         std::stringstream definition_stream;
-                        while (!(cls::is_newline(value_end) && *(value_end - 1) != '\\'))
+                        while (value_end < contents_end && !(cls::is_newline(value_end) && *(value_end - 1) != '\\'))
                         {
                             if (*value_end != '\\')
                                 definition_stream << *value_end;
                             else
                             {
-                                ctrl::increment_line(current_line, processed);
+                                ++current_line;
                             }
-                            if (cls::is_eof(value_end))
-                                break;
                             ++value_end;
                         }
-                        --current_line;
 
                         std::string parameter;
                         std::vector<std::string> parameters;
-                        std::stringstream param_stream({ skip::space(params_begin), params_end });
+                        std::stringstream param_stream({ skip::space(params_begin, params_end), params_end });
 
                         while (std::getline(param_stream, parameter, ','))
                         {
-                            const auto param_begin = skip::space(parameter.data());
-                            parameters.push_back({ param_begin, skip::to_next_space(param_begin) });
+                            const auto parameter_end = parameter.data() + parameter.size();
+                            const auto param_begin = skip::space(parameter.data(), parameter_end);
+                            parameters.push_back({ param_begin, skip::to_next_space(param_begin, parameter_end) });
                         }
 
                         while (param_stream >> parameter)
@@ -308,30 +297,28 @@ namespace glshader::process
                                 param_stream.ignore();
                         }
 
-                        processed.definitions[{name_begin, name_end}] ={ std::move(parameters), definition_stream.str() };
+                        ctx.definitions.define({ name_begin, static_cast<size_t>(name_end - name_begin) }, { std::move(parameters), definition_stream.str() });
 
                         text_ptr = value_end;
                     }
-
-                    result << ctrl::line_directive(current_file, current_line, processed);
                 }
                 else if (cls::is_token_equal(directive_name, "undef", 5))
                 {
-                    text_ptr = skip::to_next_token(directive_name);
+                    text_ptr = skip::to_next_token(directive_name, contents_end);
                     const auto begin = text_ptr;
-                    while (!cls::is_eof(text_ptr) && !cls::is_space(text_ptr) && !cls::is_newline(text_ptr))
+                    while (text_ptr < contents_end && !cls::is_space(text_ptr) && !cls::is_newline(text_ptr))
                         ++text_ptr;
 
-                    processed.definitions.erase({ begin, text_ptr });
+                    ctx.definitions.undefine({ begin, static_cast<size_t>(text_ptr - begin) });
                 }
                 else if (const auto elif = cls::is_token_equal(directive_name, "elif", 4); cls::is_token_equal(directive_name, "if", 2, true, false) || (elif))
                 {
                     const int ifline = current_line;
                     ++defines_nesting;
-                    text_ptr = skip::to_next_token(directive_name);
+                    text_ptr = skip::to_next_token(directive_name, contents_end);
                     const auto value_begin = text_ptr;
                     bool enable_nl = true;
-                    while (!enable_nl || !(cls::is_newline(text_ptr) || cls::is_eof(text_ptr)))
+                    while (text_ptr < contents_end && (!enable_nl || !cls::is_newline(text_ptr)))
                     {
                         enable_nl = true;
                         if (*text_ptr == '\\')
@@ -339,53 +326,42 @@ namespace glshader::process
                         ++text_ptr;
                     }
 
+                    const macro::table::condition_scope condition_reads(ctx.definitions);
                     bool evaluated;
                     if (cls::is_token_equal(directive_name, "ifdef", 5))
-                        evaluated =  macro::is_defined({ value_begin, text_ptr }, processed);
+                        evaluated =  macro::is_defined({ value_begin, static_cast<size_t>(lexer::scan_name(value_begin, contents_end) - value_begin) }, ctx);
                     else if (cls::is_token_equal(directive_name, "ifndef", 6))
-                        evaluated = !macro::is_defined({ value_begin, text_ptr }, processed);
+                        evaluated = !macro::is_defined({ value_begin, static_cast<size_t>(lexer::scan_name(value_begin, contents_end) - value_begin) }, ctx);
                     else if (elif && !accept_else_directive.top())
                         evaluated = false;
                     else
                     {
                         // Simple IF
-                        std::stringstream line;
-                        for (auto i = value_begin; i != text_ptr; ++i)
+                        std::string condition;
+                        condition.reserve(static_cast<size_t>(text_ptr - value_begin));
+                        for (auto i = value_begin; i < text_ptr; ++i)
                         {
                             if (memcmp(i, "//", 2) == 0)
-                            {
                                 break;
-                            }
                             if (memcmp(i, "/*", 2) == 0)
                             {
-                                while (memcmp(i, "*/", 2) != 0)
+                                i += 2;
+                                while (i < text_ptr && memcmp(i, "*/", 2) != 0)
                                     ++i;
                                 ++i;
-                            }
-                            else if (cls::is_token_equal(i, "defined", 7))
-                            {
-                                while (*i != '(')
-                                    ++i;
-                                const auto defined_macro_begin = i;
-                                while (*i != ')')
-                                    ++i;
-
-                                line << (macro::is_defined(std::string(defined_macro_begin + 1, i), processed) ? '1' : '0');
+                                condition.push_back(' ');
                             }
                             else
-                                line << *i;
+                                condition.push_back(*i);
                         }
 
-                        auto line_str = line.str();
-                        const char* none;
-                        auto str = macro::expand(line_str.c_str(), none, current_file, current_line, processed);
-
-                        evaluated = impl::operation::eval(str.data(), static_cast<int>(str.length()), current_file, current_line, processed);
+                        const auto offset = static_cast<size_t>(value_begin - contents.data());
+                        evaluated = conditions->evaluate(offset, condition, current_file, current_line, ctx) != 0;
                     }
 
                     if (evaluated)
                     {
-                        text_ptr = skip::to_endline(text_ptr);
+                        text_ptr = skip::to_endline(text_ptr, contents_end);
                         if (elif)
                             accept_else_directive.top() = false;
                         else
@@ -397,42 +373,50 @@ namespace glshader::process
                             accept_else_directive.push(true);
                         for (;; ++text_ptr)
                         {
-                            text_ptr = skip::over_comments(text_ptr, current_file, current_line, processed, result);
+                            text_ptr = skip::over_comments(text_ptr, contents_end, current_line);
+                            if (text_ptr >= contents_end)
+                            {
+                                ++processed.error_count;
+                                syntax_error_print(current_file, current_line, strfmt(strings::serr_no_endif_else, ifline));
+                                return;
+                            }
+
                             if (cls::is_newline(text_ptr))
                             {
-                                ctrl::increment_line(current_line, processed);
+                                ++current_line;
                             }
-                            else if (const auto space_skipped = skip::space(text_ptr); (*(text_ptr - 1) == '\n') && *
+                            else if (const auto space_skipped = skip::space(text_ptr, contents_end); (*(text_ptr - 1) == '\n') && *
                                 space_skipped == '#')
                             {
                                 text_ptr = space_skipped;
-                                if (memcmp(skip::space(text_ptr + 1), "if", 2) == 0)
+                                if (cls::is_token_equal(skip::space(text_ptr + 1, contents_end), "if", 2, false, false))
                                 {
-                                    auto deeper_skipped = skip::space(text_ptr);
-                                    while (!(cls::is_directive(deeper_skipped) && (cls::is_token_equal(
-                                        skip::space(deeper_skipped + 1), "endif", 5) || cls::is_token_equal(
+                                    auto deeper_skipped = skip::space(text_ptr, contents_end);
+                                    while (text_ptr < contents_end && !(cls::is_directive(deeper_skipped) && (cls::is_token_equal(
+                                        skip::space(deeper_skipped + 1, contents_end), "endif", 5) || cls::is_token_equal(
                                             deeper_skipped + 1, "elif", 4))))
                                     {
-                                        text_ptr = skip::over_comments(text_ptr, current_file, current_line, processed, result);
+                                        text_ptr = skip::over_comments(text_ptr, contents_end, current_line);
+                                        if (text_ptr >= contents_end)
+                                            break;
                                         if (cls::is_newline(text_ptr))
-                                            ctrl::increment_line(current_line, processed);
+                                            ++current_line;
                                         ++text_ptr;
-                                        deeper_skipped = skip::space(text_ptr);
+                                        deeper_skipped = skip::space(text_ptr, contents_end);
                                     }
-                                    text_ptr = skip::to_endline(text_ptr);
+                                    text_ptr = skip::to_endline(text_ptr, contents_end);
                                 }
-                                else if (cls::is_token_equal(skip::space(text_ptr + 1), "elif", 4) ||
-                                    cls::is_token_equal(skip::space(text_ptr + 1), "endif", 5) ||
-                                    cls::is_token_equal(skip::space(text_ptr + 1), "else", 4))
+                                else if (cls::is_token_equal(skip::space(text_ptr + 1, contents_end), "elif", 4) ||
+                                    cls::is_token_equal(skip::space(text_ptr + 1, contents_end), "endif", 5) ||
+                                    cls::is_token_equal(skip::space(text_ptr + 1, contents_end), "else", 4))
                                 {
                                     break;
                                 }
                             }
-                            else if (cls::is_eof(text_ptr))
+                            else
                             {
-                                ++processed.error_count;
-                                syntax_error_print(current_file, current_line, strfmt(strings::serr_no_endif_else, ifline));
-                                return;
+                                // Only newlines, comments and directives at the start of a line matter in here.
+                                text_ptr = lexer::scan_line_or_comment(text_ptr + 1, contents_end) - 1;
                             }
                         }
                     }
@@ -441,33 +425,38 @@ namespace glshader::process
                 {
                     if (accept_else_directive.top())
                     {
-                        text_ptr = skip::to_endline(text_ptr);
+                        text_ptr = skip::to_endline(text_ptr, contents_end);
                     }
                     else
                     {
                         int nesting = 0;
                         while (true)
                         {
+                            if (text_ptr >= contents_end)
+                            {
+                                ++processed.error_count;
+                                syntax_error_print(current_file, current_line, strings::serr_no_endif);
+                                return;
+                            }
+
                             if (cls::is_newline(text_ptr))
                             {
-                                ctrl::increment_line(current_line, processed);
+                                ++current_line;
                             }
                             else if (cls::is_directive(text_ptr))
                             {
-                                if (cls::is_token_equal(skip::space(text_ptr + 1), "if", true, false))
+                                if (cls::is_token_equal(skip::space(text_ptr + 1, contents_end), "if", true, false))
                                     ++nesting;
-                                else if (cls::is_token_equal(skip::space(text_ptr + 1), "endif", 5))
+                                else if (cls::is_token_equal(skip::space(text_ptr + 1, contents_end), "endif", 5))
                                 {
                                     if (nesting == 0)
                                         break;
                                     else nesting--;
                                 }
                             }
-                            else if (cls::is_eof(text_ptr))
+                            else
                             {
-                                ++processed.error_count;
-                                syntax_error_print(current_file, current_line, strings::serr_no_endif);
-                                return;
+                                text_ptr = lexer::scan_line_or_directive(text_ptr + 1, contents_end) - 1;
                             }
 
                             ++text_ptr;
@@ -477,102 +466,81 @@ namespace glshader::process
                 else if (cls::is_token_equal(directive_name, "endif", 5))
                 {
                     accept_else_directive.pop();
-                    text_ptr = skip::to_endline(directive_name);
+                    text_ptr = skip::to_endline(directive_name, contents_end);
                     --defines_nesting;
-                    result << ctrl::line_directive(current_file, current_line, processed);
                 }
                 else if (cls::is_token_equal(directive_name, "line", 4))
                 {
-                    text_ptr = skip::to_next_token(directive_name);
-                    const auto line_nr_end = skip::to_next_space(text_ptr);
-
-                    result << "#line ";
+                    // The output is kept in sync with the new position when the following code is written.
+                    text_ptr = skip::to_next_token(directive_name, contents_end);
+                    const auto line_nr_end = skip::to_next_space(text_ptr, contents_end);
 
                     int new_line_number = 0;
                     for (auto i = text_ptr; (i != line_nr_end) && (new_line_number *= 10) != -1; ++i)
                         new_line_number += *i - '0';
 
-                    result << new_line_number << " ";
-
-                    text_ptr = skip::space(line_nr_end);
+                    text_ptr = skip::space(line_nr_end, contents_end);
                     if (*text_ptr == '\"')
                     {
-                        if (const auto file_name_end = skip::to_next_space(text_ptr) - 1; *file_name_end == '\"')
-                        {
-                            current_file = files::path(std::string(text_ptr + 1, file_name_end));
-                            processed.definitions["__FILE__"] = current_file.string();
-                            result << '\"' << current_file.string() << '\"' << '\n';
-                        }
-                        else
+                        const auto file_name_end = skip::to_next_space(text_ptr, contents_end) - 1;
+                        if (*file_name_end != '\"')
                         {
                             ++processed.error_count;
                             syntax_error_print(current_file, current_line, strings::serr_invalid_line);
-
-                            current_file = files::path(std::string(text_ptr + 1, file_name_end));
-                            processed.definitions["__FILE__"] = current_file.string();
-                            result << '\"' << current_file.string() << '\"' << '\n';
                         }
+                        current_file = files::path(std::string(text_ptr + 1, file_name_end));
+                        current_file_id = ++ctx.file_ids;
                     }
-                    text_ptr = skip::to_endline(text_ptr);
+                    text_ptr = skip::to_endline(text_ptr, contents_end);
 
-                    ctrl::increment_line(current_line = new_line_number - 1, processed);
+                    // The line following the directive has the given number.
+                    current_line = new_line_number - 1;
                 }
                 else if (cls::is_token_equal(directive_name, "error", 5))
                 {
-                    const auto begin = skip::to_next_token(directive_name);
+                    const auto begin = skip::to_next_token(directive_name, contents_end);
                     ++processed.error_count;
-                    syntax_error_print(current_file, current_line, std::string(begin, skip::to_endline(begin)).c_str());
+                    syntax_error_print(current_file, current_line, std::string(begin, skip::to_endline(begin, contents_end)).c_str());
                     return;
                 }
                 else if (cls::is_token_equal(directive_name, "include", 7))
                 {
-                    auto include_begin = skip::to_next_token(text_ptr);
-                    auto include_filename = macro::expand(include_begin, include_begin, current_file, current_line, processed);
-
-                    if ((include_filename.front() != '\"' && include_filename.back() != '\"') && (include_filename.
-                        front() != '<' && include_filename.back() != '>'))
+                    auto include_begin = skip::to_next_token(text_ptr, contents_end);
+                    auto include_end = skip::to_endline(include_begin, contents_end);
+                    while (include_end != include_begin && cls::is_space(include_end - 1))
+                        --include_end;
+                    auto include_filename = macro::expand_all({ include_begin, static_cast<size_t>(include_end - include_begin) }, current_file, current_line, ctx);
+
+                    if (include_filename.size() < 2 || ((include_filename.front() != '\"' && include_filename.back() != '\"') && (include_filename.
+                        front() != '<' && include_filename.back() != '>')))
                     {
                         ++processed.error_count;
                         syntax_error_print(current_file, current_line, strings::serr_invalid_include);
                         return;
                     }
-                    files::path file ={ std::string(include_filename.begin() + 1, include_filename.end() - 1) };
-
-                    bool found_file = false;
-                    for (auto&& directory : include_directories)
-                    {
-                        if (exists(directory / file))
-                        {
-                            found_file = true;
-                            file = directory / file;
-                        }
-                    }
-
-                    if (!found_file)
-                    {
-                        file = file_path.parent_path() / file;
-                    }
-
-                    if (!files::exists(file))
+                    const std::string include_name(include_filename.begin() + 1, include_filename.end() - 1);
+                    const files::path file = impl::input::resolve_include(include_name, file_path.parent_path(), include_directories, ctx);
+                    if (file.empty())
                     {
                         ++processed.error_count;
-                        syntax_error_print(current_file, current_line, strfmt(strings::serr_file_not_found, std::string(include_filename.begin() + 1, include_filename.end() - 1).c_str()));
+                        syntax_error_print(current_file, current_line, strfmt(strings::serr_file_not_found, include_name.c_str()));
                         return;
                     }
 
                     if (unique_includes.count(file) == 0)
                     {
-                        result << ctrl::line_directive(current_file, current_line, processed);
-                        result << ctrl::line_directive(file, 1, processed);
                         processed.dependencies.emplace(file);
 
-                        std::ifstream root_file(file, std::ios::in);
-                        std::string contents(std::istreambuf_iterator<char>{root_file}, std::istreambuf_iterator<char>{});
-                        process_impl(file, contents, include_directories, processed, unique_includes, result, expand_in_macros);
+                        const auto contents = impl::input::load(file, ctx);
+                        if (!contents)
+                        {
+                            ++processed.error_count;
+                            syntax_error_print(current_file, current_line, strfmt(strings::serr_file_not_found, file.string().c_str()));
+                            return;
+                        }
+                        process_impl(file, contents->view(), include_directories, ctx, unique_includes, result, expand_in_macros);
                     }
-                    text_ptr = skip::to_endline(include_begin);
-
-                    result << ctrl::line_directive(current_file, current_line, processed);
+                    text_ptr = skip::to_endline(include_begin, contents_end);
                 }
                 else
                 {
@@ -580,19 +548,22 @@ namespace glshader::process
                         enable_macro = true;
                     else
                         enable_macro = false;
+                    ctrl::sync_line(current_file, current_file_id, current_line, ctx, result);
                     result << *text_ptr;
                     ++text_ptr;
                 }
             }
             else
             {
-                if (!cls::is_name_char(text_ptr))
-                    enable_macro = true;
-                else
-                    enable_macro = false;
-
-                result << *text_ptr;
-                ++text_ptr;
+                // Nothing can happen before the next newline, directive, comment or name.
+                // Names which are not macros are copied as a whole, as no macro can start inside of them.
+                enable_macro = !cls::is_name_char(text_ptr);
+                const auto run_end = enable_macro ? lexer::scan_verbatim(text_ptr + 1, contents_end) : lexer::scan_name(text_ptr, contents_end);
+                // Whitespace may be written anywhere, e.g. before #version where no #line is allowed.
+                if (!enable_macro || std::any_of(text_ptr, run_end, [](const char& c) { return !cls::is_space(&c); }))
+                    ctrl::sync_line(current_file, current_file_id, current_line, ctx, result);
+                result.write(text_ptr, run_end);
+                text_ptr = run_end;
             }
         }
     }
@@ -600,34 +571,93 @@ namespace glshader::process
     processed_file preprocess_file(const files::path& file_path, const std::vector<files::path>& include_directories,
         const std::vector<definition>& definitions, bool expand_in_macros)
     {
-      return preprocess_file(preprocess_file_info{ std::move(include_directories), std::move(definitions), false, false, file_path });
+      return preprocess_file(preprocess_file_info{ { std::move(include_directories), std::move(definitions) }, file_path });
     }
 
     processed_file preprocess_source(const std::string& source, const std::string& name,
         const std::vector<files::path>& include_directories, const std::vector<definition>& definitions, bool expand_in_macros)
     {
-      return preprocess_source(preprocess_source_info{ include_directories, definitions, false, false, source, name });
+      return preprocess_source(preprocess_source_info{ { include_directories, definitions }, source, name });
+    }
+
+    namespace
+    {
+        /* Collects the syntax errors of the preprocessor run on the current thread. Nested runs, e.g. from an error
+        callback, collect their own errors and restore the outer scope afterwards. */
+        class diagnostics_scope
+        {
+        public:
+            diagnostics_scope(processed_file& processed, bool forward)
+                : _processed(processed), _forward(forward), _previous(_current)
+            {
+                _current = this;
+            }
+            ~diagnostics_scope() { _current = _previous; }
+            diagnostics_scope(const diagnostics_scope&) = delete;
+            diagnostics_scope& operator=(const diagnostics_scope&) = delete;
+
+            /* Returns false if the message must not be forwarded to ERR_OUTPUT. */
+            static bool collect(const std::string& message)
+            {
+                if (!_current)
+                    return true;
+                _current->_processed.diagnostics.push_back(message);
+                return _current->_forward;
+            }
+
+        private:
+            processed_file& _processed;
+            bool _forward;
+            diagnostics_scope* _previous;
+
+            static thread_local diagnostics_scope* _current;
+        };
+
+        thread_local diagnostics_scope* diagnostics_scope::_current = nullptr;
+    }
+
+    void syntax_error_print(const files::path& file, const int line, const std::string& reason)
+    {
+        const std::string message = "Error in " + file.string() + ":" + std::to_string(line) + ": " + reason;
+        if (diagnostics_scope::collect(message))
+            ERR_OUTPUT(message);
     }
 
+    processed_file preprocess_impl(const preprocess_info_base& info, std::string_view source, const std::string& name, bool memory_map,
+        const impl::run_settings& settings);
+
     processed_file preprocess_file(preprocess_file_info const& info)
     {
-      if (!exists(info.file_path))
+      return impl::preprocess(info, impl::run_settings{});
+    }
+
+    processed_file preprocess_source(preprocess_source_info const& info)
+    {
+      return impl::preprocess(info, impl::run_settings{});
+    }
+
+    processed_file impl::preprocess(const preprocess_file_info& info, const run_settings& settings)
+    {
+      // The root file is processed in place, without copying it into a preprocess_source_info.
+      const auto contents = info.file_contents ? info.file_contents->load(info.file_path, info.memory_map)
+        : info.memory_map ? source_buffer::map(info.file_path) : source_buffer::read(info.file_path);
+      if (!contents)
       {
         processed_file processed;
+        diagnostics_scope diagnostics(processed, settings.forward_errors);
         ++processed.error_count;
         syntax_error_print("Preprocessor", 0, strfmt(strings::serr_file_not_found, info.file_path.string().c_str()));
         return processed;
       }
+      return preprocess_impl(info, contents->view(), info.file_path.string(), info.memory_map, settings);
+    }
 
-      preprocess_source_info source_info;
-      static_cast<preprocess_info_base&>(source_info) = static_cast<preprocess_info_base>(info);
-      std::ifstream root_file(info.file_path, std::ios::in);
-      source_info.source = std::string(std::istreambuf_iterator<char>{root_file}, std::istreambuf_iterator<char>{});
-      source_info.name = info.file_path.string();
-      return preprocess_source(source_info);
+    processed_file impl::preprocess(const preprocess_source_info& info, const run_settings& settings)
+    {
+      return preprocess_impl(info, info.source, info.name, false, settings);
     }
 
-    processed_file preprocess_source(preprocess_source_info const& info)
+    void impl::load_gl_extensions()
     {
       constexpr uint32_t NUM_EXTENSIONS = 0x821D;
       constexpr uint32_t EXTENSIONS = 0x1F03;
@@ -643,36 +673,93 @@ namespace glshader::process
         if (glGetIntegerv && glGetStringi)
         {
           gl_initialized = true;
-          int n;
+          int n = 0;
           glGetIntegerv(NUM_EXTENSIONS, &n);
+          extension_set extensions;
           for (auto i = 0; i < n; ++i)
-            ext::enable_extension(reinterpret_cast<const char*>(glGetStringi(EXTENSIONS, i)));
+            if (const auto extension = glGetStringi(EXTENSIONS, i))
+              extensions.insert(reinterpret_cast<const char*>(extension));
+          ext::enable_extensions(extensions);
         }
       }
+    }
+
+    processed_file preprocess_impl(const preprocess_info_base& info, std::string_view source, const std::string& name, bool memory_map,
+        const impl::run_settings& settings)
+    {
+      // Without capabilities, the extensions of the current context are added to the ones of all previous runs.
+      if (!info.gl_capabilities)
+        impl::load_gl_extensions();
 
       processed_file processed;
       processed.version = -1;
-      processed.file_path = info.name;
+      processed.file_path = name;
       processed.minified = info.do_minify;
-
+      diagnostics_scope diagnostics(processed, settings.forward_errors);
+
+      // Without a shared cache, conditions are still reused when a file is included multiple times.
+      impl::conditions::storage local_conditions;
+      include_cache local_include_paths;
+      impl::context ctx{ processed };
+      ctx.conditions = info.conditions ? impl::cache_access::storage(*info.conditions) : &local_conditions;
+      ctx.file_contents = info.file_contents;
+      ctx.include_paths = info.include_paths ? info.include_paths : &local_include_paths;
+      ctx.memory_map = memory_map;
+      ctx.gl = info.gl_capabilities;
+      ctx.named_line_directives = info.gl_capabilities ? info.gl_capabilities->named_line_directives : ctrl::query_named_line_directives();
+      ctx.map = info.generate_source_map ? &processed.map : nullptr;
       for (auto&& definition : info.definitions)
-        processed.definitions[definition.name] = definition.info;
-
-      std::stringstream result;
+        ctx.definitions.define(definition.name, definition.info);
+      for (auto&& definition : settings.definitions)
+        ctx.definitions.define(definition.name, definition.info);
+      for (const auto name : settings.watched_names)
+        ctx.definitions.watch(name);
+      ctx.definitions.record_reads(info.record_macro_reads);
+
+      const auto minify = !info.do_minify ? output::minify_mode::none : info.minify_glsl ? output::minify_mode::glsl : output::minify_mode::whitespace;
+      // Dead code can only be found in the complete output, so it is written into the sink afterwards.
+      output::buffer result(info.eliminate_dead_code ? nullptr : info.output, source.size(), minify, ctx.map);
       std::set<files::path> unique_includes;
-      unique_includes.emplace(info.name);
-      process_impl(info.name, info.source, info.include_directories, processed, unique_includes, result, info.expand_in_macros);
-
-      processed.contents = result.str();
+      unique_includes.emplace(name);
+      process_impl(name, source, info.include_directories, ctx, unique_includes, result, info.expand_in_macros);
+      ctx.definitions.materialize(processed.definitions);
+      if (settings.watched_reads)
+      {
+        *settings.watched_reads = 0;
+        for (size_t i = 0; i < settings.watched_names.size(); ++i)
+          if (ctx.definitions.was_read(settings.watched_names[i]))
+            *settings.watched_reads |= uint64_t(1) << i;
+      }
+      if (info.record_macro_reads)
+        processed.macro_reads = ctx.definitions.reads();
+      if (info.builtin_definitions)
+      {
+        processed.definitions.emplace("__FILE__", ctx.end_file.string());
+        processed.definitions.emplace("__LINE__", ctx.end_line);
+        if (!ctx.version.empty())
+          processed.definitions.emplace("__VERSION__", ctx.version);
+      }
 
-      if (info.do_minify)
+      processed.contents = result.take();
+      if (info.eliminate_dead_code)
       {
-        processed.contents = minify(processed.contents);
+        processed.dead_code_bytes = impl::dead_code::eliminate(processed.contents, ctx.map, !info.do_minify && !ctx.map);
+        if (info.output)
+        {
+          info.output->write(processed.contents.data(), processed.contents.size());
+          processed.contents = std::string();
+        }
       }
 
       return processed;
     }
 
+    state::state()
+        : _file_cache(std::make_shared<file_cache>())
+    {
+
+    }
+
     void state::add_definition(const definition& d)
     {
         _definitions.push_back(d);
@@ -697,18 +784,42 @@ namespace glshader::process
 
     processed_file state::preprocess_file(const files::path& file_path, std::vector<files::path> include_directories, std::vector<definition> definitions)
     {
-      return preprocess_file(preprocess_file_info{ std::move(include_directories), std::move(definitions), false, false, file_path });
+      return preprocess_file(preprocess_file_info{ { std::move(include_directories), std::move(definitions) }, file_path });
     }
 
     processed_file state::preprocess_source(const std::string& source, const std::string& name, std::vector<files::path> include_directories, std::vector<definition> definitions)
     {
-      return preprocess_source(preprocess_source_info{ std::move(include_directories), std::move(definitions), false, false, source, name });
+      return preprocess_source(preprocess_source_info{ { std::move(include_directories), std::move(definitions) }, source, name });
+    }
+
+    void state::set_file_cache(std::shared_ptr<file_cache> cache)
+    {
+        _file_cache = std::move(cache);
+    }
+
+    const std::shared_ptr<file_cache>& state::get_file_cache() const noexcept
+    {
+        return _file_cache;
+    }
+
+    void state::set_include_cache(std::shared_ptr<include_cache> cache)
+    {
+        _include_cache = std::move(cache);
+    }
+
+    const std::shared_ptr<include_cache>& state::get_include_cache() const noexcept
+    {
+        return _include_cache;
     }
 
     processed_file state::preprocess_file(preprocess_file_info info)
     {
       info.include_directories.insert(info.include_directories.begin(), _include_directories.begin(), _include_directories.end());
       info.definitions.insert(info.definitions.begin(), _definitions.begin(), _definitions.end());
+      if (!info.file_contents)
+        info.file_contents = _file_cache.get();
+      if (!info.include_paths)
+        info.include_paths = _include_cache.get();
       return glsp::preprocess_file(info);
     }
 
@@ -716,6 +827,10 @@ namespace glshader::process
     {
       info.include_directories.insert(info.include_directories.begin(), _include_directories.begin(), _include_directories.end());
       info.definitions.insert(info.definitions.begin(), _definitions.begin(), _definitions.end());
+      if (!info.file_contents)
+        info.file_contents = _file_cache.get();
+      if (!info.include_paths)
+        info.include_paths = _include_cache.get();
       return glsp::preprocess_source(info);
     }
 
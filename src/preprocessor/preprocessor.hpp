@@ -0,0 +1,25 @@
+#pragma once
+
+#include <glsp/preprocess.hpp>
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace glshader::process::impl
+{
+    /* Settings of a single preprocessor run which are not part of the info structs. */
+    struct run_settings
+    {
+        bool forward_errors = true;     /* Pass syntax errors to ERR_OUTPUT as they occur, otherwise they are only collected in processed_file::diagnostics. */
+        std::vector<definition> definitions;            /* Defined after the definitions of the info. */
+        std::vector<std::string_view> watched_names;    /* At most 64 names whose lookups are recorded, whether they are defined or not. */
+        uint64_t* watched_reads = nullptr;              /* If set, receives a mask with bit i set if watched_names[i] has been looked up. */
+    };
+
+    /* Adds the extensions of the GL context current on this thread to the set of available extensions. */
+    void load_gl_extensions();
+
+    processed_file preprocess(const preprocess_file_info& info, const run_settings& settings);
+    processed_file preprocess(const preprocess_source_info& info, const run_settings& settings);
+}
@@ -1,16 +1,13 @@
 #include "skip.hpp"
 
 #include "classify.hpp"
-#include "control.hpp"
-
-#include <cstring>
-#include <sstream>
+#include "lexer.hpp"
 
 namespace glshader::process::impl::skip
 {
-    const char* space(const char* c)
+    const char* space(const char* c, const char* end)
     {
-        while (classify::is_space(c) && !classify::is_eof(c)) ++c;
+        while (c < end && classify::is_space(c)) ++c;
         return c;
     }
 
@@ -20,54 +17,55 @@ namespace glshader::process::impl::skip
         return c;
     }
 
-    const char* to_next_space(const char* c)
+    const char* to_next_space(const char* c, const char* end)
     {
         using namespace classify;
-        while (!is_space(c) && !is_newline(c) && !is_eof(c))
+        while (c < end && !is_space(c) && !is_newline(c))
             ++c;
         return c;
     }
 
-    const char* to_next_space(const char* c, char alt)
+    const char* to_next_space(const char* c, const char* end, char alt)
     {
         using namespace classify;
-        while (!is_space(c) && !is_newline(c) && !is_eof(c) && *c != alt)
+        while (c < end && !is_space(c) && !is_newline(c) && *c != alt)
             ++c;
         return c;
     }
 
-    const char* to_endline(const char* c)
+    const char* to_endline(const char* c, const char* end)
     {
-        using namespace classify;
-        while (!is_newline(c) && !is_eof(c))
-            ++c;
-        return c;
+        return lexer::scan_line(c, end);
     }
 
-    const char* to_next_token(const char* c)
+    const char* to_next_token(const char* c, const char* end)
     {
-        return space(to_next_space(c));
+        return space(to_next_space(c, end), end);
     }
 
-    const char* over_comments(const char* text_ptr, const files::path& file, int& line, processed_file& processed, std::stringstream& result)
+    const char* over_comments(const char* text_ptr, const char* end, int& line)
     {
-        if (strncmp(text_ptr, "//", 2) == 0)
+        if (end - text_ptr < 2 || *text_ptr != '/')
+            return text_ptr;
+
+        if (text_ptr[1] == '/')
         {
-            while (!classify::is_newline(text_ptr) && !classify::is_eof(text_ptr))
-                ++text_ptr;
+            text_ptr = lexer::scan_line(text_ptr + 2, end);
         }
-        else if (strncmp(text_ptr, "/*", 2) == 0)
+        else if (text_ptr[1] == '*')
         {
-            while (strncmp(text_ptr, "*/", 2) != 0)
+            for (text_ptr += 2;; ++text_ptr)
             {
+                text_ptr = lexer::scan_block_comment(text_ptr, end);
+                if (text_ptr == end)
+                    return end;
                 if (classify::is_newline(text_ptr))
-                    control::increment_line(line, processed);
-                ++text_ptr;
+                    ++line;
+                else if (end - text_ptr >= 2 && text_ptr[1] == '/')
+                    break;
             }
 
             text_ptr += 2;
-            if (processed.version != -1)
-                result << control::line_directive(file, line, processed);
         }
         return text_ptr;
     }
@@ -4,11 +4,12 @@
 
 namespace glshader::process::impl::skip
 {
-    const char* space           (const char* c);
+    /* All functions moving forward stop at end at the latest. */
+    const char* space           (const char* c, const char* end);
     const char* space_rev       (const char* c);
-    const char* to_next_space   (const char* c);
-    const char* to_next_space   (const char* c, char alt);
-    const char* to_endline      (const char* c);
-    const char* to_next_token   (const char* c);
-    const char* over_comments   (const char* text_ptr, const files::path& file, int& line, processed_file& processed, std::stringstream& result);
+    const char* to_next_space   (const char* c, const char* end);
+    const char* to_next_space   (const char* c, const char* end, char alt);
+    const char* to_endline      (const char* c, const char* end);
+    const char* to_next_token   (const char* c, const char* end);
+    const char* over_comments   (const char* text_ptr, const char* end, int& line);
 }
\ No newline at end of file
@@ -0,0 +1,99 @@
+#include <glsp/source_buffer.hpp>
+
+#include <fstream>
+#include <iterator>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace glshader::process
+{
+    source_buffer::source_buffer(std::string contents)
+        : _contents(std::move(contents))
+    {
+        _data = _contents.data();
+        _size = _contents.size();
+    }
+
+    source_buffer::~source_buffer()
+    {
+        if (!_mapping)
+            return;
+#ifdef _WIN32
+        UnmapViewOfFile(_mapping);
+#else
+        munmap(_mapping, _mapping_size);
+#endif
+    }
+
+    std::shared_ptr<const source_buffer> source_buffer::read(const files::path& path)
+    {
+        std::ifstream file(path, std::ios::in);
+        if (!file)
+            return nullptr;
+
+        std::string contents;
+        std::error_code error;
+        if (const auto size = files::file_size(path, error); !error)
+            contents.reserve(static_cast<size_t>(size));
+        contents.assign(std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{});
+        return std::make_shared<const source_buffer>(std::move(contents));
+    }
+
+    std::shared_ptr<const source_buffer> source_buffer::map(const files::path& path)
+    {
+        std::shared_ptr<source_buffer> buffer(new source_buffer());
+#ifdef _WIN32
+        SYSTEM_INFO system_info;
+        GetSystemInfo(&system_info);
+        const size_t page_size = system_info.dwPageSize;
+
+        const HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return nullptr;
+
+        LARGE_INTEGER size;
+        if (GetFileSizeEx(file, &size) && size.QuadPart > 0 && size.QuadPart % page_size != 0)
+        {
+            if (const HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr))
+            {
+                buffer->_mapping = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                buffer->_mapping_size = static_cast<size_t>(size.QuadPart);
+                CloseHandle(mapping);
+            }
+        }
+        CloseHandle(file);
+#else
+        const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+        const int file = open(path.c_str(), O_RDONLY);
+        if (file == -1)
+            return nullptr;
+
+        struct stat status;
+        if (fstat(file, &status) == 0 && status.st_size > 0 && static_cast<size_t>(status.st_size) % page_size != 0)
+        {
+            void* const mapping = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+            if (mapping != MAP_FAILED)
+            {
+                buffer->_mapping = mapping;
+                buffer->_mapping_size = static_cast<size_t>(status.st_size);
+            }
+        }
+        close(file);
+#endif
+
+        // The rest of the last page is zero-filled, which provides the terminating '\0'.
+        if (!buffer->_mapping)
+            return read(path);
+        buffer->_data = static_cast<const char*>(buffer->_mapping);
+        buffer->_size = buffer->_mapping_size;
+        return buffer;
+    }
+}
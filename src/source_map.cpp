@@ -0,0 +1,243 @@
+#include <glsp/source_map.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+namespace glshader::process
+{
+    namespace {
+        /* Unsigned LEB128: 7 bits per byte, the high bit marks that more bytes follow. */
+        void write_unsigned(std::string& data, uint32_t value)
+        {
+            while (value >= 0x80)
+            {
+                data.push_back(static_cast<char>((value & 0x7f) | 0x80));
+                value >>= 7;
+            }
+            data.push_back(static_cast<char>(value));
+        }
+
+        /* Signed values are zigzag-encoded, so small negative deltas stay small. */
+        void write_signed(std::string& data, int32_t value)
+        {
+            write_unsigned(data, (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31));
+        }
+
+        uint32_t read_unsigned(const std::string& data, size_t& offset)
+        {
+            uint32_t value = 0;
+            for (int shift = 0; offset < data.size() && shift < 32; shift += 7)
+            {
+                const auto byte = static_cast<uint8_t>(data[offset++]);
+                value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+                if (!(byte & 0x80))
+                    break;
+            }
+            return value;
+        }
+
+        int32_t read_signed(const std::string& data, size_t& offset)
+        {
+            const uint32_t value = read_unsigned(data, offset);
+            return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+        }
+
+        bool starts_with(std::string_view str, std::string_view prefix)
+        {
+            return str.substr(0, prefix.size()) == prefix;
+        }
+
+        /* Parses a decimal number at the start of str and removes it. Returns -1 if there is none. */
+        int parse_number(std::string_view& str)
+        {
+            size_t length = 0;
+            int value = 0;
+            while (length < str.size() && length < 9 && str[length] >= '0' && str[length] <= '9')
+                value = value * 10 + (str[length++] - '0');
+            if (length == 0)
+                return -1;
+            str.remove_prefix(length);
+            return value;
+        }
+    }
+
+    source_map::source_map(std::vector<std::string> files, std::string data)
+        : _files(std::move(files)), _data(std::move(data))
+    {
+        // Restore the encoder state, so runs can be added to a restored map.
+        size_t offset = 0;
+        while (offset < _data.size())
+        {
+            _before_end = _end;
+            _end_offset = offset;
+            const int line_delta = static_cast<int>(read_unsigned(_data, offset));
+            const int column = static_cast<int>(read_unsigned(_data, offset));
+            _end.output_column = line_delta > 0 ? column + 1 : _end.output_column + column;
+            _end.output_line += line_delta;
+            _end.file += read_signed(_data, offset);
+            _end.line += read_signed(_data, offset);
+            ++_size;
+        }
+    }
+
+    void source_map::add(int output_line, int output_column, std::string_view file, int line)
+    {
+        assert(_size == 0 || output_line > _end.output_line || (output_line == _end.output_line && output_column >= _end.output_column));
+
+        auto file_it = std::find(_files.rbegin(), _files.rend(), file);
+        if (file_it == _files.rend())
+        {
+            _files.emplace_back(file);
+            file_it = _files.rbegin();
+        }
+        const auto file_index = static_cast<uint32_t>(std::distance(file_it, _files.rend()) - 1);
+
+        // A run without any code in between is replaced.
+        if (_size > 0 && output_line == _end.output_line && output_column == _end.output_column)
+        {
+            _data.resize(_end_offset);
+        }
+        else
+        {
+            _before_end = _end;
+            _end_offset = _data.size();
+            ++_size;
+        }
+
+        const cursor& previous = _before_end;
+        const int line_delta = output_line - previous.output_line;
+        write_unsigned(_data, static_cast<uint32_t>(line_delta));
+        write_unsigned(_data, static_cast<uint32_t>(line_delta > 0 ? output_column - 1 : output_column - previous.output_column));
+        write_signed(_data, static_cast<int32_t>(file_index - previous.file));
+        write_signed(_data, line - previous.line);
+        _end = { output_line, output_column, file_index, line };
+    }
+
+    std::vector<source_map::run> source_map::runs() const
+    {
+        std::vector<run> result;
+        result.reserve(_size);
+        cursor current;
+        size_t offset = 0;
+        while (offset < _data.size())
+        {
+            const int line_delta = static_cast<int>(read_unsigned(_data, offset));
+            const int column = static_cast<int>(read_unsigned(_data, offset));
+            current.output_column = line_delta > 0 ? column + 1 : current.output_column + column;
+            current.output_line += line_delta;
+            current.file += read_signed(_data, offset);
+            current.line += read_signed(_data, offset);
+            result.push_back({ current.output_line, current.output_column, current.file, current.line });
+        }
+        return result;
+    }
+
+    source_map::location source_map::find(int output_line, int output_column) const
+    {
+        const auto all = runs();
+        const auto it = std::upper_bound(all.begin(), all.end(), std::make_pair(output_line, output_column), [](const auto& position, const run& r) {
+            return position < std::make_pair(r.output_line, r.output_column);
+        });
+        if (it == all.begin())
+            return {};
+
+        const run& r = *std::prev(it);
+        if (r.file >= _files.size())
+            return {};
+        return { _files[r.file], r.line + (output_line - r.output_line) };
+    }
+
+    std::string source_map::rewrite_log(std::string_view log, int source_string) const
+    {
+        const auto all = runs();
+        std::string result;
+        result.reserve(log.size());
+        while (!log.empty())
+        {
+            const size_t line_end = std::min(log.find('\n'), log.size() - 1) + 1;
+            std::string_view line = log.substr(0, line_end);
+            log.remove_prefix(line_end);
+
+            for (const std::string_view prefix : { "ERROR: ", "WARNING: " })
+            {
+                if (starts_with(line, prefix))
+                {
+                    result.append(prefix);
+                    line.remove_prefix(prefix.size());
+                    break;
+                }
+            }
+
+            // Parse "S(L)", "S:L(C)" or "S:L" and keep the untouched line if anything does not match.
+            std::string_view rest = line;
+            const int string_index = parse_number(rest);
+            int output_line = -1;
+            int output_column = 1;
+            bool parenthesized = false;
+            const bool line_in_parentheses = !rest.empty() && rest[0] == '(';
+            if (line_in_parentheses)
+            {
+                rest.remove_prefix(1);
+                output_line = parse_number(rest);
+                parenthesized = true;
+            }
+            else if (!rest.empty() && rest[0] == ':')
+            {
+                rest.remove_prefix(1);
+                output_line = parse_number(rest);
+                if (!rest.empty() && rest[0] == '(')
+                {
+                    rest.remove_prefix(1);
+                    output_column = std::max(parse_number(rest), 1);
+                    parenthesized = true;
+                }
+            }
+            if (parenthesized && (rest.empty() || rest[0] != ')'))
+                output_line = -1;
+            else if (parenthesized)
+                rest.remove_prefix(1);
+
+            // Without a column, a line holding code of several source lines cannot be mapped.
+            const bool ambiguous = output_column == 1 && std::any_of(all.begin(), all.end(), [&](const run& r) {
+                return r.output_line == output_line && r.output_column > 1;
+            });
+            location source;
+            if (string_index == source_string && output_line > 0 && !ambiguous)
+                source = find(output_line, output_column);
+
+            if (source.line <= 0)
+            {
+                result.append(line);
+                continue;
+            }
+
+            result.append(source.file);
+            if (line_in_parentheses)
+                result.append("(").append(std::to_string(source.line)).append(")");
+            else
+                result.append(":").append(std::to_string(source.line));
+            result.append(rest);
+        }
+        return result;
+    }
+
+    bool source_map::empty() const noexcept
+    {
+        return _size == 0;
+    }
+
+    size_t source_map::size() const noexcept
+    {
+        return _size;
+    }
+
+    const std::vector<std::string>& source_map::files() const noexcept
+    {
+        return _files;
+    }
+
+    const std::string& source_map::data() const noexcept
+    {
+        return _data;
+    }
+}
@@ -15,6 +15,7 @@ namespace glshader::process
     namespace strings
     {
         constexpr const char* serr_unrecognized_profile     = "Unrecognized #version profile: %s. Using core.";
+        constexpr const char* serr_invalid_version          = "Invalid #version directive, expected a version number.";
         constexpr const char* serr_extension_all_behavior   = "Cannot use #extension behavior \"%s\", must be \"warn\" or \"disable\".";
         constexpr const char* serr_extension_behavior       = "Unrecognized #extension behavior \"%s\", must be \"require\", \"enable\", \"warn\" or \"disable\".";
         constexpr const char* serr_no_endif_else            = "No closing #endif or #else found for if-expression in line %i.";
@@ -23,7 +24,11 @@ namespace glshader::process
         constexpr const char* serr_invalid_include          = "Include must be in \"...\" or <...>.";
         constexpr const char* serr_file_not_found           = "File not found: %s";
         constexpr const char* serr_eval_end_of_brackets     = "Unexpected end of brackets.";
+        constexpr const char* serr_eval_unexpected_token    = "Unexpected token in expression: %s";
+        constexpr const char* serr_eval_defined_operand     = "Expected a macro name after \"defined\".";
+        constexpr const char* serr_eval_division_by_zero    = "Division by zero in expression.";
         constexpr const char* serr_non_matching_argc        = "Macro %s: non-matching argument count.";
+        constexpr const char* serr_too_many_axes            = "Cannot preprocess permutations of %zu axes, at most 64 are supported.";
 
         constexpr const char* serr_loader_failed            = "Unable to load required OpenGL functions. Please check whether the current context is valid and supports GL_ARB_separate_shader_objects.";
         constexpr const char* serr_unsupported              = "%s is currently not supported.";
@@ -0,0 +1,101 @@
+#include "test.hpp"
+
+#include <glsp/capabilities.hpp>
+
+#include <atomic>
+#include <fstream>
+#include <stdexcept>
+
+using glsp_test::code_lines;
+using lines = std::vector<std::string>;
+
+namespace
+{
+    /* Files a.glsl, b.glsl, ... in a fresh directory, each containing its own name. */
+    std::vector<glsp::preprocess_file_info> files(const std::string& name, size_t count)
+    {
+        static const glsp::capabilities gl = [] {
+            glsp::capabilities caps;
+            caps.version = 450;
+            return caps;
+        }();
+        const auto dir = glsp::files::temp_directory_path() / "glsp_tests" / name;
+        glsp::files::remove_all(dir);
+        glsp::files::create_directories(dir);
+
+        std::vector<glsp::preprocess_file_info> infos(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const std::string file(1, char('a' + i));
+            std::ofstream(dir / (file + ".glsl")) << "#include \"common.glsl\"\n" << file << "\n";
+            infos[i].file_path = dir / (file + ".glsl");
+            infos[i].gl_capabilities = &gl;
+            infos[i].generate_source_map = true;
+        }
+        std::ofstream(dir / "common.glsl") << "common\n";
+        return infos;
+    }
+}
+
+TEST_CASE(every_job_runs_once)
+{
+    glsp::thread_pool pool(4);
+    CHECK_EQ(pool.thread_count(), size_t(4));
+    for (const size_t count : { size_t(0), size_t(1), size_t(3), size_t(1000) })
+    {
+        std::vector<std::atomic<int>> calls(count);
+        pool.run(count, [&](size_t index) { ++calls[index]; });
+        for (const auto& c : calls)
+            CHECK_EQ(c.load(), 1);
+    }
+}
+
+TEST_CASE(exceptions_are_rethrown_after_the_run)
+{
+    glsp::thread_pool pool(3);
+    std::atomic<int> calls{ 0 };
+    bool thrown = false;
+    try
+    {
+        pool.run(100, [&](size_t index) {
+            ++calls;
+            if (index == 7)
+                throw std::runtime_error("job");
+        });
+    }
+    catch (const std::runtime_error&)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+    CHECK_EQ(calls.load(), 100);
+}
+
+TEST_CASE(batches_keep_the_order_of_the_files)
+{
+    const auto infos = files("batch_order", 6);
+    glsp::thread_pool pool(3);
+    for (const auto& executor : { glsp::batch_executor(), pool.executor() })
+    {
+        const auto results = glsp::preprocess_batch(infos, executor);
+        CHECK_EQ(results.size(), infos.size());
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            CHECK_EQ(code_lines(results[i].contents), (lines{ "common", std::string(1, char('a' + i)) }));
+            CHECK_EQ(results[i].dependencies.size(), size_t(1));
+        }
+    }
+}
+
+TEST_CASE(nested_runs_do_not_wait_for_themselves)
+{
+    const auto infos = files("batch_nested", 3);
+    glsp::thread_pool pool(2);
+    std::vector<size_t> sizes(4);
+    pool.run(sizes.size(), [&](size_t index) {
+        sizes[index] = glsp::preprocess_batch(infos, pool.executor()).size();
+        pool.run(2, [](size_t) {});
+    });
+    for (const size_t size : sizes)
+        CHECK_EQ(size, infos.size());
+}
@@ -0,0 +1,34 @@
+#include "test.hpp"
+
+using glsp_test::code_lines;
+using glsp_test::preprocess;
+using lines = std::vector<std::string>;
+
+TEST_CASE(line_and_file_are_resolved_where_used)
+{
+    CHECK_EQ(code_lines(preprocess("int a = __LINE__;\n\n__LINE__ __FILE__\n#define L __LINE__\nL\n").contents),
+        (lines{ "int a = 1;", "3 test.glsl", "5" }));
+}
+
+TEST_CASE(version_is_defined_after_the_version_directive)
+{
+    CHECK_EQ(code_lines(preprocess("#version 330 core\n#ifdef __VERSION__\n__VERSION__\n#endif\n").contents),
+        (lines{ "#version 330 core", "330" }));
+    CHECK_EQ(code_lines(preprocess("#ifdef __VERSION__\nversion\n#endif\n#if defined(__LINE__) && defined(__FILE__)\nline file\n#endif\n").contents),
+        lines{ "line file" });
+}
+
+TEST_CASE(builtins_are_only_listed_on_request)
+{
+    const auto plain = preprocess("#version 450\n#define A 1\n");
+    CHECK(plain.definitions.count("A") == 1);
+    CHECK(plain.definitions.count("__LINE__") == 0);
+    CHECK(plain.definitions.count("__FILE__") == 0);
+
+    glsp::preprocess_source_info info;
+    info.builtin_definitions = true;
+    const auto listed = preprocess("#version 450\n#define A 1\n", info);
+    CHECK(listed.definitions.count("__LINE__") == 1);
+    CHECK_EQ(listed.definitions.at("__FILE__").replacement, std::string("test.glsl"));
+    CHECK_EQ(listed.definitions.at("__VERSION__").replacement, std::string("450"));
+}
@@ -0,0 +1,65 @@
+#include "test.hpp"
+
+#include <glsp/capabilities.hpp>
+
+#include <fstream>
+
+using glsp_test::code_lines;
+using lines = std::vector<std::string>;
+
+namespace
+{
+    glsp::files::path file(const std::string& name, const std::string& contents)
+    {
+        const auto dir = glsp::files::temp_directory_path() / "glsp_tests" / "capabilities";
+        glsp::files::create_directories(dir);
+        std::ofstream(dir / name, std::ios::binary) << contents;
+        return dir / name;
+    }
+}
+
+TEST_CASE(saved_capabilities_load_unchanged)
+{
+    glsp::capabilities caps;
+    caps.version = 460;
+    caps.vendor = "Vendor Inc.";
+    caps.renderer = "Renderer 1 (with spaces)";
+    caps.named_line_directives = true;
+    caps.extensions.insert("GL_ARB_gpu_shader_int64");
+    caps.extensions.insert("GL_my_own_extension");
+
+    const auto path = file("saved.txt", "");
+    CHECK(caps.save(path));
+    const auto loaded = glsp::capabilities::load(path);
+    CHECK(loaded.has_value());
+    CHECK_EQ(loaded->version, 460u);
+    CHECK_EQ(loaded->vendor, std::string("Vendor Inc."));
+    CHECK_EQ(loaded->renderer, std::string("Renderer 1 (with spaces)"));
+    CHECK(loaded->named_line_directives);
+    CHECK_EQ(loaded->extensions.names(), caps.extensions.names());
+}
+
+TEST_CASE(malformed_capabilities_are_rejected)
+{
+    CHECK(!glsp::capabilities::load(file("missing_dir/none.txt", "")).has_value());
+    CHECK(!glsp::capabilities::load(file("version.txt", "version four\n")).has_value());
+    CHECK(!glsp::capabilities::load(file("key.txt", "version 450\ncolor blue\n")).has_value());
+
+    const auto crlf = glsp::capabilities::load(file("crlf.txt", "version 330\r\n\r\nextension GL_ARB_compute_shader\r\n"));
+    CHECK(crlf.has_value());
+    CHECK_EQ(crlf->version, 330u);
+    CHECK(crlf->has_extension("GL_ARB_compute_shader"));
+}
+
+TEST_CASE(capabilities_are_used_without_a_context)
+{
+    glsp::capabilities caps;
+    caps.version = 330;
+    caps.extensions.insert("GL_ARB_compute_shader");
+    glsp::preprocess_source_info info;
+    info.source = "#if defined(GL_ARB_compute_shader) && !defined(GL_ARB_gpu_shader_int64)\nyes\n#endif\n";
+    info.name = "test.glsl";
+    info.gl_capabilities = &caps;
+    info.generate_source_map = true;
+    CHECK_EQ(code_lines(glsp::preprocess_source(info).contents), lines{ "yes" });
+}
@@ -0,0 +1,29 @@
+#include "test.hpp"
+
+using glsp_test::code_lines;
+using glsp_test::preprocess;
+using lines = std::vector<std::string>;
+
+TEST_CASE(arithmetic_follows_c_precedence)
+{
+    CHECK_EQ(code_lines(preprocess("#if 2 + 3 * 4 == 14 && !(1 > 2)\na\n#elif 1\nb\n#endif\n").contents), lines{ "a" });
+    CHECK_EQ(code_lines(preprocess("#define V 3\n#if V >= 3 && (V % 2) == 1 && (0x10 >> 2) == 4 && ~0 == -1\nyes\n#endif\n").contents), lines{ "yes" });
+}
+
+TEST_CASE(undefined_names_are_zero)
+{
+    CHECK_EQ(code_lines(preprocess("#if UNDEFINED_NAME\na\n#elif defined UNDEFINED_NAME || -1 < 0\nb\n#else\nc\n#endif\n").contents), lines{ "b" });
+}
+
+TEST_CASE(skipped_operands_are_not_evaluated)
+{
+    const auto processed = preprocess("#if 0 && (1 / 0)\nbad\n#endif\nend\n");
+    CHECK_EQ(code_lines(processed.contents), lines{ "end" });
+    CHECK_EQ(processed.error_count, 0);
+}
+
+TEST_CASE(nested_and_defined_conditions)
+{
+    CHECK_EQ(code_lines(preprocess("#if 1\n#if 0\nx\n#else\ny\n#endif\n#endif\n#ifdef V\nz\n#endif\n#ifndef V\nw\n#endif\n").contents), (lines{ "y", "w" }));
+    CHECK_EQ(code_lines(preprocess("#define V\n#if defined(V) && !defined(W)\nv\n#endif\n").contents), lines{ "v" });
+}
@@ -0,0 +1,66 @@
+#include "test.hpp"
+
+#include <algorithm>
+
+using glsp_test::code_lines;
+using glsp_test::preprocess;
+using lines = std::vector<std::string>;
+
+namespace
+{
+    glsp::processed_file eliminate(const std::string& source, bool source_map = false)
+    {
+        glsp::preprocess_source_info info;
+        info.eliminate_dead_code = true;
+        return preprocess(source, info, source_map);
+    }
+
+    const std::string shader =
+        "#version 450\n"
+        "struct Unused { float x; };\n"
+        "struct Light { vec3 p; };\n"
+        "uniform Light light;\n"
+        "float unused(float x) { return x; }\n"
+        "float helper(float x) { return x * 2.0; }\n"
+        "float helper(int x) { return 1.0; }\n"
+        "const float K = 3.0;\n"
+        "const float UNUSED_K = 4.0;\n"
+        "out vec4 color;\n"
+        "void main()\n"
+        "{\n"
+        "    color = vec4(helper(K) + light.p.x);\n"
+        "}\n";
+}
+
+TEST_CASE(unreachable_declarations_are_removed)
+{
+    const auto processed = eliminate(shader);
+    CHECK_EQ(code_lines(processed.contents), (lines{
+        "#version 450",
+        "struct Light { vec3 p; };",
+        "uniform Light light;",
+        "float helper(float x) { return x * 2.0; }",
+        "float helper(int x) { return 1.0; }",
+        "const float K = 3.0;",
+        "out vec4 color;",
+        "void main()",
+        "{",
+        "color = vec4(helper(K) + light.p.x);",
+        "}" }));
+    CHECK_EQ(processed.dead_code_bytes, size_t(89));
+}
+
+TEST_CASE(removed_code_keeps_the_source_lines)
+{
+    const auto processed = eliminate(shader, true);
+    const auto main_at = processed.contents.find("void main");
+    const int output_line = 1 + static_cast<int>(std::count(processed.contents.begin(), processed.contents.begin() + main_at, '\n'));
+    CHECK_EQ(processed.map.find(output_line).line, 11);
+}
+
+TEST_CASE(code_without_main_is_kept)
+{
+    const auto processed = eliminate("float lib(float x) { return x; }\nfloat other() { return 1.0; }\n");
+    CHECK_EQ(code_lines(processed.contents), (lines{ "float lib(float x) { return x; }", "float other() { return 1.0; }" }));
+    CHECK_EQ(processed.dead_code_bytes, size_t(0));
+}
@@ -0,0 +1,24 @@
+#include "test.hpp"
+
+using glsp_test::code_lines;
+using glsp_test::preprocess;
+using lines = std::vector<std::string>;
+
+TEST_CASE(extension_behaviors)
+{
+    const auto processed = preprocess("#extension GL_ARB_foo : require\n#extension all : warn\n");
+    CHECK(processed.extensions.at("GL_ARB_foo") == glsp::ext_behavior::require);
+    CHECK(processed.extensions.at("all") == glsp::ext_behavior::warn);
+    CHECK_EQ(processed.error_count, 0);
+}
+
+TEST_CASE(directives_at_the_end_of_the_source)
+{
+    CHECK_EQ(preprocess("int a;\n#extension").error_count, 1);
+    CHECK_EQ(preprocess("int a;\n#extension GL_ARB_foo :").error_count, 1);
+    CHECK_EQ(preprocess("#version").error_count, 1);
+    CHECK_EQ(code_lines(preprocess("int a;\n#define").contents), lines{ "int a;" });
+    CHECK_EQ(code_lines(preprocess("#define A\n#ifdef A\nyes\n#endif\n#undef").contents), lines{ "yes" });
+    CHECK_EQ(code_lines(preprocess("#define A 1 \\").contents), lines{});
+    CHECK_EQ(code_lines(preprocess("#define A(x").contents), lines{});
+}
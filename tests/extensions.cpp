@@ -0,0 +1,47 @@
+#include "test.hpp"
+
+#include <glsp/capabilities.hpp>
+#include "preprocessor/extensions.hpp"
+
+namespace ext = glsp::impl::ext;
+using lines = std::vector<std::string>;
+
+TEST_CASE(every_registry_name_has_its_own_id)
+{
+    for (uint32_t id = 0; id < ext::known_count(); ++id)
+        CHECK_EQ(ext::known_id(ext::known_name(id)), id);
+    CHECK_EQ(ext::known_id("GL_ARB_not_an_extension"), ext::unknown_id);
+    CHECK_EQ(ext::known_id(""), ext::unknown_id);
+    // A prefix of a registry name hashes differently and must not match it.
+    CHECK_EQ(ext::known_id(ext::known_name(0).substr(0, ext::known_name(0).size() - 1)), ext::unknown_id);
+}
+
+TEST_CASE(extension_sets_hold_registry_and_other_names)
+{
+    glsp::extension_set set;
+    CHECK(set.empty());
+    set.insert("GL_my_own_extension");
+    set.insert("GL_ARB_gpu_shader_int64");
+    set.insert("GL_ARB_compute_shader");
+    set.insert("GL_ARB_compute_shader");
+    CHECK_EQ(set.size(), size_t(3));
+    CHECK(set.contains("GL_ARB_compute_shader"));
+    CHECK(set.contains("GL_my_own_extension"));
+    CHECK(!set.contains("GL_ARB_tessellation_shader"));
+    CHECK(!set.contains("GL_my_other_extension"));
+    CHECK_EQ(set.names(), (lines{ "GL_ARB_compute_shader", "GL_ARB_gpu_shader_int64", "GL_my_own_extension" }));
+
+    glsp::extension_set other;
+    other.insert("GL_ARB_compute_shader");
+    other.insert("GL_ARB_tessellation_shader");
+    other.insert("GL_my_other_extension");
+    set.merge(other);
+    CHECK_EQ(set.size(), size_t(5));
+    CHECK(set.contains("GL_ARB_tessellation_shader"));
+    CHECK(set.contains("GL_my_other_extension"));
+
+    set.clear();
+    CHECK(set.empty());
+    CHECK(!set.contains("GL_ARB_compute_shader"));
+    CHECK(set.names().empty());
+}
@@ -0,0 +1,76 @@
+#include "test.hpp"
+
+#include "compiler/hash128.hpp"
+
+#include <algorithm>
+#include <unordered_set>
+
+using glsp::impl::hash::hash128;
+using glsp::impl::hash::hasher128;
+
+namespace
+{
+    hash128 hash(const std::string& data)
+    {
+        hasher128 hasher;
+        hasher.update(data.data(), data.size());
+        return hasher.finish();
+    }
+}
+
+TEST_CASE(hashes_match_murmur3)
+{
+    CHECK_EQ(hash("").hex(), std::string("00000000000000000000000000000000"));
+    const hash128 fox = hash("The quick brown fox jumps over the lazy dog");
+    CHECK_EQ(fox.low, 0xe34bbc7bbc071b6cull);
+    CHECK_EQ(fox.high, 0x7a433ca9c49a9347ull);
+}
+
+TEST_CASE(chunks_give_the_same_hash)
+{
+    std::string data;
+    for (int i = 0; i < 100; ++i)
+        data += static_cast<char>('a' + i % 26);
+
+    for (const size_t chunk : { size_t(1), size_t(3), size_t(15), size_t(16), size_t(17), size_t(64) })
+    {
+        hasher128 hasher;
+        for (size_t at = 0; at < data.size(); at += chunk)
+            hasher.update(data.data() + at, std::min(chunk, data.size() - at));
+        CHECK_EQ(hasher.finish().hex(), hash(data).hex());
+    }
+
+    // Finishing does not end the hash.
+    hasher128 hasher;
+    hasher.update(data.data(), 40);
+    CHECK_EQ(hasher.finish().hex(), hash(data.substr(0, 40)).hex());
+    hasher.update(data.data() + 40, data.size() - 40);
+    CHECK_EQ(hasher.finish().hex(), hash(data).hex());
+}
+
+TEST_CASE(strings_are_hashed_with_their_length)
+{
+    hasher128 ab_c, a_bc;
+    ab_c.update_string("ab");
+    ab_c.update_string("c");
+    a_bc.update_string("a");
+    a_bc.update_string("bc");
+    CHECK(ab_c.finish() != a_bc.finish());
+}
+
+TEST_CASE(hex_round_trips)
+{
+    const hash128 value{ 0x0123456789abcdefull, 0xfedcba9876543210ull };
+    CHECK_EQ(value.hex(), std::string("fedcba98765432100123456789abcdef"));
+    CHECK(hash128::from_hex(value.hex()) == value);
+    CHECK(hash128::from_hex(hash("x").hex()) == hash("x"));
+
+    CHECK(!hash128::from_hex(""));
+    CHECK(!hash128::from_hex("fedcba98765432100123456789abcde"));
+    CHECK(!hash128::from_hex("fedcba98765432100123456789abcdef0"));
+    CHECK(!hash128::from_hex("FEDCBA98765432100123456789ABCDEF"));
+    CHECK(!hash128::from_hex("fedcba9876543210g123456789abcdef"));
+
+    std::unordered_set<hash128, glsp::impl::hash::hash128_hash> set{ value, hash("x"), value };
+    CHECK_EQ(set.size(), size_t(2));
+}
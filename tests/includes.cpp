@@ -0,0 +1,91 @@
+#include "test.hpp"
+
+#include <fstream>
+
+using glsp_test::code_lines;
+using glsp_test::preprocess;
+using lines = std::vector<std::string>;
+
+namespace
+{
+    /* A fresh directory for the files of one test case. */
+    glsp::files::path directory(const std::string& name)
+    {
+        const auto path = glsp::files::temp_directory_path() / "glsp_tests" / name;
+        glsp::files::remove_all(path);
+        glsp::files::create_directories(path);
+        return path;
+    }
+
+    void write(const glsp::files::path& file, const std::string& contents)
+    {
+        glsp::files::create_directories(file.parent_path());
+        std::ofstream(file) << contents;
+    }
+
+    glsp::processed_file preprocess_file(const glsp::files::path& file, std::vector<glsp::files::path> include_directories = {})
+    {
+        glsp::preprocess_source_info info;
+        info.include_directories = std::move(include_directories);
+        info.name = file.string();
+        std::ifstream input(file);
+        return preprocess(std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()), info);
+    }
+}
+
+TEST_CASE(files_next_to_the_including_file)
+{
+    const auto dir = directory("relative");
+    write(dir / "main.glsl", "#include \"sub/a.glsl\"\nmain\n");
+    write(dir / "sub/a.glsl", "#include \"b.glsl\"\na\n");
+    write(dir / "sub/b.glsl", "b\n");
+    const auto processed = preprocess_file(dir / "main.glsl");
+    CHECK_EQ(code_lines(processed.contents), (lines{ "b", "a", "main" }));
+    CHECK_EQ(processed.dependencies.size(), size_t(2));
+}
+
+TEST_CASE(include_directories)
+{
+    const auto dir = directory("directories");
+    write(dir / "main.glsl", "#include <lib.glsl>\n");
+    write(dir / "include/lib.glsl", "lib\n");
+    CHECK_EQ(code_lines(preprocess_file(dir / "main.glsl", { dir / "include" }).contents), lines{ "lib" });
+}
+
+TEST_CASE(pragma_once)
+{
+    const auto dir = directory("once");
+    write(dir / "main.glsl", "#include \"a.glsl\"\n#include \"a.glsl\"\n#include \"b.glsl\"\n#include \"b.glsl\"\nmain\n");
+    write(dir / "a.glsl", "#pragma once\na\n");
+    write(dir / "b.glsl", "b\n");
+    CHECK_EQ(code_lines(preprocess_file(dir / "main.glsl").contents), (lines{ "a", "b", "b", "main" }));
+}
+
+TEST_CASE(missing_files_are_errors)
+{
+    const auto dir = directory("missing");
+    write(dir / "main.glsl", "#include \"none.glsl\"\n");
+    CHECK_EQ(preprocess_file(dir / "main.glsl").error_count, 1);
+}
+
+TEST_CASE(last_include_directory_wins)
+{
+    const auto dir = directory("order");
+    write(dir / "main.glsl", "#include <lib.glsl>\n");
+    write(dir / "first/lib.glsl", "first\n");
+    write(dir / "second/lib.glsl", "second\n");
+    CHECK_EQ(code_lines(preprocess_file(dir / "main.glsl", { dir / "first", dir / "second" }).contents), lines{ "second" });
+}
+
+TEST_CASE(created_files_are_found)
+{
+    const auto dir = directory("created");
+    glsp::include_cache cache;
+    glsp::preprocess_source_info info;
+    info.name = (dir / "main.glsl").string();
+    info.include_paths = &cache;
+    CHECK_EQ(preprocess("#include \"late.glsl\"\n", info).error_count, 1);
+    write(dir / "late.glsl", "late\n");
+    CHECK_EQ(code_lines(preprocess("#include \"late.glsl\"\n", info).contents), lines{ "late" });
+    CHECK(glsp::state().get_include_cache() == nullptr);
+}
@@ -0,0 +1,98 @@
+#include "test.hpp"
+
+#include "compiler/interprocess.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+using glsp::impl::cache::file_lock;
+using glsp::impl::cache::write_atomically;
+
+namespace
+{
+    /* A fresh directory for the files of one test case. */
+    glsp::files::path directory(const std::string& name)
+    {
+        const auto path = glsp::files::temp_directory_path() / "glsp_tests" / name;
+        glsp::files::remove_all(path);
+        glsp::files::create_directories(path);
+        return path;
+    }
+
+    std::string read(const glsp::files::path& file)
+    {
+        std::ifstream in(file, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    size_t file_count(const glsp::files::path& dir)
+    {
+        return static_cast<size_t>(std::distance(glsp::files::directory_iterator(dir), glsp::files::directory_iterator()));
+    }
+}
+
+TEST_CASE(files_are_replaced_as_a_whole)
+{
+    const auto dir = directory("write_atomically");
+    const auto file = dir / "data.bin";
+    CHECK(write_atomically(file, [](std::ostream& out) { out << "first"; }));
+    CHECK_EQ(read(file), std::string("first"));
+
+    int renames = 0;
+    CHECK(write_atomically(file, [](std::ostream& out) { out << "second"; }, [&] {
+        // The old file is still in place while the new one is complete.
+        ++renames;
+        CHECK_EQ(read(file), std::string("first"));
+        CHECK_EQ(file_count(dir), size_t(2));
+    }));
+    CHECK_EQ(renames, 1);
+    CHECK_EQ(read(file), std::string("second"));
+    CHECK_EQ(file_count(dir), size_t(1));
+}
+
+TEST_CASE(failed_writes_leave_everything_untouched)
+{
+    const auto dir = directory("write_atomically_failed");
+    CHECK(!write_atomically(dir / "missing" / "data.bin", [](std::ostream& out) { out << "data"; }));
+    CHECK(!glsp::files::exists(dir / "missing"));
+
+    // A directory cannot be replaced by a file.
+    glsp::files::create_directories(dir / "taken" / "inner");
+    CHECK(!write_atomically(dir / "taken", [](std::ostream& out) { out << "data"; }));
+    CHECK(glsp::files::is_directory(dir / "taken" / "inner"));
+    CHECK_EQ(file_count(dir), size_t(1));
+}
+
+TEST_CASE(locks_are_exclusive)
+{
+    const auto dir = directory("file_lock");
+    const auto lock_path = dir / "shared.lock";
+    std::atomic<int> inside{ 0 };
+    std::atomic<int> overlaps{ 0 };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 20; ++i)
+            {
+                const file_lock lock(lock_path);
+                if (++inside != 1)
+                    ++overlaps;
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                --inside;
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    CHECK_EQ(overlaps.load(), 0);
+    // The lock file only exists while the lock is held or waited for.
+    CHECK(!glsp::files::exists(lock_path));
+
+    // Without a lock file, nothing is locked and nothing blocks.
+    const file_lock unprotected(dir / "missing" / "shared.lock");
+    const file_lock again(dir / "missing" / "shared.lock");
+}
@@ -0,0 +1,62 @@
+#include "test.hpp"
+
+#include <fstream>
+
+using glsp_test::preprocess;
+
+namespace
+{
+    /* The source line of every non-empty output line, following the #line directives like a driver does. */
+    std::vector<int> source_lines(const std::string& contents)
+    {
+        std::vector<int> lines;
+        std::istringstream stream(contents);
+        int line = 1;
+        for (std::string text; std::getline(stream, text); ++line)
+        {
+            if (text.compare(0, 6, "#line ") == 0)
+                line = std::stoi(text.substr(6)) - 1;
+            else if (text.find_first_not_of(" \t") != std::string::npos)
+                lines.push_back(line);
+        }
+        return lines;
+    }
+
+    size_t line_directives(const std::string& contents)
+    {
+        size_t count = 0;
+        for (size_t at = contents.find("#line"); at != std::string::npos; at = contents.find("#line", at + 1))
+            ++count;
+        return count;
+    }
+}
+
+TEST_CASE(short_gaps_are_filled_with_newlines)
+{
+    const auto processed = preprocess("a\n#if 0\nx\nx\n#endif\n#define X \\\n  1\nb X\n", {}, false);
+    CHECK_EQ(line_directives(processed.contents), size_t(0));
+    CHECK_EQ(source_lines(processed.contents), (std::vector<int>{ 1, 8 }));
+}
+
+TEST_CASE(long_gaps_get_one_line_directive)
+{
+    std::string source = "a\n#if 0\n";
+    for (int i = 0; i < 20; ++i)
+        source += "x\n";
+    source += "#endif\nb\nc\n";
+    const auto processed = preprocess(source, {}, false);
+    CHECK_EQ(line_directives(processed.contents), size_t(1));
+    CHECK_EQ(source_lines(processed.contents), (std::vector<int>{ 1, 24, 25 }));
+}
+
+TEST_CASE(includes_switch_lines_only_at_their_borders)
+{
+    const auto dir = glsp::files::temp_directory_path() / "glsp_tests" / "line_directives";
+    glsp::files::create_directories(dir);
+    std::ofstream(dir / "lib.glsl") << "l1\nl2\n";
+    glsp::preprocess_source_info info;
+    info.name = (dir / "main.glsl").string();
+    const auto processed = preprocess("m1\n#include \"lib.glsl\"\nm3\nm4\n", info, false);
+    CHECK_EQ(line_directives(processed.contents), size_t(2));
+    CHECK_EQ(source_lines(processed.contents), (std::vector<int>{ 1, 1, 2, 3, 4 }));
+}
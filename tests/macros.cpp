@@ -0,0 +1,53 @@
+#include "test.hpp"
+
+using glsp_test::code_lines;
+using glsp_test::preprocess;
+using lines = std::vector<std::string>;
+
+TEST_CASE(object_macros_are_rescanned)
+{
+    CHECK_EQ(code_lines(preprocess("#define A B\n#define B 1\nA\n").contents), lines{ "1" });
+}
+
+TEST_CASE(recursion_stops_at_the_macro_itself)
+{
+    CHECK_EQ(code_lines(preprocess("#define SELF SELF + 1\nSELF\n").contents), lines{ "SELF + 1" });
+    CHECK_EQ(code_lines(preprocess("#define A B\n#define B A\nA B\n").contents), lines{ "A B" });
+}
+
+TEST_CASE(arguments_keep_their_hide_sets)
+{
+    CHECK_EQ(code_lines(preprocess("#define SELF SELF + 1\n#define ID(x) x\nID(SELF)\nID(ID(ID(SELF)))\n").contents),
+        (lines{ "SELF + 1", "SELF + 1" }));
+    CHECK_EQ(code_lines(preprocess("#define SELF SELF + 1\n#define LIST(...) [__VA_ARGS__]\nLIST(SELF, SELF, 1)\n").contents),
+        lines{ "[SELF + 1, SELF + 1, 1]" });
+}
+
+TEST_CASE(function_macros_expand_their_replacement)
+{
+    CHECK_EQ(code_lines(preprocess("#define F(x) G(x) + x\n#define G(y) y * 2\nF(3)\n").contents), lines{ "3 * 2 + 3" });
+    CHECK_EQ(code_lines(preprocess("#define EMPTY\n#define F(x) [x]\nF() F(EMPTY) F((1, 2))\n").contents), lines{ "[] [] [(1, 2)]" });
+}
+
+TEST_CASE(redefinitions_replace_the_macro)
+{
+    CHECK_EQ(code_lines(preprocess("#define A 1\nA\n#define A 1\nA\n#define A 2\nA\n#define A(x) x\nA(3)\n").contents),
+        (lines{ "1", "1", "2", "3" }));
+}
+
+TEST_CASE(predefined_macros)
+{
+    glsp::preprocess_source_info info;
+    info.definitions = { glsp::definition("SIZE", glsp::definition_info("4")) };
+    CHECK_EQ(code_lines(preprocess("int a[SIZE];\n", info).contents), lines{ "int a[4];" });
+}
+
+TEST_CASE(macro_reads_list_conditions_and_macros)
+{
+    glsp::preprocess_source_info info;
+    info.definitions = { glsp::definition("X", glsp::definition_info("1")) };
+    info.record_macro_reads = true;
+    const auto processed = preprocess(
+        "#ifdef USE_A\n#endif\n#if defined(B) || C\n#endif\n#define LOCAL 2\nfloat foo() { return X + LOCAL; }\n", info);
+    CHECK_EQ(processed.macro_reads, (lines{ "B", "C", "USE_A", "X" }));
+}
@@ -0,0 +1,163 @@
+#include "test.hpp"
+
+#include "compiler/manifest.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+using glsp::impl::cache::manifest;
+using glsp::impl::hash::hash128;
+using lines = std::vector<std::string>;
+
+namespace
+{
+    /* A fresh directory for the files of one test case. */
+    glsp::files::path directory(const std::string& name)
+    {
+        const auto path = glsp::files::temp_directory_path() / "glsp_tests" / name;
+        glsp::files::remove_all(path);
+        glsp::files::create_directories(path);
+        return path;
+    }
+
+    std::string read(const glsp::files::path& file)
+    {
+        std::ifstream in(file, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    void write(const glsp::files::path& file, const std::string& contents)
+    {
+        std::ofstream(file, std::ios::binary | std::ios::trunc) << contents;
+    }
+
+    const hash128 shader{ 1, 0 };
+    const hash128 input{ 2, 0 };
+    const hash128 content{ 3, 0 };
+
+    /* Saves a manifest with one shader reading A and B and depending on dep.glsl. */
+    glsp::files::path saved_manifest(const glsp::files::path& dir)
+    {
+        write(dir / "dep.glsl", "x\n");
+        manifest m(dir / "cache.manifest");
+        m.insert(shader, { "A", "B" }, input, content, { dir / "dep.glsl" });
+        m.use(content, 100);
+        m.save();
+        return dir / "cache.manifest";
+    }
+
+    bool empty(manifest& m)
+    {
+        return m.read_sets(shader).empty() && !m.find(input) && !m.contains(content);
+    }
+}
+
+TEST_CASE(saved_manifests_load_unchanged)
+{
+    const auto dir = directory("manifest_round_trip");
+    manifest loaded(saved_manifest(dir));
+    CHECK_EQ(loaded.read_sets(shader).size(), size_t(1));
+    CHECK_EQ(loaded.read_sets(shader).front(), (lines{ "A", "B" }));
+    CHECK(loaded.find(input) == content);
+    CHECK(loaded.contains(content));
+
+    // A changed dependency invalidates the link from the next pass on.
+    const auto time = glsp::files::last_write_time(dir / "dep.glsl");
+    glsp::files::last_write_time(dir / "dep.glsl", time + std::chrono::seconds(10));
+    CHECK(loaded.find(input) == content);
+    loaded.next_pass();
+    CHECK(!loaded.find(input));
+}
+
+TEST_CASE(damaged_manifests_load_empty)
+{
+    const auto dir = directory("manifest_damaged");
+    const auto file = saved_manifest(dir);
+    const std::string data = read(file);
+    CHECK(data.size() > 12);
+
+    for (size_t size = 0; size < data.size(); ++size)
+    {
+        write(file, data.substr(0, size));
+        manifest truncated(file);
+        CHECK(empty(truncated));
+    }
+
+    // Counts larger than the rest of the file are not allocated. The dependency count follows the tag and version.
+    std::string huge = data;
+    const uint32_t count = 0xffffffffu;
+    std::memcpy(&huge[8], &count, sizeof(count));
+    write(file, huge);
+    manifest corrupt(file);
+    CHECK(empty(corrupt));
+
+    write(file, "not a manifest at all");
+    manifest garbage(file);
+    CHECK(empty(garbage));
+}
+
+TEST_CASE(the_least_recently_used_binaries_are_evicted)
+{
+    const auto dir = directory("manifest_evict");
+    write(dir / "dep.glsl", "x\n");
+    manifest m(dir / "cache.manifest");
+    const hash128 first{ 10, 0 }, second{ 11, 0 }, third{ 12, 0 };
+    m.insert(shader, {}, hash128{ 20, 0 }, first, { dir / "dep.glsl" });
+    m.use(first, 100);
+    m.insert(shader, { "A" }, hash128{ 21, 0 }, second, { dir / "dep.glsl" });
+    m.use(second, 100);
+    m.insert(shader, { "B" }, hash128{ 22, 0 }, third, { dir / "dep.glsl" });
+    m.use(third, 100);
+
+    CHECK(m.evict(300, 3, third).empty());
+    // Loading the first binary makes the second one the least recently used.
+    m.use(first, 100);
+    CHECK(m.evict(250, 0, third) == std::vector<hash128>{ second });
+    CHECK(!m.contains(second));
+    CHECK(!m.find(hash128{ 21, 0 }));
+    CHECK(m.find(hash128{ 20, 0 }) == first);
+
+    // The binary just stored is kept even if it alone is over the budget.
+    CHECK(m.evict(0, 1, third) == std::vector<hash128>{ first });
+    CHECK(m.evict(50, 0, third).empty());
+    CHECK(m.contains(third));
+}
+
+TEST_CASE(garbage_collection_removes_orphaned_and_stale_binaries)
+{
+    const auto dir = directory("manifest_garbage");
+    write(dir / "kept.glsl", "x\n");
+    write(dir / "deleted.glsl", "x\n");
+    const hash128 current{ 10, 0 }, old_version{ 11, 0 }, orphaned{ 12, 0 }, lost{ 13, 0 };
+    manifest m(dir / "cache.manifest");
+    m.insert(shader, {}, hash128{ 20, 0 }, current, { dir / "kept.glsl" });
+    m.use(current, 10);
+    m.insert(hash128{ 2, 0 }, {}, hash128{ 21, 0 }, orphaned, { dir / "deleted.glsl" });
+    m.use(orphaned, 10);
+    m.insert(hash128{ 3, 0 }, {}, hash128{ 23, 0 }, lost, { dir / "kept.glsl" });
+    m.use(lost, 10);
+    // A binary of an earlier version of the shader, which no link refers to anymore.
+    m.use(old_version, 10);
+    glsp::files::remove(dir / "deleted.glsl");
+    m.next_pass();
+
+    auto unused = m.collect_garbage([&](const hash128& content) { return content != lost; });
+    std::sort(unused.begin(), unused.end(), [](const hash128& a, const hash128& b) { return a.low < b.low; });
+    CHECK(unused == (std::vector<hash128>{ old_version, orphaned }));
+    CHECK(m.contains(current));
+    CHECK(!m.contains(old_version));
+    CHECK(!m.contains(orphaned));
+    CHECK(!m.contains(lost));
+    CHECK(!m.find(hash128{ 23, 0 }));
+    CHECK(m.find(hash128{ 20, 0 }) == current);
+
+    // The removal is saved as well.
+    m.save();
+    manifest loaded(dir / "cache.manifest");
+    CHECK(loaded.contains(current));
+    CHECK(!loaded.contains(orphaned));
+    CHECK(!loaded.contains(old_version));
+}
@@ -0,0 +1,67 @@
+#include "test.hpp"
+
+#include <fstream>
+
+using glsp_test::preprocess;
+
+namespace
+{
+    glsp::processed_file minify(const std::string& source, bool glsl, bool source_map)
+    {
+        glsp::preprocess_source_info info;
+        info.do_minify = true;
+        info.minify_glsl = glsl;
+        return preprocess(source, info, source_map);
+    }
+
+    std::string minify(const std::string& source, bool glsl = false)
+    {
+        return minify(source, glsl, false).contents;
+    }
+}
+
+TEST_CASE(whitespace_and_comments_are_removed)
+{
+    CHECK_EQ(minify("#version 450 core\n/* block */\nlayout(location = 0) out vec4 color; // c\nvoid main()\n{\n    color = vec4( 1.0 , 0.5 , 0.0 , 1.0 );\n}\n"),
+        std::string("#version 450 core\nlayout(location=0)out vec4 color;void main(){color=vec4(1.0,0.5,0.0,1.0);}"));
+}
+
+TEST_CASE(operators_are_kept_apart)
+{
+    CHECK_EQ(minify("int a = 1 - -1; int b = a+ +1; float c = 1.0/ *p;\n"), std::string("int a=1- -1;int b=a+ +1;float c=1.0/ *p;"));
+}
+
+TEST_CASE(glsl_names_are_shortened)
+{
+    CHECK_EQ(minify("uniform float scale;\nfloat twice(float value) { return (value) * 2.0; }\nvoid main() { float result = twice(scale); gl_Position = vec4(result); }\n", true),
+        std::string("uniform float scale;float _a(float a){return a*2.0;}void main(){float a=_a(scale);gl_Position=vec4(a);}"));
+}
+
+TEST_CASE(directives_keep_their_own_lines)
+{
+    CHECK_EQ(minify("#version 450\n#extension GL_ARB_compute_shader : enable\n#define N 4\nfloat a[N];\n#pragma optimize(off)\nint b = 0x1F + 1.5e-3;\n", true),
+        std::string("#version 450\n#extension GL_ARB_compute_shader : enable\nfloat _a[4];\n#pragma optimize(off)\nint _b=0x1F+1.5e-3;"));
+    CHECK_EQ(minify("void main() { float a = 1.0; a ++; a += + 1.0; a = a - - a; }\n", true),
+        std::string("void main(){float a=1.0;a++;a+=+1.0;a=a- -a;}"));
+}
+
+TEST_CASE(source_maps_of_minified_code_resolve_line_only_positions)
+{
+    const auto dir = glsp::files::temp_directory_path() / "glsp_tests" / "minified_map";
+    glsp::files::create_directories(dir / "inc");
+    std::ofstream(dir / "inc/lib.glsl") << "float lib(float x)\n{\n    return x * 2.0;\n}\n";
+
+    glsp::preprocess_source_info info;
+    info.name = (dir / "main.glsl").string();
+    info.do_minify = true;
+    info.minify_glsl = true;
+    const auto processed = preprocess("#include \"inc/lib.glsl\"\nvoid main()\n{\n    float y = lib(1.0);\n    undefined_name = y;\n}\n", info);
+
+    // Find the output line of the statement in main, as a driver reporting only lines would.
+    int output_line = 1;
+    for (size_t i = 0; i < processed.contents.find("undefined_name"); ++i)
+        output_line += processed.contents[i] == '\n' ? 1 : 0;
+    const auto main_file = glsp::files::path(info.name).string();
+    CHECK_EQ(processed.map.rewrite_log("0(" + std::to_string(output_line) + ") : error\n"), main_file + "(5) : error\n");
+    CHECK_EQ(processed.map.rewrite_log("ERROR: 0:" + std::to_string(output_line) + ": error\n"), "ERROR: " + main_file + ":5: error\n");
+}
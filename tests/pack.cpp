@@ -0,0 +1,124 @@
+#include "test.hpp"
+
+#include "compiler/pack.hpp"
+
+#include <fstream>
+#include <iterator>
+
+using glsp::impl::cache::pack;
+using glsp::impl::hash::hash128;
+
+namespace
+{
+    glsp::files::path pack_file(const std::string& name)
+    {
+        const auto dir = glsp::files::temp_directory_path() / "glsp_tests" / name;
+        glsp::files::remove_all(dir);
+        glsp::files::create_directories(dir);
+        return dir / "binaries.pack";
+    }
+
+    std::vector<uint8_t> bytes(size_t size, uint8_t first)
+    {
+        std::vector<uint8_t> data(size);
+        for (size_t i = 0; i < size; ++i)
+            data[i] = static_cast<uint8_t>(first + i);
+        return data;
+    }
+
+    /* The payload of a key as a string, or "none". */
+    std::string found(const pack& p, const hash128& key)
+    {
+        const auto payload = p.find(key);
+        if (!payload)
+            return "none";
+        return std::to_string(payload->format) + "/" + std::to_string(payload->binary_format) + ":" +
+            std::string(reinterpret_cast<const char*>(payload->data), payload->size);
+    }
+
+    std::string expected(uint32_t format, uint32_t binary_format, const std::vector<uint8_t>& data)
+    {
+        return std::to_string(format) + "/" + std::to_string(binary_format) + ":" + std::string(data.begin(), data.end());
+    }
+
+    const hash128 a{ 1, 5 };
+    const hash128 b{ 2, 1 };
+    const hash128 c{ 3, 9 };
+}
+
+TEST_CASE(payloads_are_found_before_and_after_flushing)
+{
+    const auto file = pack_file("pack_flush");
+    pack writer(file);
+    writer.insert(a, 1, 10, bytes(100, 0));
+    writer.insert(b, 2, 20, bytes(33, 7));
+    CHECK_EQ(found(writer, a), expected(1, 10, bytes(100, 0)));
+    CHECK_EQ(found(pack(file), a), std::string("none"));
+
+    writer.flush();
+    CHECK_EQ(found(writer, b), expected(2, 20, bytes(33, 7)));
+    pack reader(file);
+    CHECK_EQ(found(reader, a), expected(1, 10, bytes(100, 0)));
+    CHECK_EQ(found(reader, b), expected(2, 20, bytes(33, 7)));
+
+    // Entries of other writers are kept and only seen after refreshing.
+    pack other(file);
+    other.insert(c, 3, 30, bytes(5, 1));
+    other.erase(a);
+    other.flush();
+    CHECK_EQ(found(reader, c), std::string("none"));
+    reader.refresh();
+    CHECK_EQ(found(reader, c), expected(3, 30, bytes(5, 1)));
+    CHECK_EQ(found(reader, a), std::string("none"));
+    CHECK(reader.keys() == (std::vector<hash128>{ b, c }));
+}
+
+TEST_CASE(compacting_drops_garbage)
+{
+    const auto file = pack_file("pack_compact");
+    pack p(file);
+    // Little enough garbage that flushing does not compact the file by itself.
+    p.insert(a, 1, 10, bytes(50, 0));
+    p.insert(b, 1, 10, bytes(1000, 3));
+    p.flush();
+    p.insert(c, 1, 10, bytes(10, 4));
+    p.flush();
+    p.erase(a);
+    p.flush();
+    const auto before = glsp::files::file_size(file);
+
+    p.compact();
+    CHECK(glsp::files::file_size(file) < before);
+    CHECK_EQ(found(p, a), std::string("none"));
+    CHECK_EQ(found(p, b), expected(1, 10, bytes(1000, 3)));
+    CHECK_EQ(found(pack(file), c), expected(1, 10, bytes(10, 4)));
+}
+
+TEST_CASE(damaged_packs_are_ignored_and_replaced)
+{
+    const auto file = pack_file("pack_damaged");
+    {
+        pack p(file);
+        p.insert(a, 1, 10, bytes(50, 0));
+        p.flush();
+    }
+
+    // The last byte belongs to the checksum behind the index.
+    std::string data;
+    {
+        std::ifstream in(file, std::ios::binary);
+        data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    data.back() = static_cast<char>(data.back() ^ 0xff);
+    std::ofstream(file, std::ios::binary | std::ios::trunc) << data;
+
+    pack damaged(file);
+    CHECK_EQ(found(damaged, a), std::string("none"));
+    CHECK(damaged.keys().empty());
+
+    damaged.insert(b, 2, 20, bytes(8, 2));
+    damaged.flush();
+    pack replaced(file);
+    CHECK_EQ(found(replaced, b), expected(2, 20, bytes(8, 2)));
+    CHECK_EQ(found(replaced, a), std::string("none"));
+}
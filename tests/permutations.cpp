@@ -0,0 +1,61 @@
+#include "test.hpp"
+
+#include <glsp/capabilities.hpp>
+
+using glsp_test::code_lines;
+using glsp_test::preprocess;
+using lines = std::vector<std::string>;
+
+namespace
+{
+    glsp::permutation_set permutations(const std::string& source, const std::vector<glsp::definition>& axes)
+    {
+        static const glsp::capabilities gl = [] {
+            glsp::capabilities caps;
+            caps.version = 450;
+            return caps;
+        }();
+        glsp::preprocess_source_info info;
+        info.source = source;
+        info.name = "test.glsl";
+        info.gl_capabilities = &gl;
+        return glsp::preprocess_permutations(info, axes);
+    }
+}
+
+TEST_CASE(every_combination_matches_a_full_run)
+{
+    const std::string source =
+        "#ifdef A\na\n#endif\n"
+        "#if defined(B) && defined(C)\nbc\n#elif defined(D)\nd\n#endif\n"
+        "#if defined(A) || defined(D)\nad\n#endif\n";
+    const std::vector<glsp::definition> axes = { glsp::definition("A"), glsp::definition("B"), glsp::definition("C"), glsp::definition("D") };
+    const auto set = permutations(source, axes);
+    for (uint64_t combination = 0; combination < 16; ++combination)
+    {
+        glsp::preprocess_source_info info;
+        for (size_t axis = 0; axis < axes.size(); ++axis)
+            if (combination >> axis & 1)
+                info.definitions.push_back(axes[axis]);
+        CHECK_EQ(code_lines(set.find(combination).file.contents), code_lines(preprocess(source, info).contents));
+    }
+}
+
+TEST_CASE(equal_results_are_stored_once)
+{
+    // Without A, B is never looked up, so the runs giving no code depend on different axes.
+    const auto set = permutations("#if defined(A) && defined(B)\nx\n#endif\n", { glsp::definition("A"), glsp::definition("B") });
+    CHECK_EQ(set.permutations.size(), size_t(2));
+    CHECK_EQ(code_lines(set.find(0b11).file.contents), lines{ "x" });
+    CHECK_EQ(&set.find(0b01), &set.find(0b10));
+    CHECK_EQ(&set.find(0b00), &set.find(0b10));
+}
+
+TEST_CASE(more_than_64_axes_are_rejected)
+{
+    std::vector<glsp::definition> axes;
+    for (int i = 0; i < 65; ++i)
+        axes.push_back(glsp::definition("A" + std::to_string(i)));
+    const auto set = permutations("x\n", axes);
+    CHECK(!set.find(0).file.valid());
+}
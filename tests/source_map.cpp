@@ -0,0 +1,64 @@
+#include "test.hpp"
+
+namespace
+{
+    std::vector<std::string> text(const std::vector<glsp::source_map::run>& runs)
+    {
+        std::vector<std::string> result;
+        for (const auto& r : runs)
+            result.push_back(std::to_string(r.output_line) + ":" + std::to_string(r.output_column) + " -> " +
+                std::to_string(r.file) + ":" + std::to_string(r.line));
+        return result;
+    }
+}
+
+TEST_CASE(runs_survive_encoding)
+{
+    // Large and negative deltas need several digits, and files are reused when they come back.
+    const std::vector<glsp::source_map::run> runs{
+        { 1, 1, 0, 1 }, { 1, 40, 1, 100000 }, { 1, 41, 0, 2 }, { 3, 1, 2, 1 }, { 70000, 5, 1, 7 }, { 70001, 1, 0, 3 },
+    };
+    const std::vector<std::string> names{ "main.glsl", "lib/a.glsl", "b.glsl" };
+
+    glsp::source_map map;
+    for (const auto& r : runs)
+        map.add(r.output_line, r.output_column, names[r.file], r.line);
+    CHECK_EQ(map.size(), runs.size());
+    CHECK_EQ(map.files(), names);
+    CHECK_EQ(text(map.runs()), text(runs));
+
+    const glsp::source_map restored(map.files(), map.data());
+    CHECK_EQ(text(restored.runs()), text(runs));
+    CHECK_EQ(restored.size(), runs.size());
+    CHECK_EQ(restored.find(1, 39).file, std::string("main.glsl"));
+    CHECK_EQ(restored.find(1, 40).line, 100000);
+    CHECK_EQ(restored.find(2).line, 3);
+    CHECK_EQ(restored.find(69999).file, std::string("b.glsl"));
+    CHECK_EQ(restored.find(69999).line, 69997);
+    CHECK_EQ(restored.find(70000, 4).line, 69998);
+    CHECK_EQ(restored.find(70000, 5).line, 7);
+}
+
+TEST_CASE(runs_at_the_same_position_replace_each_other)
+{
+    glsp::source_map map;
+    map.add(1, 1, "a.glsl", 1);
+    map.add(2, 3, "a.glsl", 5);
+    map.add(2, 3, "b.glsl", 9);
+    map.add(4, 1, "a.glsl", 8);
+    CHECK_EQ(map.size(), size_t(3));
+    CHECK_EQ(map.find(2, 3).file, std::string("b.glsl"));
+    CHECK_EQ(map.find(3).line, 10);
+    CHECK_EQ(glsp::source_map(map.files(), map.data()).find(4).line, 8);
+}
+
+TEST_CASE(line_only_positions_of_shared_lines_are_kept)
+{
+    glsp::source_map map;
+    map.add(1, 1, "a.glsl", 3);
+    map.add(1, 20, "b.glsl", 7);
+    map.add(2, 1, "c.glsl", 1);
+    CHECK_EQ(map.rewrite_log("0(1) : error\n"), std::string("0(1) : error\n"));
+    CHECK_EQ(map.rewrite_log("0:1(25): error\n"), std::string("b.glsl:7: error\n"));
+    CHECK_EQ(map.rewrite_log("0(2) : error\n"), std::string("c.glsl(1) : error\n"));
+}
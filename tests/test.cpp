@@ -0,0 +1,98 @@
+#include "test.hpp"
+
+#include <glsp/capabilities.hpp>
+
+#include <iostream>
+
+namespace glsp_test
+{
+    namespace
+    {
+        int failures = 0;
+    }
+
+    std::vector<test_case>& registry()
+    {
+        static std::vector<test_case> cases;
+        return cases;
+    }
+
+    void fail(const char* file, int line, const std::string& message)
+    {
+        ++failures;
+        std::cerr << file << "(" << line << "): check failed: " << message << "\n";
+    }
+
+    std::string describe(const std::string& value)
+    {
+        std::string result = "\"";
+        for (const char c : value)
+        {
+            if (c == '\n')
+                result += "\\n";
+            else
+                result += c;
+        }
+        return result + "\"";
+    }
+
+    std::string describe(const std::vector<std::string>& value)
+    {
+        std::string result = "{ ";
+        for (size_t i = 0; i < value.size(); ++i)
+            result += (i == 0 ? "" : ", ") + describe(value[i]);
+        return result + " }";
+    }
+
+    glsp::processed_file preprocess(const std::string& source, glsp::preprocess_source_info info, bool source_map)
+    {
+        static const glsp::capabilities gl = [] {
+            glsp::capabilities caps;
+            caps.version = 450;
+            return caps;
+        }();
+        info.source = source;
+        if (info.name.empty())
+            info.name = "test.glsl";
+        info.gl_capabilities = &gl;
+        info.generate_source_map = source_map;
+        return glsp::preprocess_source(info);
+    }
+
+    std::vector<std::string> code_lines(const std::string& contents)
+    {
+        std::vector<std::string> lines;
+        std::istringstream stream(contents);
+        for (std::string line; std::getline(stream, line);)
+        {
+            const size_t begin = line.find_first_not_of(" \t\r");
+            if (begin == std::string::npos)
+                continue;
+            const size_t end = line.find_last_not_of(" \t\r");
+            lines.push_back(line.substr(begin, end - begin + 1));
+        }
+        return lines;
+    }
+}
+
+/* Runs all test cases, or only the one named on the command line. */
+int main(int argc, char** argv)
+{
+    int run = 0;
+    for (const auto& test : glsp_test::registry())
+    {
+        if (argc > 1 && std::string(argv[1]) != test.name)
+            continue;
+        std::cout << "[ RUN ] " << test.name << "\n";
+        test.run();
+        ++run;
+    }
+
+    if (run == 0)
+    {
+        std::cerr << "No test case found.\n";
+        return 1;
+    }
+    std::cout << run << " test cases, " << glsp_test::failures << " failed checks.\n";
+    return glsp_test::failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <glsp/glsp.hpp>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace glsp_test
+{
+    /* A named group of checks, registered with TEST_CASE and run by test.cpp. */
+    struct test_case
+    {
+        const char* name;
+        void (*run)();
+    };
+
+    std::vector<test_case>& registry();
+
+    struct registrar
+    {
+        registrar(const char* name, void (*run)()) { registry().push_back({ name, run }); }
+    };
+
+    /* Reports a failed check. The test executable fails if this is called at least once. */
+    void fail(const char* file, int line, const std::string& message);
+
+    template<typename T>
+    std::string describe(const T& value)
+    {
+        std::ostringstream stream;
+        stream << value;
+        return stream.str();
+    }
+
+    std::string describe(const std::string& value);
+    std::string describe(const std::vector<std::string>& value);
+
+    template<typename T>
+    std::string describe(const std::vector<T>& value)
+    {
+        std::string result = "{ ";
+        for (size_t i = 0; i < value.size(); ++i)
+            result += (i == 0 ? "" : ", ") + describe(value[i]);
+        return result + " }";
+    }
+
+    /* Preprocesses a source without a GL context, by default with a source map instead of #line directives. */
+    glsp::processed_file preprocess(const std::string& source, glsp::preprocess_source_info info = {}, bool source_map = true);
+
+    /* Splits processed code into lines, without empty lines and surrounding whitespace. */
+    std::vector<std::string> code_lines(const std::string& contents);
+}
+
+#define TEST_CASE(name)                                                         \
+    static void name();                                                         \
+    static const glsp_test::registrar name##_registrar(#name, &name);           \
+    static void name()
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition))                                                       \
+            glsp_test::fail(__FILE__, __LINE__, #condition);                    \
+    } while (false)
+
+#define CHECK_EQ(actual, expected)                                              \
+    do {                                                                        \
+        const auto& actual_value = (actual);                                    \
+        const auto& expected_value = (expected);                                \
+        if (!(actual_value == expected_value))                                  \
+            glsp_test::fail(__FILE__, __LINE__, #actual " == " #expected        \
+                "\n    actual:   " + glsp_test::describe(actual_value) +        \
+                "\n    expected: " + glsp_test::describe(expected_value));      \
+    } while (false)